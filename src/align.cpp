@@ -1,102 +1,202 @@
 #include <librealsense2/rs.hpp>
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
-#include <chrono>
 
-
-int main() {
+#include "core/cli.hpp"
+#include "core/depth_align.hpp"
+#include "core/depth_stream.hpp"
+#include "core/depth_units.hpp"
+#include "core/display_service.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/point_cloud.hpp"
+#include "core/recorder.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/shm_ring.hpp"
+#include "core/trace.hpp"
+
+
+int main(int argc, char** argv) {
     // 参数设置
-    int saved_count = 0;
     int width = 640;
     int height = 480;
     int fps = 30;
     int ALIGN_WAY = 1; // 0: 彩色图像对齐到深度图; 1: 深度图对齐到彩色图像
 
-    // 创建保存路径
-    std::string color_path, depth_path;
+    // 保存设置：--record-dir <目录>（需已存在），--record-format npy|npy-f32|raw|rvl|seq|seq-rvl
+    // 点云：按 'p' 保存带颜色的 PLY 到同一目录，--voxel <米> 先做体素降采样
+    rsd::recorder_options record_cfg;
+    float voxel_size = 0;
+    try {
+        for (int i = 1; i + 1 < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--record-dir") {
+                record_cfg.directory = argv[++i];
+            } else if (arg == "--record-format") {
+                record_cfg.format = rsd::parse_record_format(argv[++i]);
+            } else if (arg == "--voxel") {
+                voxel_size = rsd::parse_float("--voxel", argv[++i]);
+                if (voxel_size <= 0) {
+                    throw std::invalid_argument("--voxel expects a positive size in meters");
+                }
+            }
+        }
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // 创建帧来源配置
+    rsd::source_config source_cfg;
+    source_cfg.enable_depth(width, height, fps);
+    source_cfg.enable_color(width, height, fps);
+    rsd::parse_source_args(argc, argv, source_cfg);
 
-    // 创建管道和配置
-    rs2::pipeline pipeline;
-    rs2::config config;
-    config.enable_stream(RS2_STREAM_DEPTH, width, height, RS2_FORMAT_Z16, fps);
-    config.enable_stream(RS2_STREAM_COLOR, width, height, RS2_FORMAT_BGR8, fps);
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
 
-    // 启动管道
-    rs2::pipeline_profile profile = pipeline.start(config);
+    // 启动帧来源
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     // 获取深度比例
-    float depth_scale = profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+    float depth_scale = source->depth_scale();
 
     // 设置对齐方式
-    rs2::align align(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
+    std::shared_ptr<rs2::filter> align = rsd::make_align_block(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
+
+    // --publish <name>：把对齐后的深度与彩色一起发布到共享内存环，供同机的其他进程读取
+    rsd::shm_ring_options publish_cfg;
+    publish_cfg.color = true;
+    std::unique_ptr<rsd::shm_publisher> publisher;
+    if (rsd::parse_publish_args(argc, argv, publish_cfg)) {
+        publisher.reset(new rsd::shm_publisher(publish_cfg));
+    }
+
+    // --stream <address>：把对齐后的深度与彩色推送给套接字客户端
+    rsd::stream_server_options stream_cfg;
+    std::unique_ptr<rsd::stream_server> streamer;
+    if (rsd::parse_stream_args(argc, argv, stream_cfg)) {
+        streamer.reset(new rsd::stream_server(stream_cfg));
+    }
+
+    // 中间结果的缓冲跨帧复用
+    rsd::frame_pool buffers;
+
+    // 录制器在第一次保存时创建；写盘在后台线程完成，不阻塞显示循环
+    record_cfg.depth_scale = depth_scale;
+    record_cfg.fps = float(source_cfg.depth_fps);
+    std::unique_ptr<rsd::recorder> recorder;
+    bool recording = false;
+
+    // 点云生成器与缓冲跨帧复用
+    rsd::point_cloud_generator cloud_generator;
+    rsd::point_cloud cloud;
+    rsd::point_cloud voxel_cloud;
+    std::unique_ptr<rsd::voxel_grid> voxel_grid;
+    if (voxel_size > 0) {
+        voxel_grid.reset(new rsd::voxel_grid(voxel_size));
+    }
+    int cloud_index = 0;
+
+    // 处理循环在后台线程运行，主线程按刷新率显示最新结果并转交按键；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
 
     try {
-        while (true) {
+        display.run([&] {
             // 等待帧数据
-            rs2::frameset frames = pipeline.wait_for_frames();
+            rs2::frameset frames;
+            if (!source->next(frames)) {
+                return false;
+            }
 
             // 对齐帧
-            rs2::frameset aligned_frames = align.process(frames);
+            rs2::frameset aligned_frames = align->process(frames);
 
             // 获取深度帧和彩色帧
             rs2::depth_frame depth_frame = aligned_frames.get_depth_frame();
             rs2::video_frame color_frame = aligned_frames.get_color_frame();
 
-            // 将深度帧和彩色帧转换为 OpenCV Mat
-            cv::Mat depth_image(cv::Size(width, height), CV_16UC1, (void*)depth_frame.get_data(), cv::Mat::AUTO_STEP);
-            cv::Mat color_image(cv::Size(width, height), CV_8UC3, (void*)color_frame.get_data(), cv::Mat::AUTO_STEP);
+            // 将深度帧和彩色帧转换为 OpenCV Mat（尺寸与行跨度取自帧本身，录像的分辨率可能与配置不同）
+            cv::Mat depth_image = rsd::depth_view(depth_frame);
+            cv::Mat color_image = rsd::frame_view(color_frame, CV_8UC3);
+
+            // 发布对齐后的深度与彩色（各拷贝进共享内存一次）
+            if (publisher) {
+                publisher->publish(depth_frame, color_frame);
+            }
+            if (streamer) {
+                streamer->send(depth_frame, color_frame);
+            }
 
             // 如果需要彩色图像对齐到深度图，获取未对齐的彩色图像
             cv::Mat color_image2;
             if (ALIGN_WAY == 0) {
                 rs2::video_frame color_frame2 = frames.get_color_frame();
-                color_image2 = cv::Mat(cv::Size(width, height), CV_8UC3, (void*)color_frame2.get_data(), cv::Mat::AUTO_STEP);
-                cv::imshow("color_image2", color_image2);
+                color_image2 = rsd::frame_view(color_frame2, CV_8UC3);
+                display.show("color_image2", color_image2, color_frame2);
             }
 
-            // 将深度图转换为米为单位
-            cv::Mat depth_image_in_meters;
-            depth_image.convertTo(depth_image_in_meters, CV_32F, depth_scale);
-
-            // 归一化深度图到 0-255 范围（灰度显示）
-            cv::Mat depth_normalized;
-            cv::normalize(depth_image_in_meters, depth_normalized, 0, 255, cv::NORM_MINMAX, CV_8U);
+            // 归一化深度图到 0-255 范围（灰度显示）。归一化与单位无关，直接在 Z16 上用整数完成，不再换算成米
+            cv::Mat depth_normalized = buffers.acquire(depth_image.size(), CV_8U);
+            rsd::normalize_minmax(depth_image, depth_normalized);
 
-            // 显示彩色图和归一化的深度图
-            cv::imshow("Color Image", color_image);
-            cv::imshow("Depth Image (Normalized)", depth_normalized);
+            // 显示彩色图和归一化的深度图（彩色图直接引用帧内存，由显示服务持有该帧）
+            display.show("Color Image", color_image, color_frame);
+            display.show("Depth Image (Normalized)", depth_normalized);
+            const int key = display.poll_key();
 
-            // 按键处理
-            char key = cv::waitKey(1);
-            if (key == 's') {
-                saved_count++;
-                std::cout << saved_count << " 已保存图像至 " << color_path << " 和 " << depth_path << std::endl;
-
-                // 保存彩色图像
-                if (color_image2.empty()) {
-                    cv::imwrite(color_path + "/" + std::to_string(saved_count) + ".png", color_image);
+            // 按键处理：'s' 保存当前帧，'r' 开始 / 停止连续录制
+            if (key == 's' || key == 'r') {
+                if (!recorder) {
+                    recorder.reset(new rsd::recorder(record_cfg));
+                }
+                if (key == 'r') {
+                    recording = !recording;
+                    std::cout << (recording ? "开始录制至 " : "停止录制 ") << record_cfg.directory << std::endl;
                 } else {
-                    cv::imwrite(color_path + "/" + std::to_string(saved_count) + ".png", color_image2);
+                    std::cout << "保存当前帧至 " << record_cfg.directory << std::endl;
+                }
+            } else if (key == 'p') {
+                // 对齐后的深度与彩色同分辨率，点的像素序号直接用于取色
+                cloud_generator.configure(depth_frame);
+                cloud_generator.process(depth_image, cloud);
+                if (voxel_grid) {
+                    voxel_grid->downsample(cloud, voxel_cloud);
+                }
+                const std::string path = record_cfg.directory + "/cloud_" + std::to_string(cloud_index++) + ".ply";
+                const rsd::point_cloud& saved = voxel_grid ? voxel_cloud : cloud;
+                if (rsd::write_ply(path, saved, color_image)) {
+                    std::cout << "保存点云至 " << path << "（" << saved.size() << " 点）" << std::endl;
+                } else {
+                    std::cerr << "无法写入 " << path << std::endl;
                 }
-
-                // 保存深度图（以 .npy 格式保存）
-                std::string depth_file = depth_path + "/" + std::to_string(saved_count) + ".npy";
-                cv::FileStorage fs(depth_file, cv::FileStorage::WRITE);
-                fs << "depth" << depth_image_in_meters;
-                fs.release();
             } else if (key == 'q' || key == 27) {
-                break;
+                return false;
             }
-        }
+
+            // 保存深度图和彩色图（彩色图对齐到深度图时保存未对齐的彩色图，与原来一致）
+            if (recording || key == 's') {
+                recorder->push(depth_frame, ALIGN_WAY == 0 ? rs2::frame(frames.get_color_frame()) : rs2::frame(color_frame));
+            }
+            return true;
+        });
     } catch (const rs2::error& e) {
         std::cerr << "RealSense error: " << e.what() << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 
-    // 停止管道
-    pipeline.stop();
-    cv::destroyAllWindows();
+    // 停止帧来源，等待录制器写完队列中的帧
+    source->stop();
+    if (recorder) {
+        recorder->stop();
+        const rsd::recorder::stats stats = recorder->get_stats();
+        std::cout << "已写入 " << stats.written << " 帧（" << rsd::record_format_name(record_cfg.format)
+                  << "），丢弃 " << stats.dropped << " 帧，写入失败 " << stats.errors << " 帧" << std::endl;
+    }
     return 0;
 }
\ No newline at end of file
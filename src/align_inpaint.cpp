@@ -1,102 +1,119 @@
 #include <librealsense2/rs.hpp>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <vector>
 
-// 修补深度图像
-cv::Mat inpaint_depth_image(const cv::Mat& depth_image, int inpaint_radius = 3) {
-    // 创建掩码，标记无效像素（值为 0）
-    cv::Mat mask = (depth_image == 0);
-    mask.convertTo(mask, CV_8U); // 转换为 8 位单通道图像
-
-    // 将无效像素设置为 NaN
-    cv::Mat depth_image_fixed;
-    depth_image.convertTo(depth_image_fixed, CV_32F);
-    depth_image_fixed.setTo(std::numeric_limits<float>::quiet_NaN(), mask);
-
-    // 使用线性插值填充 NaN 值
-    cv::Mat valid_mask = ~mask;
-    cv::Mat inpainted_depth_image;
-    cv::inpaint(depth_image_fixed, mask, inpainted_depth_image, inpaint_radius, cv::INPAINT_TELEA);
-
-    return inpainted_depth_image;
-}
-
-int main() {
+#include "core/depth_align.hpp"
+#include "core/depth_units.hpp"
+#include "core/display_service.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/hole_filler.hpp"
+#include "core/joint_bilateral.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/pixel_pipeline.hpp"
+#include "core/trace.hpp"
+
+int main(int argc, char** argv) {
     // 参数设置
     int width = 640;
     int height = 480;
     int fps = 30;
     int ALIGN_WAY = 1; // 0: 彩色图像对齐到深度图; 1: 深度图对齐到彩色图像
 
-    // 创建管道和配置
-    rs2::pipeline pipeline;
-    rs2::config config;
-    config.enable_stream(RS2_STREAM_DEPTH, width, height, RS2_FORMAT_Z16, 90);
-    config.enable_stream(RS2_STREAM_COLOR, width, height, RS2_FORMAT_BGR8, 30);
+    // 创建帧来源配置
+    rsd::source_config source_cfg;
+    source_cfg.enable_depth(width, height, 90);
+    source_cfg.enable_color(width, height, 30);
+    rsd::parse_source_args(argc, argv, source_cfg);
 
-    // 启动管道
-    rs2::pipeline_profile profile = pipeline.start(config);
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
+
+    // 启动帧来源
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     // 获取深度比例
-    float depth_scale = profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+    float depth_scale = source->depth_scale();
+
+    // 米制阈值只在这里换算一次，之后深度始终是设备单位的 Z16
+    const uint16_t near_units = rsd::meters_to_units(0.5f, depth_scale);
+    const uint16_t one_meter = std::max<uint16_t>(1, rsd::meters_to_units(1.0f, depth_scale));
 
     // 设置对齐方式
-    rs2::align align(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
+    std::shared_ptr<rs2::filter> align = rsd::make_align_block(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
+
+    // 空洞填充：金字塔 push-pull，空洞按周围较远的深度（背景）补齐，缓冲跨帧复用
+    rsd::push_pull_filler hole_filler;
+    cv::Mat filled_depth_image;
+    cv::Mat near_replaced_image;
+
+    // 彩色引导的联合双边滤波，5x5 窗口，代替原来的中值滤波 + 双边滤波
+    rsd::joint_bilateral_filter joint_filter(rsd::joint_bilateral_options(2, 2.0f, 20.0f));
+    cv::Mat smoothed_depth_image;
+
+    // 其余中间结果的缓冲跨帧复用
+    rsd::frame_pool buffers;
+
+    // 处理循环在后台线程运行，主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
 
     try {
-        while (true) {
+        display.run([&] {
             // 等待帧数据
-            rs2::frameset frames = pipeline.wait_for_frames();
+            rs2::frameset frames;
+            if (!source->next(frames)) {
+                return false;
+            }
 
             // 对齐帧
-            rs2::frameset aligned_frames = align.process(frames);
+            rs2::frameset aligned_frames = align->process(frames);
 
             // 获取深度帧和彩色帧
             rs2::depth_frame depth_frame = aligned_frames.get_depth_frame();
             rs2::video_frame color_frame = aligned_frames.get_color_frame();
 
             // 将深度帧和彩色帧转换为 OpenCV Mat
-            cv::Mat depth_image(cv::Size(width, height), CV_16UC1, (void*)depth_frame.get_data(), cv::Mat::AUTO_STEP);
-            cv::Mat color_image(cv::Size(width, height), CV_8UC3, (void*)color_frame.get_data(), cv::Mat::AUTO_STEP);
-
-            // 将深度图转换为米为单位
-            cv::Mat depth_image_in_meters;
-            depth_image.convertTo(depth_image_in_meters, CV_32F, depth_scale);
+            cv::Mat depth_image = rsd::depth_view(depth_frame);
+            cv::Mat color_image = rsd::frame_view(color_frame, CV_8UC3);
 
-            // 修补深度图像
-            cv::Mat inpainted_depth_image = inpaint_depth_image(depth_image_in_meters);
+            // 修补深度图像（在 Z16 上进行，不修改对齐后的帧）
+            hole_filler.process(depth_image, filled_depth_image);
 
-            // 处理无效值
-            inpainted_depth_image.setTo(1.0f, inpainted_depth_image <= 0.5f);
+            // 处理无效值：不超过 0.5 米的深度设为 1 米，与原来一样在平滑之前进行，近距离的值不会扩散到邻域
+            const auto replace_near = rsd::pixel::invalid_below(near_units + 1)
+                                    | rsd::pixel::fill_invalid(one_meter);
+            rsd::pixel::apply<uint16_t>(replace_near, filled_depth_image, near_replaced_image);
 
-            // 中值滤波
-            cv::Mat median_filtered_image;
-            cv::medianBlur(inpainted_depth_image, median_filtered_image, 5);
+            // 以对齐后的彩色图为引导平滑深度，同样在 Z16 上进行
+            joint_filter.process(near_replaced_image, color_image, smoothed_depth_image);
 
-            // 双边滤波
-            cv::Mat filtered_image;
-            cv::bilateralFilter(median_filtered_image, filtered_image, 5, 75, 75);
+            // 转换为灰度：0-1 米映射到 0-255，更远的截断为白色，与按米显示浮点图相同。
+            // 全部在设备单位上用整数完成，不换算成浮点米
+            cv::Mat filtered_image = buffers.acquire(smoothed_depth_image.size(), CV_8U);
+            const auto to_gray = rsd::pixel::clip(uint16_t(0), one_meter)
+                               | rsd::pixel::fixed_scale(255.0 / one_meter, one_meter);
+            rsd::pixel::apply<uint8_t>(to_gray, smoothed_depth_image, filtered_image);
 
-            // 显示彩色图和处理后的深度图
-            cv::imshow("Color Image", color_image);
-            cv::imshow("Filtered Depth Image", filtered_image);
+            // 显示彩色图和处理后的深度图（彩色图直接引用帧内存，由显示服务持有该帧）
+            display.show("Color Image", color_image, color_frame);
+            display.show("Filtered Depth Image", filtered_image);
 
             // 按键处理
-            char key = cv::waitKey(1);
-            if (key == 'q' || key == 27) {
-                break;
-            }
-        }
+            const int key = display.poll_key();
+            return key != 'q' && key != 27;
+        });
     } catch (const rs2::error& e) {
         std::cerr << "RealSense error: " << e.what() << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 
-    // 停止管道
-    pipeline.stop();
-    cv::destroyAllWindows();
+    // 停止帧来源
+    source->stop();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace rsd {
+
+// 命令行中是否出现了某个开关参数（如 --native-spatial）
+inline bool has_flag(int argc, char** argv, const char* flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], flag) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 把选项的值解析为浮点数；不是完整的有限数字（空串、多余的字符等）时抛出 std::invalid_argument
+inline float parse_float(const char* option, const char* value) {
+    char* end = nullptr;
+    const float result = std::strtof(value, &end);
+    if (end == value || *end != '\0' || !std::isfinite(result)) {
+        throw std::invalid_argument(std::string(option) + " expects a number, got \"" + value + "\"");
+    }
+    return result;
+}
+
+} // namespace rsd
@@ -0,0 +1,170 @@
+#include "core/clip_quantize.hpp"
+#include "core/simd.hpp"
+#include "core/trace.hpp"
+
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 定点参数：q = (min(v, max) * mul + 0x8000) >> 16，mul = round(255 * 2^16 / max)
+// max >= 256 时 mul 不超过 16 位，SIMD 实现可以用 16 位乘法（高半部分 + 低半部分的最高位做舍入）
+struct quantize_params {
+    uint16_t min_depth;
+    uint16_t max_depth;
+    uint32_t mul;
+    uint8_t invalid_value;
+};
+
+quantize_params make_params(const clip_range& range) {
+    if (range.max_depth == 0) {
+        throw std::invalid_argument("clip_quantize: max_depth must be positive");
+    }
+    quantize_params p;
+    p.min_depth = range.min_depth;
+    p.max_depth = range.max_depth;
+    p.mul = uint32_t((255u * 65536u + range.max_depth / 2) / range.max_depth);
+    p.invalid_value = range.invalid_value;
+    return p;
+}
+
+inline uint8_t quantize_one(uint16_t v, const quantize_params& p) {
+    if (v < p.min_depth) {
+        return p.invalid_value;
+    }
+    uint32_t c = v < p.max_depth ? v : p.max_depth;
+    uint32_t q = (c * p.mul + 0x8000u) >> 16;
+    return uint8_t(q > 255u ? 255u : q);
+}
+
+void quantize_scalar(const uint16_t* src, uint8_t* dst, size_t count, const quantize_params& p) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = quantize_one(src[i], p);
+    }
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("sse4.1")
+inline __m128i quantize8_sse41(__m128i v, __m128i vmax, __m128i vmul) {
+    __m128i c = _mm_min_epu16(v, vmax);
+    __m128i hi = _mm_mulhi_epu16(c, vmul);
+    __m128i lo = _mm_mullo_epi16(c, vmul);
+    return _mm_add_epi16(hi, _mm_srli_epi16(lo, 15));
+}
+
+RSD_TARGET("sse4.1")
+void quantize_sse41(const uint16_t* src, uint8_t* dst, size_t count, const quantize_params& p) {
+    const __m128i vmin = _mm_set1_epi16(short(p.min_depth));
+    const __m128i vmax = _mm_set1_epi16(short(p.max_depth));
+    const __m128i vmul = _mm_set1_epi16(short(p.mul));
+    const __m128i vinvalid = _mm_set1_epi8(char(p.invalid_value));
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        // v >= min 等价于 max(v, min) == v
+        __m128i valid0 = _mm_cmpeq_epi16(_mm_max_epu16(v0, vmin), v0);
+        __m128i valid1 = _mm_cmpeq_epi16(_mm_max_epu16(v1, vmin), v1);
+        __m128i q = _mm_packus_epi16(quantize8_sse41(v0, vmax, vmul), quantize8_sse41(v1, vmax, vmul));
+        __m128i valid = _mm_packs_epi16(valid0, valid1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_blendv_epi8(vinvalid, q, valid));
+    }
+    quantize_scalar(src + i, dst + i, count - i, p);
+}
+
+RSD_TARGET("avx2")
+inline __m256i quantize16_avx2(__m256i v, __m256i vmax, __m256i vmul) {
+    __m256i c = _mm256_min_epu16(v, vmax);
+    __m256i hi = _mm256_mulhi_epu16(c, vmul);
+    __m256i lo = _mm256_mullo_epi16(c, vmul);
+    return _mm256_add_epi16(hi, _mm256_srli_epi16(lo, 15));
+}
+
+RSD_TARGET("avx2")
+void quantize_avx2(const uint16_t* src, uint8_t* dst, size_t count, const quantize_params& p) {
+    const __m256i vmin = _mm256_set1_epi16(short(p.min_depth));
+    const __m256i vmax = _mm256_set1_epi16(short(p.max_depth));
+    const __m256i vmul = _mm256_set1_epi16(short(p.mul));
+    const __m256i vinvalid = _mm256_set1_epi8(char(p.invalid_value));
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+        __m256i valid0 = _mm256_cmpeq_epi16(_mm256_max_epu16(v0, vmin), v0);
+        __m256i valid1 = _mm256_cmpeq_epi16(_mm256_max_epu16(v1, vmin), v1);
+        // 256 位 pack 按 128 位通道交错，混合后再统一恢复顺序
+        __m256i q = _mm256_packus_epi16(quantize16_avx2(v0, vmax, vmul), quantize16_avx2(v1, vmax, vmul));
+        __m256i valid = _mm256_packs_epi16(valid0, valid1);
+        __m256i out = _mm256_permute4x64_epi64(_mm256_blendv_epi8(vinvalid, q, valid), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    }
+    quantize_sse41(src + i, dst + i, count - i, p);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+void quantize_neon(const uint16_t* src, uint8_t* dst, size_t count, const quantize_params& p) {
+    const uint16x8_t vmin = vdupq_n_u16(p.min_depth);
+    const uint16x8_t vmax = vdupq_n_u16(p.max_depth);
+    const uint16x4_t vmul = vdup_n_u16(uint16_t(p.mul));
+    const uint8x8_t vinvalid = vdup_n_u8(p.invalid_value);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vld1q_u16(src + i);
+        uint8x8_t valid = vmovn_u16(vcgeq_u16(v, vmin));
+        uint16x8_t c = vminq_u16(v, vmax);
+        // vrshrn 即 (x + 0x8000) >> 16
+        uint16x4_t lo = vrshrn_n_u32(vmull_u16(vget_low_u16(c), vmul), 16);
+        uint16x4_t hi = vrshrn_n_u32(vmull_u16(vget_high_u16(c), vmul), 16);
+        uint8x8_t q = vqmovn_u16(vcombine_u16(lo, hi));
+        vst1_u8(dst + i, vbsl_u8(valid, q, vinvalid));
+    }
+    quantize_scalar(src + i, dst + i, count - i, p);
+}
+
+#endif
+
+} // namespace
+
+void clip_quantize(const uint16_t* src, uint8_t* dst, size_t count, const clip_range& range) {
+    const quantize_params p = make_params(range);
+    // mul 超过 16 位（max_depth < 256）时只有标量实现
+    if (p.mul > 0xffffu) {
+        quantize_scalar(src, dst, count, p);
+        return;
+    }
+
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: quantize_avx2(src, dst, count, p); break;
+    case simd::isa::sse41: quantize_sse41(src, dst, count, p); break;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: quantize_neon(src, dst, count, p); break;
+#endif
+    default: quantize_scalar(src, dst, count, p); break;
+    }
+}
+
+void clip_quantize(const cv::Mat& depth, cv::Mat& out, const clip_range& range) {
+    RSD_TRACE_SCOPE("clip");
+    CV_Assert(depth.type() == CV_16UC1);
+    out.create(depth.size(), CV_8UC1);
+
+    if (depth.isContinuous() && out.isContinuous()) {
+        clip_quantize(depth.ptr<uint16_t>(), out.ptr<uint8_t>(), depth.total(), range);
+        return;
+    }
+    for (int y = 0; y < depth.rows; ++y) {
+        clip_quantize(depth.ptr<uint16_t>(y), out.ptr<uint8_t>(y), size_t(depth.cols), range);
+    }
+}
+
+} // namespace rsd
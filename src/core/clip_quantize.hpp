@@ -0,0 +1,29 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace rsd {
+
+// 裁剪范围（深度单位，默认相机为毫米）
+struct clip_range {
+    uint16_t min_depth;      // 小于该值（包括 0）的像素视为无效
+    uint16_t max_depth;      // 大于该值的深度截断为该值
+    uint8_t invalid_value;   // 无效像素的输出值
+
+    clip_range(uint16_t min_depth = 100, uint16_t max_depth = 5000, uint8_t invalid_value = 0)
+        : min_depth(min_depth), max_depth(max_depth), invalid_value(invalid_value) {}
+};
+
+// 单次遍历完成裁剪与量化：
+//   out = in < min_depth ? invalid_value : round(min(in, max_depth) * 255 / max_depth)
+// 与原来 “裁剪 -> convertTo(CV_32F, 1/max) -> convertTo(CV_8U, 255)” 的结果最多相差 1，
+// 但只读一次 uint16 数据、直接写 8 位结果，也不修改输入
+// 运行时自动选择 AVX2 / SSE4.1 / NEON / 标量实现，各实现的结果逐位相同
+void clip_quantize(const uint16_t* src, uint8_t* dst, size_t count, const clip_range& range);
+
+// depth 必须为 CV_16UC1，out 会被分配为同尺寸的 CV_8UC1（已分配则复用）
+void clip_quantize(const cv::Mat& depth, cv::Mat& out, const clip_range& range);
+
+} // namespace rsd
@@ -0,0 +1,306 @@
+#include "core/depth_align.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+#include <librealsense2/rsutil.h>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+static_assert(sizeof(std::atomic<uint16_t>) == sizeof(uint16_t),
+              "z-buffer writes treat uint16_t depth pixels as std::atomic<uint16_t>");
+
+// 只有带系数的 Brown-Conrady 类模型需要逐点走 rsutil；其余模型即使系数为 0 也不是恒等映射
+bool has_distortion(const rs2_intrinsics& intrinsics) {
+    switch (intrinsics.model) {
+    case RS2_DISTORTION_NONE:
+        return false;
+    case RS2_DISTORTION_BROWN_CONRADY:
+    case RS2_DISTORTION_INVERSE_BROWN_CONRADY:
+    case RS2_DISTORTION_MODIFIED_BROWN_CONRADY:
+        for (int i = 0; i < 5; ++i) {
+            if (intrinsics.coeffs[i] != 0) {
+                return true;
+            }
+        }
+        return false;
+    default:
+        return true;
+    }
+}
+
+// 角点查找表与投影参数，每帧只读
+struct corner_projector {
+    const float* x;
+    const float* y;
+    const float* z;
+    const rs2_extrinsics* extrinsics;
+    const rs2_intrinsics* color;
+    bool distorted;
+
+    // 角点 i 处深度为 depth（米）的点投影到彩色像素平面，点在相机后方时返回 false
+    bool project(size_t i, float depth, float& px, float& py) const {
+        float point[3] = {depth * x[i] + extrinsics->translation[0],
+                          depth * y[i] + extrinsics->translation[1],
+                          depth * z[i] + extrinsics->translation[2]};
+        if (point[2] <= 0) {
+            return false;
+        }
+        if (distorted) {
+            float pixel[2];
+            rs2_project_point_to_pixel(pixel, color, point);
+            px = pixel[0];
+            py = pixel[1];
+        } else {
+            px = color->fx * point[0] / point[2] + color->ppx;
+            py = color->fy * point[1] / point[2] + color->ppy;
+        }
+        return true;
+    }
+};
+
+// z 缓冲：保留最近（最小）的非零深度
+inline void store_nearest(std::atomic<uint16_t>& slot, uint16_t depth) {
+    uint16_t current = slot.load(std::memory_order_relaxed);
+    while ((current == 0 || depth < current) &&
+           !slot.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
+
+rs2_extrinsics identity_extrinsics() {
+    rs2_extrinsics e = {{1, 0, 0, 0, 1, 0, 0, 0, 1}, {0, 0, 0}};
+    return e;
+}
+
+} // namespace
+
+depth_aligner::depth_aligner()
+    : configured_(false), depth_scale_(0), color_distorted_(false) {
+    std::memset(&depth_, 0, sizeof(depth_));
+    std::memset(&color_, 0, sizeof(color_));
+    std::memset(&extrinsics_, 0, sizeof(extrinsics_));
+}
+
+bool depth_aligner::same_parameters(const rs2_intrinsics& depth, const rs2_intrinsics& color,
+                                    const rs2_extrinsics& extrinsics, float depth_scale) const {
+    return configured_ && depth_scale == depth_scale_ &&
+           std::memcmp(&depth, &depth_, sizeof(depth)) == 0 &&
+           std::memcmp(&color, &color_, sizeof(color)) == 0 &&
+           std::memcmp(&extrinsics, &extrinsics_, sizeof(extrinsics)) == 0;
+}
+
+void depth_aligner::configure(const rs2_intrinsics& depth, const rs2_intrinsics& color,
+                              const rs2_extrinsics& depth_to_color, float depth_scale) {
+    if (same_parameters(depth, color, depth_to_color, depth_scale)) {
+        return;
+    }
+    if (depth.width <= 0 || depth.height <= 0 || color.width <= 0 || color.height <= 0 || depth_scale <= 0) {
+        throw std::invalid_argument("depth_aligner: invalid stream parameters");
+    }
+
+    depth_ = depth;
+    color_ = color;
+    extrinsics_ = depth_to_color;
+    depth_scale_ = depth_scale;
+    color_distorted_ = has_distortion(color);
+
+    // 像素 (u, v) 的覆盖区域为 [u - 0.5, u + 0.5] x [v - 0.5, v + 0.5]，角点共 (w+1)x(h+1) 个
+    const int cols = depth.width + 1;
+    const int rows = depth.height + 1;
+    const float* r = depth_to_color.rotation;   // 列主序
+    corner_x_.resize(size_t(cols) * rows);
+    corner_y_.resize(corner_x_.size());
+    corner_z_.resize(corner_x_.size());
+    for (int v = 0; v < rows; ++v) {
+        for (int u = 0; u < cols; ++u) {
+            const float pixel[2] = {u - 0.5f, v - 0.5f};
+            float ray[3];
+            rs2_deproject_pixel_to_point(ray, &depth_, pixel, 1.0f);
+            const size_t i = size_t(v) * cols + u;
+            corner_x_[i] = r[0] * ray[0] + r[3] * ray[1] + r[6] * ray[2];
+            corner_y_[i] = r[1] * ray[0] + r[4] * ray[1] + r[7] * ray[2];
+            corner_z_[i] = r[2] * ray[0] + r[5] * ray[1] + r[8] * ray[2];
+        }
+    }
+    configured_ = true;
+}
+
+void depth_aligner::configure(const rs2::frameset& frames) {
+    rs2::depth_frame depth = frames.get_depth_frame();
+    rs2::video_frame color = frames.get_color_frame();
+    if (!depth || !color) {
+        throw std::runtime_error("depth_aligner: frameset needs both depth and color frames");
+    }
+    rs2::video_stream_profile depth_profile = depth.get_profile().as<rs2::video_stream_profile>();
+    rs2::video_stream_profile color_profile = color.get_profile().as<rs2::video_stream_profile>();
+    configure(depth_profile.get_intrinsics(), color_profile.get_intrinsics(),
+              depth_profile.get_extrinsics_to(color_profile), depth.get_units());
+}
+
+void depth_aligner::depth_to_color(const cv::Mat& depth, cv::Mat& out) const {
+    RSD_TRACE_SCOPE("align");
+    if (!configured_) {
+        throw std::logic_error("depth_aligner: not configured");
+    }
+    CV_Assert(depth.type() == CV_16UC1 && depth.cols == depth_.width && depth.rows == depth_.height);
+    out.create(color_.height, color_.width, CV_16UC1);
+    out.setTo(cv::Scalar::all(0));
+
+    corner_projector projector = {corner_x_.data(), corner_y_.data(), corner_z_.data(),
+                                  &extrinsics_, &color_, color_distorted_};
+    const size_t corner_cols = size_t(depth_.width) + 1;
+
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        for (int v = range.start; v < range.end; ++v) {
+            const uint16_t* row = depth.ptr<uint16_t>(v);
+            for (int u = 0; u < depth.cols; ++u) {
+                const uint16_t d = row[u];
+                if (d == 0) {
+                    continue;
+                }
+                const float z = d * depth_scale_;
+                const size_t top_left = v * corner_cols + u;
+                float x0f, y0f, x1f, y1f;
+                if (!projector.project(top_left, z, x0f, y0f) ||
+                    !projector.project(top_left + corner_cols + 1, z, x1f, y1f)) {
+                    continue;
+                }
+                // 与 rs2::align 相同的取整方式
+                const int x0 = int(x0f + 0.5f);
+                const int y0 = int(y0f + 0.5f);
+                const int x1 = int(x1f + 0.5f);
+                const int y1 = int(y1f + 0.5f);
+                if (x0 < 0 || y0 < 0 || x1 >= color_.width || y1 >= color_.height) {
+                    continue;
+                }
+                for (int y = y0; y <= y1; ++y) {
+                    std::atomic<uint16_t>* dst = reinterpret_cast<std::atomic<uint16_t>*>(out.ptr<uint16_t>(y));
+                    for (int x = x0; x <= x1; ++x) {
+                        store_nearest(dst[x], d);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void depth_aligner::color_to_depth(const cv::Mat& depth, const cv::Mat& color, cv::Mat& out) const {
+    RSD_TRACE_SCOPE("align");
+    if (!configured_) {
+        throw std::logic_error("depth_aligner: not configured");
+    }
+    CV_Assert(depth.type() == CV_16UC1 && depth.cols == depth_.width && depth.rows == depth_.height);
+    CV_Assert(color.type() == CV_8UC3 && color.cols == color_.width && color.rows == color_.height);
+    out.create(depth.rows, depth.cols, CV_8UC3);
+
+    corner_projector projector = {corner_x_.data(), corner_y_.data(), corner_z_.data(),
+                                  &extrinsics_, &color_, color_distorted_};
+    const size_t corner_cols = size_t(depth_.width) + 1;
+
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        for (int v = range.start; v < range.end; ++v) {
+            const uint16_t* row = depth.ptr<uint16_t>(v);
+            uint8_t* dst = out.ptr<uint8_t>(v);
+            for (int u = 0; u < depth.cols; ++u, dst += 3) {
+                dst[0] = dst[1] = dst[2] = 0;
+                const uint16_t d = row[u];
+                if (d == 0) {
+                    continue;
+                }
+                const float z = d * depth_scale_;
+                const size_t top_left = v * corner_cols + u;
+                float x0f, y0f, x1f, y1f;
+                if (!projector.project(top_left, z, x0f, y0f) ||
+                    !projector.project(top_left + corner_cols + 1, z, x1f, y1f)) {
+                    continue;
+                }
+                // 覆盖区域中心处的彩色像素
+                const int x = int((x0f + x1f) * 0.5f + 0.5f);
+                const int y = int((y0f + y1f) * 0.5f + 0.5f);
+                if (x < 0 || y < 0 || x >= color_.width || y >= color_.height) {
+                    continue;
+                }
+                const uint8_t* src = color.ptr<uint8_t>(y) + 3 * x;
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+    });
+}
+
+namespace {
+
+// 处理块的状态：对齐引擎与按输入流配置缓存的输出流配置
+struct align_block_state {
+    depth_aligner aligner;
+    rs2::stream_profile source;    // 生成 aligned 时所依据的输入流配置
+    rs2::stream_profile aligned;
+};
+
+// 输出流配置：沿用被对齐流的类型与格式，换成目标流的分辨率与内参
+rs2::stream_profile aligned_profile(align_block_state& state, const rs2::stream_profile& from,
+                                    const rs2::stream_profile& to, const rs2_intrinsics& intrinsics) {
+    if (!state.source || state.source.unique_id() != from.unique_id() ||
+        state.aligned.as<rs2::video_stream_profile>().width() != intrinsics.width ||
+        state.aligned.as<rs2::video_stream_profile>().height() != intrinsics.height) {
+        state.aligned = from.as<rs2::video_stream_profile>().clone(from.stream_type(), from.stream_index(), from.format(),
+                                                                  intrinsics.width, intrinsics.height, intrinsics);
+        state.aligned.register_extrinsics_to(to, identity_extrinsics());
+        state.source = from;
+    }
+    return state.aligned;
+}
+
+} // namespace
+
+std::shared_ptr<rs2::filter> make_align_block(rs2_stream align_to) {
+    if (align_to != RS2_STREAM_COLOR && align_to != RS2_STREAM_DEPTH) {
+        throw std::invalid_argument("make_align_block: align_to must be RS2_STREAM_COLOR or RS2_STREAM_DEPTH");
+    }
+    std::shared_ptr<align_block_state> state(new align_block_state());
+    return std::make_shared<rs2::filter>([state, align_to](rs2::frame frame, rs2::frame_source& source) {
+        // 不是同时含深度与彩色的帧集合时原样透传
+        rs2::frameset frames = frame.as<rs2::frameset>();
+        if (!frames) {
+            source.frame_ready(frame);
+            return;
+        }
+        rs2::depth_frame depth = frames.get_depth_frame();
+        rs2::video_frame color = frames.get_color_frame();
+        if (!depth || !color) {
+            source.frame_ready(frame);
+            return;
+        }
+        state->aligner.configure(frames);
+        const cv::Mat depth_image = depth_view(depth);
+
+        std::vector<rs2::frame> result;
+        if (align_to == RS2_STREAM_COLOR) {
+            const rs2_intrinsics& target = state->aligner.color_intrinsics();
+            rs2::stream_profile profile = aligned_profile(*state, depth.get_profile(), color.get_profile(), target);
+            rs2::frame aligned = source.allocate_video_frame(profile, depth, 2, target.width, target.height,
+                                                             target.width * 2, RS2_EXTENSION_DEPTH_FRAME);
+            cv::Mat out = depth_view(aligned.as<rs2::video_frame>());
+            state->aligner.depth_to_color(depth_image, out);
+            result.push_back(aligned);
+            result.push_back(color);
+        } else {
+            const rs2_intrinsics& target = state->aligner.depth_intrinsics();
+            rs2::stream_profile profile = aligned_profile(*state, color.get_profile(), depth.get_profile(), target);
+            rs2::frame aligned = source.allocate_video_frame(profile, color, 3, target.width, target.height,
+                                                             target.width * 3, RS2_EXTENSION_VIDEO_FRAME);
+            cv::Mat out = frame_view(aligned.as<rs2::video_frame>(), CV_8UC3);
+            state->aligner.color_to_depth(depth_image, frame_view(color, CV_8UC3), out);
+            result.push_back(depth);
+            result.push_back(aligned);
+        }
+        source.frame_ready(source.allocate_composite_frame(result));
+    });
+}
+
+} // namespace rsd
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+
+namespace rsd {
+
+// 深度与彩色之间的对齐引擎，替代每帧重复做投影计算的 rs2::align：
+// 每个深度像素四角的反投影射线（已乘以深度->彩色的旋转 R）在相机参数变化时才重建，
+// 每帧只需 P = z * (R * ray) + t 再投影到彩色像素平面。
+// 深度 -> 彩色为散射：每个深度像素覆盖彩色图中的一个矩形，多线程写入，用原子取最小值做 z 缓冲；
+// 彩色 -> 深度为采集：每个深度像素取其覆盖区域中心处的彩色值
+class depth_aligner {
+public:
+    depth_aligner();
+
+    // 设置相机参数，只有参数变化时才重建查找表
+    void configure(const rs2_intrinsics& depth, const rs2_intrinsics& color,
+                   const rs2_extrinsics& depth_to_color, float depth_scale);
+    // 从帧集合中的流配置读取相机参数
+    void configure(const rs2::frameset& frames);
+
+    bool configured() const { return configured_; }
+    const rs2_intrinsics& depth_intrinsics() const { return depth_; }
+    const rs2_intrinsics& color_intrinsics() const { return color_; }
+
+    // 深度 -> 彩色视角：depth 为深度分辨率 CV_16UC1，out 为彩色分辨率 CV_16UC1，
+    // out 已是正确尺寸时直接写入（例如包装 rs2 帧内存的 Mat），不会重新分配
+    void depth_to_color(const cv::Mat& depth, cv::Mat& out) const;
+    // 彩色 -> 深度视角：color 为彩色分辨率 CV_8UC3，out 为深度分辨率 CV_8UC3，无深度处为 0
+    void color_to_depth(const cv::Mat& depth, const cv::Mat& color, cv::Mat& out) const;
+
+private:
+    bool same_parameters(const rs2_intrinsics& depth, const rs2_intrinsics& color,
+                         const rs2_extrinsics& extrinsics, float depth_scale) const;
+
+    bool configured_;
+    rs2_intrinsics depth_;
+    rs2_intrinsics color_;
+    rs2_extrinsics extrinsics_;
+    float depth_scale_;
+    bool color_distorted_;   // 彩色内参有畸变系数时走 rs2_project_point_to_pixel
+
+    // (w+1)x(h+1) 个像素角点的 R * ray，按分量分开存放
+    std::vector<float> corner_x_;
+    std::vector<float> corner_y_;
+    std::vector<float> corner_z_;
+};
+
+// 包装成 rs2 处理块，用法与 rs2::align 相同：align_to 为 RS2_STREAM_COLOR 时深度对齐到彩色，
+// 为 RS2_STREAM_DEPTH 时彩色对齐到深度。输出帧集合包含对齐后的帧与另一路原始帧，
+// 对齐结果直接写入帧池分配的输出帧，不额外拷贝
+std::shared_ptr<rs2::filter> make_align_block(rs2_stream align_to);
+
+} // namespace rsd
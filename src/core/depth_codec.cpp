@@ -0,0 +1,387 @@
+#include "core/depth_codec.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 半字节流：第 i 个半字节位于第 i/2 字节，偶数在低 4 位（x86 / ARM 均为小端，可直接 memcpy 整字）。
+// 每次写入后都把累加器整字存出并前移完整的字节，没有 “字满才写” 的分支；
+// 因此输出缓冲末尾需要留出 8 字节的余量（rvl_max_encoded_size 已包含）
+struct nibble_writer {
+    uint8_t* out;
+    uint64_t acc;
+    unsigned bits;   // 累加器中尚未前移的位数，写入后为 0 或 4
+
+    explicit nibble_writer(uint8_t* out) : out(out), acc(0), bits(0) {}
+
+    // nbits 为 4 的倍数且不超过 48
+    inline void put(uint64_t code, unsigned nbits) {
+        acc |= code << bits;
+        bits += nbits;
+        std::memcpy(out, &acc, 8);
+        out += bits >> 3;
+        acc >>= bits & ~7u;
+        bits &= 7;
+    }
+
+    // 返回压缩数据的结束位置（最后一个半字节所在的字节之后）
+    uint8_t* finish() {
+        return out + (bits ? 1 : 0);
+    }
+};
+
+// 把 value 的低 18 位按 3 位一组摊开到 6 个半字节的低 3 位
+inline uint32_t spread_groups(uint32_t value) {
+    return (value & 0x7) | ((value & 0x38) << 1) | ((value & 0x1c0) << 2) |
+           ((value & 0xe00) << 3) | ((value & 0x7000) << 4) | ((value & 0x38000) << 5);
+}
+
+// spread_groups 的逆操作
+inline uint32_t gather_groups(uint64_t nibbles) {
+    return uint32_t((nibbles & 0x7) | ((nibbles >> 1) & 0x38) | ((nibbles >> 2) & 0x1c0) |
+                    ((nibbles >> 3) & 0xe00) | ((nibbles >> 4) & 0x7000) | ((nibbles >> 5) & 0x38000));
+}
+
+// value < 2^18 的变长编码：按位长算出组数，一次拼出全部半字节和续位，不按值大小分支
+inline uint32_t vle_code(uint32_t value, unsigned& nbits) {
+    const unsigned groups = unsigned(34 - __builtin_clz(value | 1)) / 3;
+    nbits = 4 * groups;
+    return spread_groups(value) | (0x888888u & ((1u << (4 * (groups - 1))) - 1));
+}
+
+inline uint32_t zigzag(int current, int previous) {
+    const int delta = current - previous;
+    return (uint32_t(delta) << 1) ^ uint32_t(delta >> 31);
+}
+
+// 3 位一组的变长编码，每组前加续位；小于 8 的值（最常见）只占一个半字节
+inline void put_vle(nibble_writer& w, uint32_t value) {
+    if (value < (1u << 18)) {
+        unsigned nbits;
+        const uint32_t code = vle_code(value, nbits);
+        w.put(code, nbits);
+        return;
+    }
+    uint64_t code = 0;
+    unsigned nbits = 0;
+    do {
+        uint64_t nibble = value & 7;
+        value >>= 3;
+        if (value) {
+            nibble |= 8;
+        }
+        code |= nibble << nbits;
+        nbits += 4;
+    } while (value);
+    w.put(code, nbits);
+}
+
+struct nibble_reader {
+    const uint8_t* in;
+    size_t size;
+    size_t pos;      // 半字节序号
+
+    nibble_reader(const uint8_t* in, size_t size) : in(in), size(size), pos(0) {}
+
+    inline bool get_vle(uint32_t& value) {
+        // 快速路径：从当前半字节处整字读出，6 个半字节内找到没有续位的一组即可一次解出
+        const size_t byte = pos >> 1;
+        if (byte + 8 <= size) {
+            uint64_t word;
+            std::memcpy(&word, in + byte, 8);
+            word >>= (pos & 1) * 4;
+            const uint64_t last = ~word & 0x888888u;
+            if (last) {
+                const unsigned groups = unsigned(__builtin_ctzll(last)) / 4 + 1;
+                value = gather_groups(word) & ((1u << (3 * groups)) - 1);
+                pos += groups;
+                return true;
+            }
+        }
+        return get_vle_slow(value);
+    }
+
+    // 连续两个差值的快速路径：一次整字读取解出两个值；不满足条件时返回 false 且不移动位置
+    inline bool get_vle_pair(uint32_t& first, uint32_t& second) {
+        const size_t byte = pos >> 1;
+        if (byte + 8 > size) {
+            return false;
+        }
+        uint64_t word;
+        std::memcpy(&word, in + byte, 8);
+        word >>= (pos & 1) * 4;
+        const uint64_t last0 = ~word & 0x888888u;
+        if (!last0) {
+            return false;
+        }
+        const unsigned groups0 = unsigned(__builtin_ctzll(last0)) / 4 + 1;
+        // 读出的字至少有 60 位有效，第一个值最多占 24 位，剩余部分足够容纳第二个值
+        const uint64_t rest = word >> (4 * groups0);
+        const uint64_t last1 = ~rest & 0x888888u;
+        if (!last1) {
+            return false;
+        }
+        const unsigned groups1 = unsigned(__builtin_ctzll(last1)) / 4 + 1;
+        first = gather_groups(word) & ((1u << (3 * groups0)) - 1);
+        second = gather_groups(rest) & ((1u << (3 * groups1)) - 1);
+        pos += groups0 + groups1;
+        return true;
+    }
+
+    // 末尾或很大的值（长的零游程）：逐个半字节读取并检查边界
+    bool get_vle_slow(uint32_t& value) {
+        value = 0;
+        unsigned shift = 0;
+        while (true) {
+            if ((pos >> 1) >= size) {
+                return false;
+            }
+            const uint32_t nibble = (in[pos >> 1] >> ((pos & 1) * 4)) & 15;
+            ++pos;
+            value |= (nibble & 7) << shift;
+            if (!(nibble & 8)) {
+                return true;
+            }
+            shift += 3;
+            if (shift > 30) {
+                return false;
+            }
+        }
+    }
+};
+
+const uint32_t frame_magic = 0x314c5652;   // "RVL1"
+const size_t frame_header_size = 12;
+const int pixels_per_tile = 65536;
+const int max_tiles = 16;
+
+int tile_count(int rows, int cols) {
+    return std::max(1, std::min(std::min(rows, max_tiles), rows * cols / pixels_per_tile));
+}
+
+inline uint16_t read_u16(const uint8_t* p) { uint16_t v; std::memcpy(&v, p, 2); return v; }
+inline uint32_t read_u32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+inline void write_u16(uint8_t* p, uint16_t v) { std::memcpy(p, &v, 2); }
+inline void write_u32(uint8_t* p, uint32_t v) { std::memcpy(p, &v, 4); }
+
+} // namespace
+
+size_t rvl_max_encoded_size(size_t count) {
+    // 每个像素最多 8 个半字节（零个数、非零个数各 1 个，差值最多 6 个），
+    // 末尾可能多一对游程长度以及不足一字的部分
+    return count * 4 + 24;
+}
+
+size_t rvl_encode(const uint16_t* src, size_t count, uint8_t* dst) {
+    if (count > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("rvl_encode: too many pixels");
+    }
+    nibble_writer w(dst);
+    const uint16_t* p = src;
+    const uint16_t* const end = src + count;
+    int previous = 0;
+    while (p != end) {
+        const uint16_t* run = p;
+        while (p != end && *p == 0) {
+            ++p;
+        }
+        put_vle(w, uint32_t(p - run));
+
+        run = p;
+        while (p != end && *p != 0) {
+            ++p;
+        }
+        put_vle(w, uint32_t(p - run));
+
+        // 差值的 zigzag 值小于 2^17，两个像素的编码拼在一起写入，缩短写入器上的依赖链
+        for (; p - run >= 2; run += 2) {
+            unsigned n0, n1;
+            const uint64_t c0 = vle_code(zigzag(run[0], previous), n0);
+            const uint64_t c1 = vle_code(zigzag(run[1], run[0]), n1);
+            previous = run[1];
+            w.put(c0 | (c1 << n0), n0 + n1);
+        }
+        if (run != p) {
+            unsigned n0;
+            const uint32_t c0 = vle_code(zigzag(*run, previous), n0);
+            previous = *run++;
+            w.put(c0, n0);
+        }
+    }
+    return size_t(w.finish() - dst);
+}
+
+bool rvl_decode(const uint8_t* src, size_t size, uint16_t* dst, size_t count) {
+    nibble_reader r(src, size);
+    uint16_t* out = dst;
+    uint16_t* const end = dst + count;
+    int previous = 0;
+    while (out != end) {
+        uint32_t zeros, nonzeros;
+        if (!r.get_vle(zeros) || zeros > size_t(end - out)) {
+            return false;
+        }
+        std::memset(out, 0, zeros * sizeof(uint16_t));
+        out += zeros;
+
+        if (!r.get_vle(nonzeros) || nonzeros > size_t(end - out)) {
+            return false;
+        }
+        // 非零段中的像素必须在 1..65535 之间
+        uint32_t i = 0;
+        for (uint32_t c0, c1; i + 2 <= nonzeros && r.get_vle_pair(c0, c1); i += 2) {
+            const int p0 = previous + (int(c0 >> 1) ^ -int(c0 & 1));
+            previous = p0 + (int(c1 >> 1) ^ -int(c1 & 1));
+            if ((unsigned(p0 - 1) > 65534u) | (unsigned(previous - 1) > 65534u)) {
+                return false;
+            }
+            out[0] = uint16_t(p0);
+            out[1] = uint16_t(previous);
+            out += 2;
+        }
+        for (; i < nonzeros; ++i) {
+            uint32_t code;
+            if (!r.get_vle(code)) {
+                return false;
+            }
+            previous += int(code >> 1) ^ -int(code & 1);
+            if (unsigned(previous - 1) > 65534u) {
+                return false;
+            }
+            *out++ = uint16_t(previous);
+        }
+    }
+    return true;
+}
+
+void depth_codec::encode(const cv::Mat& depth, std::vector<uint8_t>& out) {
+    RSD_TRACE_SCOPE("rvl_encode");
+    if (depth.type() != CV_16UC1) {
+        throw std::invalid_argument("depth_codec: expected CV_16UC1 depth");
+    }
+    if (depth.cols > 0xffff || depth.rows > 0xffff) {
+        throw std::invalid_argument("depth_codec: frame too large");
+    }
+    const cv::Mat* src = &depth;
+    if (!depth.isContinuous()) {
+        depth.copyTo(contiguous_);
+        src = &contiguous_;
+    }
+
+    const int rows = src->rows, cols = src->cols;
+    const int tiles = rows > 0 ? tile_count(rows, cols) : 0;
+    tiles_.resize(size_t(tiles));
+    tile_sizes_.resize(size_t(tiles));
+
+    cv::parallel_for_(cv::Range(0, tiles), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int r0 = int(int64_t(t) * rows / tiles);
+            const int r1 = int(int64_t(t + 1) * rows / tiles);
+            const size_t count = size_t(r1 - r0) * size_t(cols);
+            std::vector<uint8_t>& buffer = tiles_[size_t(t)];
+            if (buffer.size() < rvl_max_encoded_size(count)) {
+                buffer.resize(rvl_max_encoded_size(count));
+            }
+            tile_sizes_[size_t(t)] = rvl_encode(src->ptr<uint16_t>(r0), count, buffer.data());
+        }
+    });
+
+    size_t total = frame_header_size + 4 * size_t(tiles);
+    for (size_t size : tile_sizes_) {
+        total += size;
+    }
+    out.resize(total);
+
+    uint8_t* p = out.data();
+    write_u32(p, frame_magic);
+    write_u16(p + 4, uint16_t(cols));
+    write_u16(p + 6, uint16_t(rows));
+    write_u16(p + 8, uint16_t(tiles));
+    write_u16(p + 10, 0);
+    p += frame_header_size;
+    for (int t = 0; t < tiles; ++t) {
+        write_u32(p, uint32_t(tile_sizes_[size_t(t)]));
+        p += 4;
+    }
+    for (int t = 0; t < tiles; ++t) {
+        std::memcpy(p, tiles_[size_t(t)].data(), tile_sizes_[size_t(t)]);
+        p += tile_sizes_[size_t(t)];
+    }
+}
+
+size_t depth_codec::max_frame_size(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return frame_header_size;
+    }
+    // 每个条带各自有 rvl_max_encoded_size 的末尾余量
+    const size_t tiles = size_t(tile_count(height, width));
+    return frame_header_size + 4 * tiles + rvl_max_encoded_size(size_t(width) * size_t(height)) +
+           (tiles - 1) * rvl_max_encoded_size(0);
+}
+
+bool depth_codec::peek(const uint8_t* data, size_t size, cv::Size& frame_size, size_t& frame_bytes) {
+    if (size < frame_header_size || read_u32(data) != frame_magic) {
+        return false;
+    }
+    const int tiles = read_u16(data + 8);
+    const size_t header = frame_header_size + 4 * size_t(tiles);
+    if (size < header) {
+        return false;
+    }
+    frame_size = cv::Size(read_u16(data + 4), read_u16(data + 6));
+    frame_bytes = header;
+    for (int t = 0; t < tiles; ++t) {
+        frame_bytes += read_u32(data + frame_header_size + 4 * size_t(t));
+    }
+    return true;
+}
+
+void depth_codec::decode(const uint8_t* data, size_t size, cv::Mat& out) {
+    RSD_TRACE_SCOPE("rvl_decode");
+    cv::Size frame_size;
+    size_t frame_bytes;
+    if (!peek(data, size, frame_size, frame_bytes) || frame_bytes > size) {
+        throw std::runtime_error("depth_codec: truncated or invalid frame");
+    }
+    const int rows = frame_size.height, cols = frame_size.width;
+    const int tiles = read_u16(data + 8);
+    if (tiles != (rows > 0 ? tile_count(rows, cols) : 0)) {
+        throw std::runtime_error("depth_codec: unexpected tile layout");
+    }
+    out.create(rows, cols, CV_16UC1);
+    if (!out.isContinuous()) {
+        out = cv::Mat(rows, cols, CV_16UC1);
+    }
+
+    // 各条带的起始位置
+    tile_sizes_.resize(size_t(tiles) + 1);
+    tile_sizes_[0] = frame_header_size + 4 * size_t(tiles);
+    for (int t = 0; t < tiles; ++t) {
+        tile_sizes_[size_t(t) + 1] = tile_sizes_[size_t(t)] + read_u32(data + frame_header_size + 4 * size_t(t));
+    }
+
+    std::atomic<bool> ok(true);
+    cv::parallel_for_(cv::Range(0, tiles), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int r0 = int(int64_t(t) * rows / tiles);
+            const int r1 = int(int64_t(t + 1) * rows / tiles);
+            const size_t begin = tile_sizes_[size_t(t)];
+            if (!rvl_decode(data + begin, tile_sizes_[size_t(t) + 1] - begin, out.ptr<uint16_t>(r0),
+                            size_t(r1 - r0) * size_t(cols))) {
+                ok = false;
+            }
+        }
+    });
+    if (!ok) {
+        throw std::runtime_error("depth_codec: corrupt frame data");
+    }
+}
+
+} // namespace rsd
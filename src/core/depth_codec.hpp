@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rsd {
+
+// RVL 无损深度压缩（run length + variable length）：
+// 像素序列交替编码为 “零的个数、非零的个数、各非零像素与前一个非零像素之差”，
+// 差值 zigzag 映射为非负数后按 3 位一组变长编码，每组占 4 位（最高位为续位）。
+// 深度图中空洞成片、相邻像素差值小，典型压缩到原大小的 20%~35%，编解码都是单次线性遍历
+
+// count 个像素压缩后的最大字节数（含末尾对齐）
+size_t rvl_max_encoded_size(size_t count);
+
+// 压缩 count 个连续像素到 dst（容量至少 rvl_max_encoded_size(count)），返回写入的字节数
+size_t rvl_encode(const uint16_t* src, size_t count, uint8_t* dst);
+
+// 解压 size 字节到 count 个像素；数据损坏或与 count 不符时返回 false
+bool rvl_decode(const uint8_t* src, size_t size, uint16_t* dst, size_t count);
+
+// 整帧编解码：按行分成若干条带分别压缩，条带之间互不依赖，可以并行编码和解码。
+// 帧格式（小端）：
+//   uint32 magic 'RVL1' | uint16 width | uint16 height | uint16 tiles | uint16 0 | uint32 tile_size[tiles] | 各条带数据
+// 条带数只由分辨率决定（约 64K 像素一条），与线程数无关，同一帧的压缩结果总是相同
+class depth_codec {
+public:
+    depth_codec() {}
+
+    // depth 为 CV_16UC1，out 的容量跨帧复用
+    void encode(const cv::Mat& depth, std::vector<uint8_t>& out);
+
+    // 解压整帧，out 按帧头中的尺寸分配（已分配则复用）；数据损坏时抛出 std::runtime_error
+    void decode(const uint8_t* data, size_t size, cv::Mat& out);
+
+    // width x height 的帧压缩后的最大字节数（含帧头与条带表），用于校验收到的长度
+    static size_t max_frame_size(int width, int height);
+
+    // 读取帧头中的尺寸和整帧字节数，不解压；数据不足或不是 RVL 帧时返回 false
+    static bool peek(const uint8_t* data, size_t size, cv::Size& frame_size, size_t& frame_bytes);
+
+private:
+    std::vector<std::vector<uint8_t>> tiles_;   // 各条带的压缩缓冲
+    std::vector<size_t> tile_sizes_;
+    cv::Mat contiguous_;                        // 输入不连续（ROI）时的拷贝
+};
+
+} // namespace rsd
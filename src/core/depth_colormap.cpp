@@ -0,0 +1,120 @@
+#include "core/depth_colormap.hpp"
+#include "core/trace.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 256 色调色板直接取自 OpenCV，保证与 applyColorMap 的显示效果一致
+cv::Mat make_palette(colormap map) {
+    cv::Mat ramp(1, 256, CV_8UC1);
+    for (int i = 0; i < 256; ++i) {
+        ramp.at<uint8_t>(0, i) = uint8_t(i);
+    }
+
+    cv::Mat palette;
+    switch (map) {
+    case colormap::jet:
+        cv::applyColorMap(ramp, palette, cv::COLORMAP_JET);
+        break;
+    case colormap::turbo:
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
+        cv::applyColorMap(ramp, palette, cv::COLORMAP_TURBO);
+        break;
+#else
+        throw std::runtime_error("depth_colorizer: COLORMAP_TURBO requires OpenCV 4.2 or newer");
+#endif
+    case colormap::grey:
+    default:
+        palette.create(1, 256, CV_8UC3);
+        for (int i = 0; i < 256; ++i) {
+            palette.at<cv::Vec3b>(0, i) = cv::Vec3b(uint8_t(i), uint8_t(i), uint8_t(i));
+        }
+        break;
+    }
+    return palette;
+}
+
+inline uint32_t pack_bgr(const cv::Vec3b& color) {
+    uint32_t packed = 0;
+    std::memcpy(&packed, &color[0], 3);
+    return packed;
+}
+
+} // namespace
+
+depth_colorizer::depth_colorizer(uint16_t min_depth, uint16_t max_depth, colormap map)
+    : min_depth_(min_depth), max_depth_(max_depth), map_(map), invalid_color_(0, 0, 0) {
+    rebuild();
+}
+
+void depth_colorizer::set_range(uint16_t min_depth, uint16_t max_depth) {
+    if (min_depth == min_depth_ && max_depth == max_depth_) {
+        return;
+    }
+    min_depth_ = min_depth;
+    max_depth_ = max_depth;
+    rebuild();
+}
+
+void depth_colorizer::set_colormap(colormap map) {
+    if (map == map_) {
+        return;
+    }
+    map_ = map;
+    rebuild();
+}
+
+void depth_colorizer::set_invalid_color(const cv::Vec3b& color) {
+    invalid_color_ = color;
+    rebuild();
+}
+
+void depth_colorizer::rebuild() {
+    if (max_depth_ < min_depth_) {
+        throw std::invalid_argument("depth_colorizer: max_depth must not be less than min_depth");
+    }
+
+    const cv::Mat palette = make_palette(map_);
+    const uint32_t span = uint32_t(max_depth_) - min_depth_;
+
+    lut_.resize(65536);
+    const uint32_t invalid = pack_bgr(invalid_color_);
+    for (uint32_t v = 0; v < 65536; ++v) {
+        if (v < min_depth_) {
+            lut_[v] = invalid;
+            continue;
+        }
+        const uint32_t c = (v < max_depth_ ? v : max_depth_) - min_depth_;
+        const uint32_t index = span > 0 ? (c * 255 + span / 2) / span : 255;
+        lut_[v] = pack_bgr(palette.at<cv::Vec3b>(0, int(index)));
+    }
+}
+
+void depth_colorizer::colorize(const cv::Mat& depth, cv::Mat& bgr) const {
+    RSD_TRACE_SCOPE("colorize");
+    CV_Assert(depth.type() == CV_16UC1);
+    bgr.create(depth.size(), CV_8UC3);
+
+    const uint32_t* lut = lut_.data();
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uint16_t* src = depth.ptr<uint16_t>(y);
+            uint8_t* dst = bgr.ptr<uint8_t>(y);
+            const int last = depth.cols - 1;
+            if (last < 0) {
+                continue;
+            }
+            // 每次写 4 字节，多出的 1 字节会被下一个像素覆盖；每行最后一个像素只写 3 字节
+            for (int x = 0; x < last; ++x) {
+                std::memcpy(dst + 3 * x, &lut[src[x]], 4);
+            }
+            std::memcpy(dst + 3 * last, &lut[src[last]], 3);
+        }
+    });
+}
+
+} // namespace rsd
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rsd {
+
+enum class colormap {
+    jet,
+    turbo,
+    grey
+};
+
+// 深度伪彩色：按固定范围预先生成 65536 项 uint16 -> BGR 查找表，
+// 每帧只需一次查表遍历，不再做 clip + normalize + applyColorMap 三次遍历。
+// 范围固定，因此颜色不会像逐帧 NORM_MINMAX 那样随画面内容闪烁
+class depth_colorizer {
+public:
+    depth_colorizer(uint16_t min_depth = 100, uint16_t max_depth = 6000, colormap map = colormap::jet);
+
+    // 修改范围或配色时才会重建查找表
+    void set_range(uint16_t min_depth, uint16_t max_depth);
+    void set_colormap(colormap map);
+    void set_invalid_color(const cv::Vec3b& color);
+
+    uint16_t min_depth() const { return min_depth_; }
+    uint16_t max_depth() const { return max_depth_; }
+    colormap map() const { return map_; }
+
+    // depth 为 CV_16UC1，bgr 输出为同尺寸 CV_8UC3（已分配则复用）
+    // 小于 min_depth 的像素（包括 0）输出无效颜色，大于 max_depth 的像素按 max_depth 着色
+    void colorize(const cv::Mat& depth, cv::Mat& bgr) const;
+
+private:
+    void rebuild();
+
+    uint16_t min_depth_;
+    uint16_t max_depth_;
+    colormap map_;
+    cv::Vec3b invalid_color_;
+    std::vector<uint32_t> lut_;   // 每项低 3 字节为 B、G、R
+};
+
+} // namespace rsd
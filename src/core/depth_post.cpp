@@ -0,0 +1,34 @@
+#include "core/depth_post.hpp"
+#include "core/rs2_adapter.hpp"
+
+#include <string>
+
+namespace rsd {
+
+cv::Mat depth_post::process(const rs2::frame& depth) {
+    // 深度图的只读视图，不拷贝也不修改滤波器输出
+    cv::Mat depth_image = depth_view(depth.as<rs2::video_frame>());
+
+    // 裁剪到设定的距离范围并量化为 8 位图像（单次遍历），输出缓冲由缓冲池回收
+    cv::Mat final_depth_image = buffers_.acquire(depth_image.size(), CV_8U);
+    clip_quantize(depth_image, final_depth_image, clip_);
+
+    // 裁剪 invalid band
+    cv::Rect roi(invalid_band_width_, 0, final_depth_image.cols - invalid_band_width_, final_depth_image.rows);
+    final_depth_image = final_depth_image(roi);
+
+    // 显示帧率：刷新周期内的平均值，文字只在刷新时重新格式化
+    const std::string& fps_text = fps_meter_.tick();
+
+    // 获取当前分辨率
+    cv::Size depth_size = final_depth_image.size();
+
+    cv::putText(final_depth_image, fps_text, cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+
+    // 显示当前分辨率
+    cv::putText(final_depth_image, "Resolution: " + std::to_string(depth_size.width) + "x" + std::to_string(depth_size.height), cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+
+    return final_depth_image;
+}
+
+} // namespace rsd
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "core/clip_quantize.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+
+namespace rsd {
+
+// version5 的后处理级：裁剪量化为 8 位、去除左侧 invalid band、叠加帧率和分辨率文字。
+// 输出缓冲取自 frame_pool，使用方（显示线程）释放后回到池中。bench 的 version5 整链测量调用同一个类
+class depth_post {
+public:
+    depth_post(frame_pool& buffers, const clip_range& clip, int invalid_band_width)
+        : buffers_(buffers), clip_(clip), invalid_band_width_(invalid_band_width) {}
+
+    // 只在一个线程中调用（帧率按调用间隔统计）；返回的图像引用池中的缓冲
+    cv::Mat process(const rs2::frame& depth);
+
+private:
+    frame_pool& buffers_;
+    clip_range clip_;
+    int invalid_band_width_;
+    fps_counter fps_meter_;
+};
+
+} // namespace rsd
@@ -0,0 +1,357 @@
+#include "core/depth_sequence.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rsd {
+
+namespace {
+
+const char sequence_magic[8] = {'R', 'S', 'D', 'S', 'E', 'Q', '1', 0};
+const uint32_t sequence_version = 1;
+const uint32_t record_magic = 0x314d5246;   // 'FRM1'
+const size_t alignment = 64;
+
+struct file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t codec;
+    uint32_t has_color;
+    float depth_scale;
+    uint64_t frame_count;
+    uint64_t index_offset;
+    rs2_intrinsics depth_intrinsics;
+    rs2_intrinsics color_intrinsics;
+    rs2_extrinsics depth_to_color;
+    uint8_t reserved[72];
+};
+
+struct record_header {
+    uint32_t magic;
+    uint32_t index;
+    sequence_entry entry;
+};
+
+static_assert(sizeof(rs2_intrinsics) == 48 && sizeof(rs2_extrinsics) == 48, "unexpected librealsense struct layout");
+static_assert(sizeof(file_header) == 256, "file header must stay 256 bytes");
+static_assert(sizeof(sequence_entry) == 48 && sizeof(record_header) == 56, "unexpected record layout");
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + alignment - 1) & ~uint64_t(alignment - 1);
+}
+
+size_t depth_bytes(const sequence_info& info) {
+    return size_t(info.depth_intrinsics.width) * info.depth_intrinsics.height * 2;
+}
+
+size_t color_bytes(const sequence_info& info) {
+    return size_t(info.color_intrinsics.width) * info.color_intrinsics.height * 3;
+}
+
+} // namespace
+
+sequence_writer::sequence_writer(const std::string& path, const sequence_info& info)
+    : info_(info), file_(std::fopen(path.c_str(), "wb")), offset_(0), ok_(true) {
+    if (!file_) {
+        throw std::runtime_error("sequence_writer: cannot create " + path);
+    }
+    // 大块顺序写，减少系统调用次数
+    buffer_.resize(4 << 20);
+    std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+
+    // 先写一个帧数和索引偏移为 0 的文件头，close 时回填
+    file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, sequence_magic, sizeof(sequence_magic));
+    header.version = sequence_version;
+    header.codec = uint32_t(info_.codec);
+    header.has_color = info_.has_color ? 1 : 0;
+    header.depth_scale = info_.depth_scale;
+    header.depth_intrinsics = info_.depth_intrinsics;
+    header.color_intrinsics = info_.color_intrinsics;
+    header.depth_to_color = info_.depth_to_color;
+    put(&header, sizeof(header));
+}
+
+sequence_writer::~sequence_writer() {
+    close();
+}
+
+bool sequence_writer::put(const void* data, size_t bytes) {
+    ok_ = std::fwrite(data, 1, bytes, file_) == bytes && ok_;
+    offset_ += bytes;
+    return ok_;
+}
+
+bool sequence_writer::put_mat(const cv::Mat& mat) {
+    if (mat.isContinuous()) {
+        return put(mat.data, mat.total() * mat.elemSize());
+    }
+    const size_t row_bytes = size_t(mat.cols) * mat.elemSize();
+    for (int y = 0; y < mat.rows; ++y) {
+        put(mat.ptr(y), row_bytes);
+    }
+    return ok_;
+}
+
+bool sequence_writer::pad() {
+    static const uint8_t zeros[alignment] = {};
+    return put(zeros, size_t(align_up(offset_) - offset_));
+}
+
+bool sequence_writer::write(const cv::Mat& depth, const cv::Mat& color, double depth_timestamp,
+                            double color_timestamp, uint64_t frame_number) {
+    RSD_TRACE_SCOPE("sequence_write");
+    if (!file_) {
+        return false;
+    }
+    if (depth.type() != CV_16UC1 || depth.size() != info_.depth_size()) {
+        throw std::invalid_argument("sequence_writer: depth must be CV_16UC1 of the recorded size");
+    }
+    const bool has_color = info_.has_color && !color.empty();
+    if (has_color && (color.type() != CV_8UC3 || color.size() != info_.color_size())) {
+        throw std::invalid_argument("sequence_writer: color must be CV_8UC3 of the recorded size");
+    }
+
+    if (info_.codec == sequence_codec::rvl) {
+        codec_.encode(depth, encoded_);
+    }
+
+    // 记录头之后依次是深度和彩色数据，偏移在写出前即可确定
+    record_header record;
+    record.magic = record_magic;
+    record.index = uint32_t(index_.size());
+    sequence_entry& entry = record.entry;
+    entry.depth_timestamp = depth_timestamp;
+    entry.color_timestamp = has_color ? color_timestamp : 0.0;
+    entry.frame_number = frame_number;
+    entry.depth_offset = align_up(offset_ + sizeof(record));
+    entry.depth_size = uint32_t(info_.codec == sequence_codec::rvl ? encoded_.size() : depth_bytes(info_));
+    entry.color_offset = has_color ? align_up(entry.depth_offset + entry.depth_size) : 0;
+    entry.color_size = has_color ? uint32_t(color_bytes(info_)) : 0;
+
+    put(&record, sizeof(record));
+    pad();
+    if (info_.codec == sequence_codec::rvl) {
+        put(encoded_.data(), encoded_.size());
+    } else {
+        put_mat(depth);
+    }
+    pad();
+    if (has_color) {
+        put_mat(color);
+        pad();
+    }
+
+    index_.push_back(entry);
+    return ok_;
+}
+
+bool sequence_writer::close() {
+    if (!file_) {
+        return ok_;
+    }
+    const uint64_t index_offset = offset_;
+    put(index_.data(), index_.size() * sizeof(sequence_entry));
+
+    // 索引写完后再回填文件头，中途断电的文件仍然可以按逐帧记录恢复
+    file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, sequence_magic, sizeof(sequence_magic));
+    header.version = sequence_version;
+    header.codec = uint32_t(info_.codec);
+    header.has_color = info_.has_color ? 1 : 0;
+    header.depth_scale = info_.depth_scale;
+    header.frame_count = index_.size();
+    header.index_offset = index_offset;
+    header.depth_intrinsics = info_.depth_intrinsics;
+    header.color_intrinsics = info_.color_intrinsics;
+    header.depth_to_color = info_.depth_to_color;
+    ok_ = std::fflush(file_) == 0 && ok_;
+    ok_ = std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header, 1, sizeof(header), file_) == sizeof(header) && ok_;
+    ok_ = std::fclose(file_) == 0 && ok_;
+    file_ = nullptr;
+    return ok_;
+}
+
+sequence_reader::sequence_reader(const std::string& path)
+    : path_(path), base_(nullptr), mapped_size_(0), entries_(nullptr), count_(0), indexed_(false), monotonic_(true) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("sequence_reader: cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(file_header)) {
+        ::close(fd);
+        throw std::runtime_error("sequence_reader: " + path + " is not a depth sequence");
+    }
+    // 只建立映射，不读取数据：打开多大的文件都只需要几次系统调用，页面在访问时才调入
+    void* mapped = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("sequence_reader: cannot map " + path);
+    }
+    base_ = static_cast<const uint8_t*>(mapped);
+    mapped_size_ = size_t(st.st_size);
+
+    try {
+        file_header header;
+        std::memcpy(&header, base_, sizeof(header));
+        if (std::memcmp(header.magic, sequence_magic, sizeof(sequence_magic)) != 0 ||
+            header.version != sequence_version || header.codec > uint32_t(sequence_codec::rvl)) {
+            throw std::runtime_error("sequence_reader: " + path + " is not a depth sequence");
+        }
+        info_.codec = sequence_codec(header.codec);
+        info_.depth_scale = header.depth_scale;
+        info_.has_color = header.has_color != 0;
+        info_.depth_intrinsics = header.depth_intrinsics;
+        info_.color_intrinsics = header.color_intrinsics;
+        info_.depth_to_color = header.depth_to_color;
+        if (info_.depth_intrinsics.width <= 0 || info_.depth_intrinsics.height <= 0 ||
+            (info_.has_color && (info_.color_intrinsics.width <= 0 || info_.color_intrinsics.height <= 0))) {
+            throw std::runtime_error("sequence_reader: " + path + " has an invalid stream size");
+        }
+
+        const uint64_t file_size = mapped_size_;
+        if (header.index_offset != 0 && header.index_offset % 8 == 0 && header.index_offset <= file_size &&
+            header.frame_count <= (file_size - header.index_offset) / sizeof(sequence_entry)) {
+            entries_ = reinterpret_cast<const sequence_entry*>(base_ + header.index_offset);
+            count_ = size_t(header.frame_count);
+            indexed_ = true;
+        } else {
+            rebuild_index(file_size);
+        }
+        validate(file_size);
+        monotonic_ = std::is_sorted(entries_, entries_ + count_,
+            [](const sequence_entry& a, const sequence_entry& b) { return a.depth_timestamp < b.depth_timestamp; });
+    } catch (...) {
+        ::munmap(const_cast<uint8_t*>(base_), mapped_size_);
+        throw;
+    }
+}
+
+sequence_reader::~sequence_reader() {
+    ::munmap(const_cast<uint8_t*>(base_), mapped_size_);
+}
+
+// 没有索引时从文件头之后逐条读取记录头，遇到魔数不符或数据不完整的记录即停止
+void sequence_reader::rebuild_index(uint64_t file_size) {
+    uint64_t offset = sizeof(file_header);
+    while (offset + sizeof(record_header) <= file_size) {
+        record_header record;
+        std::memcpy(&record, base_ + offset, sizeof(record));
+        const sequence_entry& entry = record.entry;
+        if (record.magic != record_magic || record.index != rebuilt_.size() ||
+            entry.depth_offset != align_up(offset + sizeof(record)) || entry.depth_size > file_size ||
+            entry.depth_offset + entry.depth_size > file_size) {
+            break;
+        }
+        uint64_t end = align_up(entry.depth_offset + entry.depth_size);
+        if (entry.color_offset != 0) {
+            if (entry.color_offset != end || entry.color_size > file_size || entry.color_offset + entry.color_size > file_size) {
+                break;
+            }
+            end = align_up(entry.color_offset + entry.color_size);
+        }
+        rebuilt_.push_back(entry);
+        offset = end;
+    }
+    count_ = rebuilt_.size();
+    entries_ = rebuilt_.data();
+}
+
+// 打开时检查一遍所有索引项，之后按序号访问不再做边界检查
+void sequence_reader::validate(uint64_t file_size) const {
+    const size_t expected_depth = depth_bytes(info_);
+    const size_t expected_color = color_bytes(info_);
+    for (size_t i = 0; i < count_; ++i) {
+        const sequence_entry& e = entries_[i];
+        const bool depth_ok = e.depth_offset >= sizeof(file_header) && e.depth_offset % 2 == 0 &&
+                              e.depth_size <= file_size - e.depth_offset &&
+                              (info_.codec == sequence_codec::rvl || e.depth_size == expected_depth);
+        const bool color_ok = e.color_offset == 0 ||
+                              (info_.has_color && e.color_offset >= sizeof(file_header) &&
+                               e.color_size == expected_color && e.color_size <= file_size - e.color_offset);
+        if (e.depth_offset > file_size || e.color_offset > file_size || !depth_ok || !color_ok) {
+            throw std::runtime_error("sequence_reader: " + path_ + " has a corrupt index entry");
+        }
+    }
+}
+
+const sequence_entry& sequence_reader::entry(size_t index) const {
+    if (index >= count_) {
+        throw std::out_of_range("sequence_reader: frame index out of range");
+    }
+    return entries_[index];
+}
+
+size_t sequence_reader::find(double timestamp_ms) const {
+    if (count_ == 0) {
+        throw std::out_of_range("sequence_reader: empty sequence");
+    }
+    if (!monotonic_) {
+        size_t best = 0;
+        double best_distance = std::abs(entries_[0].depth_timestamp - timestamp_ms);
+        for (size_t i = 1; i < count_; ++i) {
+            const double distance = std::abs(entries_[i].depth_timestamp - timestamp_ms);
+            if (distance < best_distance) {
+                best = i;
+                best_distance = distance;
+            }
+        }
+        return best;
+    }
+    const sequence_entry* end = entries_ + count_;
+    const sequence_entry* it = std::lower_bound(entries_, end, timestamp_ms,
+        [](const sequence_entry& e, double t) { return e.depth_timestamp < t; });
+    if (it == end) {
+        return count_ - 1;
+    }
+    if (it != entries_ && timestamp_ms - (it - 1)->depth_timestamp <= it->depth_timestamp - timestamp_ms) {
+        --it;
+    }
+    return size_t(it - entries_);
+}
+
+cv::Mat sequence_reader::depth(size_t index) {
+    const sequence_entry& e = entry(index);
+    const cv::Size size = info_.depth_size();
+    if (info_.codec == sequence_codec::z16) {
+        return cv::Mat(size, CV_16UC1, const_cast<uint8_t*>(base_ + e.depth_offset));
+    }
+    codec_.decode(base_ + e.depth_offset, e.depth_size, decoded_);
+    if (decoded_.size() != size) {
+        throw std::runtime_error("sequence_reader: frame size does not match the stream intrinsics");
+    }
+    return decoded_;
+}
+
+cv::Mat sequence_reader::color(size_t index) const {
+    const sequence_entry& e = entry(index);
+    if (e.color_offset == 0) {
+        return cv::Mat();
+    }
+    return cv::Mat(info_.color_size(), CV_8UC3, const_cast<uint8_t*>(base_ + e.color_offset));
+}
+
+void sequence_reader::prefetch(size_t index) const {
+    if (index >= count_) {
+        return;
+    }
+    const sequence_entry& e = entries_[index];
+    const uint64_t begin = e.depth_offset;
+    const uint64_t end = e.color_offset != 0 ? e.color_offset + e.color_size : e.depth_offset + e.depth_size;
+    const uint64_t page = uint64_t(::sysconf(_SC_PAGESIZE));
+    const uint64_t first = begin & ~(page - 1);
+    ::madvise(const_cast<uint8_t*>(base_ + first), size_t(end - first), MADV_WILLNEED);
+}
+
+} // namespace rsd
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "core/depth_codec.hpp"
+
+namespace rsd {
+
+// 深度序列文件（.rsq）：一个文件保存整段录像的深度帧（可选彩色帧）、逐帧时间戳索引和流内参，
+// 读取时整个文件 mmap 进来，打开耗时与文件大小无关，任意一帧可按序号或时间戳直接定位。
+// 文件布局（小端）：
+//   文件头 256 B：magic "RSDSEQ1" | 版本 | 深度编码 | 是否有彩色 | depth_scale | 帧数 | 索引偏移 | 深度/彩色内参 | 深度到彩色的外参
+//   逐帧记录：uint32 'FRM1' | uint32 序号 | sequence_entry | 深度数据 | 彩色数据（每段起点按 64 字节对齐）
+//   索引：frame_count 个 sequence_entry，close 时写在文件末尾，并回填文件头中的帧数和索引偏移
+// 写入中途退出（没有索引）的文件仍可读取：打开时顺序扫描逐帧记录重建索引，截断的最后一帧被忽略
+
+// 深度数据的存储方式
+enum class sequence_codec : uint32_t {
+    z16 = 0,   // 原始 uint16，读取时直接返回映射内存的视图
+    rvl = 1    // 每帧一个 depth_codec 压缩帧，读取时解压
+};
+
+// 整段序列共用的流信息
+struct sequence_info {
+    sequence_codec codec = sequence_codec::z16;
+    float depth_scale = 0.001f;
+    bool has_color = false;
+    rs2_intrinsics depth_intrinsics = rs2_intrinsics();
+    rs2_intrinsics color_intrinsics = rs2_intrinsics();
+    rs2_extrinsics depth_to_color = {{1, 0, 0, 0, 1, 0, 0, 0, 1}, {0, 0, 0}};
+
+    cv::Size depth_size() const { return cv::Size(depth_intrinsics.width, depth_intrinsics.height); }
+    cv::Size color_size() const { return cv::Size(color_intrinsics.width, color_intrinsics.height); }
+};
+
+// 一帧的索引项，逐帧记录头和文件末尾的索引使用同一布局（48 字节）
+struct sequence_entry {
+    double depth_timestamp;     // 毫秒
+    double color_timestamp;     // 毫秒，没有彩色时为 0
+    uint64_t frame_number;      // 深度帧号
+    uint64_t depth_offset;      // 深度数据在文件中的偏移
+    uint64_t color_offset;      // 彩色数据在文件中的偏移，0 表示该帧没有彩色
+    uint32_t depth_size;        // 字节数
+    uint32_t color_size;
+};
+
+// 顺序写入深度序列，只由一个线程使用
+class sequence_writer {
+public:
+    // 无法创建文件时抛出 std::runtime_error
+    sequence_writer(const std::string& path, const sequence_info& info);
+    ~sequence_writer();
+
+    sequence_writer(const sequence_writer&) = delete;
+    sequence_writer& operator=(const sequence_writer&) = delete;
+
+    // depth 为 CV_16UC1、color 为空或 CV_8UC3，尺寸须与 info 中的内参一致（否则抛出 std::invalid_argument）；
+    // 写盘失败时返回 false
+    bool write(const cv::Mat& depth, const cv::Mat& color, double depth_timestamp, double color_timestamp,
+               uint64_t frame_number);
+
+    // 写出索引并回填文件头，析构时自动调用；返回 false 表示写盘失败
+    bool close();
+
+    size_t size() const { return index_.size(); }
+    const sequence_info& info() const { return info_; }
+
+private:
+    bool put(const void* data, size_t bytes);
+    bool put_mat(const cv::Mat& mat);
+    bool pad();
+
+    sequence_info info_;
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    uint64_t offset_;                     // 已写入的字节数，即下一段数据的文件偏移
+    std::vector<sequence_entry> index_;
+    depth_codec codec_;
+    std::vector<uint8_t> encoded_;
+    bool ok_;
+};
+
+// 以 mmap 只读打开深度序列，可被多个线程同时读取（depth 对 rvl 文件除外，它使用内部解压缓冲）
+class sequence_reader {
+public:
+    // 文件不存在、不是深度序列或索引与文件大小不符时抛出 std::runtime_error
+    explicit sequence_reader(const std::string& path);
+    ~sequence_reader();
+
+    sequence_reader(const sequence_reader&) = delete;
+    sequence_reader& operator=(const sequence_reader&) = delete;
+
+    const sequence_info& info() const { return info_; }
+    const std::string& path() const { return path_; }
+    size_t size() const { return count_; }
+
+    // false 表示文件没有正常关闭，索引是打开时扫描逐帧记录重建的
+    bool indexed() const { return indexed_; }
+    // 深度时间戳单调不减（打开时检查一次）
+    bool monotonic() const { return monotonic_; }
+
+    // 序号越界时抛出 std::out_of_range
+    const sequence_entry& entry(size_t index) const;
+
+    // 深度时间戳最接近 timestamp_ms 的帧序号，序列为空时抛出 std::out_of_range。
+    // 时间戳单调不减时二分查找；时钟复位或多段录制拼接的文件顺序扫描，返回最先出现的最接近帧
+    size_t find(double timestamp_ms) const;
+
+    // z16：直接返回映射内存的只读视图，不拷贝，在 reader 析构前有效；
+    // rvl：解压到内部缓冲后返回，下一次调用会覆盖其内容
+    cv::Mat depth(size_t index);
+
+    // 映射内存中的彩色帧视图（CV_8UC3，只读，不拷贝），该帧没有彩色时返回空 Mat
+    cv::Mat color(size_t index) const;
+
+    // 映射内存中的原始数据（z16 像素或 rvl 压缩帧，以及 BGR 像素），长度见 entry
+    const uint8_t* depth_data(size_t index) const { return base_ + entry(index).depth_offset; }
+    const uint8_t* color_data(size_t index) const { return base_ + entry(index).color_offset; }
+
+    // 提示内核预读第 index 帧（顺序回放时提前一帧调用，把缺页从处理线程中移走）
+    void prefetch(size_t index) const;
+
+private:
+    void rebuild_index(uint64_t file_size);
+    void validate(uint64_t file_size) const;
+
+    std::string path_;
+    sequence_info info_;
+    const uint8_t* base_;
+    size_t mapped_size_;
+    const sequence_entry* entries_;       // 指向文件末尾的索引，或 rebuilt_
+    size_t count_;
+    bool indexed_;
+    bool monotonic_;
+    std::vector<sequence_entry> rebuilt_;
+    depth_codec codec_;
+    cv::Mat decoded_;
+};
+
+} // namespace rsd
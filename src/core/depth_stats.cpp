@@ -0,0 +1,375 @@
+#include "core/depth_stats.hpp"
+#include "core/simd.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 一段像素的最值、有效数与和，kernel 在已有结果上累加
+struct run_stats {
+    uint16_t min;      // 有效像素最小值，没有有效像素时保持 0xFFFF
+    uint16_t max;
+    uint32_t valid;
+    uint64_t sum;
+};
+
+// 向量 kernel 的 16 位计数器与 32 位累加器在这个长度内不会溢出
+const int max_run = 32768;
+
+typedef void (*run_fn)(const uint16_t* p, int count, run_stats& r);
+
+void run_scalar(const uint16_t* p, int count, run_stats& r) {
+    for (int x = 0; x < count; ++x) {
+        const uint16_t v = p[x];
+        if (v == 0) {
+            continue;
+        }
+        r.min = std::min(r.min, v);
+        r.max = std::max(r.max, v);
+        ++r.valid;
+        r.sum += v;
+    }
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("sse4.1")
+void run_sse41(const uint16_t* p, int count, run_stats& r) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi16(-1);
+    __m128i vmax = zero;
+    __m128i invalid = zero;
+    __m128i sum = zero;
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+        __m128i z = _mm_cmpeq_epi16(v, zero);
+        // 无效像素按 0xFFFF 参与取最小值
+        vmin = _mm_min_epu16(vmin, _mm_or_si128(v, z));
+        vmax = _mm_max_epu16(vmax, v);
+        invalid = _mm_sub_epi16(invalid, z);
+        sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero)));
+    }
+
+    const __m128i ones = _mm_set1_epi16(-1);
+    const uint16_t run_min = uint16_t(_mm_cvtsi128_si32(_mm_minpos_epu16(vmin)));
+    const uint16_t run_max = uint16_t(~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(vmax, ones))));
+    __m128i c = _mm_madd_epi16(invalid, _mm_set1_epi16(1));
+    c = _mm_add_epi32(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2)));
+    c = _mm_add_epi32(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128i s = _mm_add_epi64(_mm_cvtepu32_epi64(sum), _mm_cvtepu32_epi64(_mm_srli_si128(sum, 8)));
+
+    r.min = std::min(r.min, run_min);
+    r.max = std::max(r.max, run_max);
+    r.valid += uint32_t(x - _mm_cvtsi128_si32(c));
+    r.sum += uint64_t(_mm_cvtsi128_si64(s)) + uint64_t(_mm_extract_epi64(s, 1));
+    run_scalar(p + x, count - x, r);
+}
+
+RSD_TARGET("avx2")
+void run_avx2(const uint16_t* p, int count, run_stats& r) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vmin = _mm256_set1_epi16(-1);
+    __m256i vmax = zero;
+    __m256i invalid = zero;
+    __m256i sum = zero;
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + x));
+        __m256i z = _mm256_cmpeq_epi16(v, zero);
+        vmin = _mm256_min_epu16(vmin, _mm256_or_si256(v, z));
+        vmax = _mm256_max_epu16(vmax, v);
+        invalid = _mm256_sub_epi16(invalid, z);
+        sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_unpacklo_epi16(v, zero),
+                                                     _mm256_unpackhi_epi16(v, zero)));
+    }
+
+    const __m128i ones = _mm_set1_epi16(-1);
+    __m128i m = _mm_min_epu16(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+    __m128i n = _mm_max_epu16(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+    const uint16_t run_min = uint16_t(_mm_cvtsi128_si32(_mm_minpos_epu16(m)));
+    const uint16_t run_max = uint16_t(~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(n, ones))));
+
+    __m256i c8 = _mm256_madd_epi16(invalid, _mm256_set1_epi16(1));
+    __m128i c = _mm_add_epi32(_mm256_castsi256_si128(c8), _mm256_extracti128_si256(c8, 1));
+    c = _mm_add_epi32(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2)));
+    c = _mm_add_epi32(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m256i s4 = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(sum)),
+                                  _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sum, 1)));
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(s4), _mm256_extracti128_si256(s4, 1));
+
+    r.min = std::min(r.min, run_min);
+    r.max = std::max(r.max, run_max);
+    r.valid += uint32_t(x - _mm_cvtsi128_si32(c));
+    r.sum += uint64_t(_mm_cvtsi128_si64(s)) + uint64_t(_mm_extract_epi64(s, 1));
+    run_scalar(p + x, count - x, r);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+void run_neon(const uint16_t* p, int count, run_stats& r) {
+    const uint16x8_t zero = vdupq_n_u16(0);
+    uint16x8_t vmin = vdupq_n_u16(0xFFFF);
+    uint16x8_t vmax = zero;
+    uint16x8_t invalid = zero;
+    uint32x4_t sum = vdupq_n_u32(0);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        uint16x8_t v = vld1q_u16(p + x);
+        uint16x8_t z = vceqq_u16(v, zero);
+        vmin = vminq_u16(vmin, vorrq_u16(v, z));
+        vmax = vmaxq_u16(vmax, v);
+        invalid = vsubq_u16(invalid, z);
+        sum = vpadalq_u16(sum, v);
+    }
+
+    uint16x4_t m = vmin_u16(vget_low_u16(vmin), vget_high_u16(vmin));
+    m = vpmin_u16(m, m);
+    m = vpmin_u16(m, m);
+    uint16x4_t n = vmax_u16(vget_low_u16(vmax), vget_high_u16(vmax));
+    n = vpmax_u16(n, n);
+    n = vpmax_u16(n, n);
+    uint64x2_t c = vpaddlq_u32(vpaddlq_u16(invalid));
+    uint64x2_t s = vpaddlq_u32(sum);
+
+    r.min = std::min(r.min, vget_lane_u16(m, 0));
+    r.max = std::max(r.max, vget_lane_u16(n, 0));
+    r.valid += uint32_t(x - int(vgetq_lane_u64(c, 0) + vgetq_lane_u64(c, 1)));
+    r.sum += vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1);
+    run_scalar(p + x, count - x, r);
+}
+
+#endif
+
+run_fn select_run() {
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: return run_avx2;
+    case simd::isa::sse41: return run_sse41;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: return run_neon;
+#endif
+    default: return run_scalar;
+    }
+}
+
+// 直方图统计不判断 0 值，无效像素都落在第 0 格，合并时再减掉。
+// 奇偶像素分别计入两份直方图，相邻像素落在同一格时不会串成一条读改写依赖链
+void count_row(const uint16_t* p, int count, int shift, uint32_t* even, uint32_t* odd) {
+    int x = 0;
+    for (; x + 2 <= count; x += 2) {
+        ++even[p[x] >> shift];
+        ++odd[p[x + 1] >> shift];
+    }
+    if (x < count) {
+        ++even[p[x] >> shift];
+    }
+}
+
+} // namespace
+
+float depth_summary::percentile(double p) const {
+    if (histogram.empty() || valid == 0) {
+        return 0.0f;
+    }
+    const double target = std::min(1.0, std::max(0.0, p)) * double(valid);
+    const int width = 1 << histogram_shift;
+    uint64_t below = 0;
+    for (size_t b = 0; b < histogram.size(); ++b) {
+        const uint32_t n = histogram[b];
+        if (n > 0 && double(below + n) >= target) {
+            // 在格内 [下边界, 上边界] 线性插值，并限制在实际的最值范围内
+            const double fraction = std::max(0.0, target - double(below)) / double(n);
+            const double value = double(b << histogram_shift) + fraction * (width - 1);
+            return float(std::min(double(max), std::max(double(min), value)));
+        }
+        below += n;
+    }
+    return float(max);
+}
+
+depth_stats::depth_stats(const depth_stats_options& options) : options_(options) {
+    if (options.histogram_shift < 0 || options.histogram_shift > 15) {
+        throw std::invalid_argument("depth_stats: histogram_shift must be in [0, 15]");
+    }
+}
+
+const depth_summary& depth_stats::compute(const cv::Mat& depth) {
+    compute_region(depth, cv::Rect(0, 0, depth.cols, depth.rows), frame_);
+    return frame_;
+}
+
+const std::vector<depth_summary>& depth_stats::compute(const cv::Mat& depth, const std::vector<cv::Rect>& rois) {
+    rois_.resize(rois.size());
+    for (size_t i = 0; i < rois.size(); ++i) {
+        compute_region(depth, rois[i] & cv::Rect(0, 0, depth.cols, depth.rows), rois_[i]);
+    }
+    return rois_;
+}
+
+void depth_stats::compute_region(const cv::Mat& depth, const cv::Rect& roi, depth_summary& out) {
+    CV_Assert(depth.type() == CV_16UC1);
+
+    const int shift = options_.histogram_shift;
+    const size_t bins = options_.histogram ? (size_t(0xFFFF) >> shift) + 1 : 0;
+    // 逐项复位而不是整体赋值，保留直方图缓冲
+    out.min = out.max = 0;
+    out.argmin = out.argmax = cv::Point();
+    out.valid = out.sum = 0;
+    out.histogram_shift = shift;
+    out.histogram.assign(bins, 0);
+    out.total = uint64_t(roi.area());
+    if (roi.area() <= 0) {
+        return;
+    }
+
+    // 分块数与线程数相当即可，分块过多只会增加直方图合并的开销
+    const int stripes = std::max(1, std::min(roi.height, std::min(2 * cv::getNumThreads(), 32)));
+    partials_.resize(stripes);
+    partial_histograms_.resize(2 * bins * stripes);
+
+    const run_fn run = select_run();
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; ++s) {
+            partial& part = partials_[s];
+            part.min = 0x10000;
+            part.max = 0;
+            part.argmin = part.argmax = 0;
+            part.valid = part.sum = 0;
+            uint32_t* histogram = bins ? &partial_histograms_[2 * bins * s] : 0;
+            if (histogram) {
+                std::fill(histogram, histogram + 2 * bins, 0u);
+            }
+
+            const int y0 = int(int64_t(roi.height) * s / stripes);
+            const int y1 = int(int64_t(roi.height) * (s + 1) / stripes);
+            for (int y = y0; y < y1; ++y) {
+                const uint16_t* row = depth.ptr<uint16_t>(roi.y + y) + roi.x;
+                run_stats r = {0xFFFF, 0, 0, 0};
+                for (int x = 0; x < roi.width; x += max_run) {
+                    run(row + x, std::min(max_run, roi.width - x), r);
+                }
+                if (histogram) {
+                    count_row(row, roi.width, shift, histogram, histogram + bins);
+                }
+
+                part.valid += r.valid;
+                part.sum += r.sum;
+                // 只有本行刷新了最值才回头定位，行按顺序处理，严格比较保证取到第一次出现的位置
+                if (r.valid > 0 && r.min < part.min) {
+                    part.min = r.min;
+                    part.argmin = int64_t(y) * roi.width + (std::find(row, row + roi.width, r.min) - row);
+                }
+                if (r.max > part.max) {
+                    part.max = r.max;
+                    part.argmax = int64_t(y) * roi.width + (std::find(row, row + roi.width, r.max) - row);
+                }
+            }
+        }
+    });
+
+    // 分块按行顺序合并，同值时保留靠前的位置
+    uint32_t min = 0x10000;
+    int64_t argmin = 0;
+    int64_t argmax = 0;
+    for (int s = 0; s < stripes; ++s) {
+        const partial& part = partials_[s];
+        out.valid += part.valid;
+        out.sum += part.sum;
+        if (part.min < min) {
+            min = part.min;
+            argmin = part.argmin;
+        }
+        if (part.max > out.max) {
+            out.max = uint16_t(part.max);
+            argmax = part.argmax;
+        }
+        if (bins) {
+            const uint32_t* histogram = &partial_histograms_[2 * bins * s];
+            for (size_t b = 0; b < bins; ++b) {
+                out.histogram[b] += histogram[b] + histogram[bins + b];
+            }
+        }
+    }
+    if (bins) {
+        out.histogram[0] -= uint32_t(out.total - out.valid);
+    }
+    if (out.valid > 0) {
+        out.min = uint16_t(min);
+        out.argmin = cv::Point(roi.x + int(argmin % roi.width), roi.y + int(argmin / roi.width));
+        out.argmax = cv::Point(roi.x + int(argmax % roi.width), roi.y + int(argmax / roi.width));
+    }
+}
+
+depth_stats_window::depth_stats_window(size_t frames) : capacity_(frames) {
+    if (frames == 0) {
+        throw std::invalid_argument("depth_stats_window: window must hold at least one frame");
+    }
+}
+
+void depth_stats_window::clear() {
+    history_.clear();
+    summary_ = depth_summary();
+}
+
+void depth_stats_window::push(const depth_summary& frame) {
+    if (!history_.empty() && frame.histogram.size() != summary_.histogram.size()) {
+        throw std::invalid_argument("depth_stats_window: histogram layout changed, call clear() first");
+    }
+
+    // 移出最旧的一帧并减掉它的直方图，直方图缓冲留给新帧复用
+    std::vector<uint32_t> storage;
+    if (history_.size() == capacity_) {
+        storage.swap(history_.front().histogram);
+        for (size_t b = 0; b < storage.size(); ++b) {
+            summary_.histogram[b] -= storage[b];
+        }
+        history_.pop_front();
+    }
+    const bool first = history_.empty();
+    history_.push_back(depth_summary());
+    history_.back().histogram.swap(storage);
+    history_.back() = frame;
+
+    if (first) {
+        summary_.histogram = frame.histogram;
+        summary_.histogram_shift = frame.histogram_shift;
+    } else {
+        for (size_t b = 0; b < frame.histogram.size(); ++b) {
+            summary_.histogram[b] += frame.histogram[b];
+        }
+    }
+
+    // 最值与计数由窗口内各帧结果合并，同值时取较早的帧
+    summary_.min = summary_.max = 0;
+    summary_.valid = summary_.total = summary_.sum = 0;
+    bool has_min = false;
+    for (std::deque<depth_summary>::const_iterator it = history_.begin(); it != history_.end(); ++it) {
+        summary_.valid += it->valid;
+        summary_.total += it->total;
+        summary_.sum += it->sum;
+        if (it->valid == 0) {
+            continue;
+        }
+        if (!has_min || it->min < summary_.min) {
+            summary_.min = it->min;
+            summary_.argmin = it->argmin;
+            has_min = true;
+        }
+        if (it->max > summary_.max) {
+            summary_.max = it->max;
+            summary_.argmax = it->argmax;
+        }
+    }
+}
+
+} // namespace rsd
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace rsd {
+
+struct depth_stats_options {
+    bool histogram;        // 是否统计直方图（百分位数需要直方图）
+    int histogram_shift;   // 直方图每格宽度为 2^shift 个深度单位，0 时为精确直方图
+
+    explicit depth_stats_options(bool histogram = true, int histogram_shift = 4)
+        : histogram(histogram), histogram_shift(histogram_shift) {}
+};
+
+// 一帧（或一个 ROI）Z16 深度的统计结果，深度为 0 的像素视为无效，不参与统计
+struct depth_summary {
+    uint16_t min;               // 有效像素的最小 / 最大值，没有有效像素时为 0
+    uint16_t max;
+    cv::Point argmin;           // 最小 / 最大值第一次出现的位置（行优先，整帧坐标）
+    cv::Point argmax;
+    uint64_t valid;             // 有效像素数
+    uint64_t total;             // 像素总数
+    uint64_t sum;               // 有效像素深度之和
+    int histogram_shift;
+    std::vector<uint32_t> histogram;   // 未开启直方图时为空
+
+    depth_summary() : min(0), max(0), valid(0), total(0), sum(0), histogram_shift(0) {}
+
+    double mean() const { return valid > 0 ? double(sum) / double(valid) : 0.0; }
+    double valid_ratio() const { return total > 0 ? double(valid) / double(total) : 0.0; }
+
+    // p 取 [0, 1]，在直方图格内线性插值，精度为一个格宽；没有直方图或有效像素时返回 0
+    float percentile(double p) const;
+};
+
+// 单次遍历计算 min / max / argmin / argmax / 有效像素数 / 直方图：
+// 行内最值与计数用 SIMD（AVX2 / SSE4.1 / NEON），各分块并行后合并；
+// 只有某行出现新的最值时才回头在该行中定位，直方图在同一遍中统计。
+// 分块的部分结果与直方图缓冲跨帧复用，稳态下没有内存分配
+class depth_stats {
+public:
+    explicit depth_stats(const depth_stats_options& options = depth_stats_options());
+
+    // 整帧统计，返回的引用在下一次 compute 前有效
+    const depth_summary& compute(const cv::Mat& depth);
+    // 分别统计每个 ROI（超出图像的部分会被裁掉）
+    const std::vector<depth_summary>& compute(const cv::Mat& depth, const std::vector<cv::Rect>& rois);
+
+private:
+    // 一个行分块的统计结果，最值位置为 ROI 内的行优先下标
+    struct partial {
+        uint32_t min;      // 0x10000 表示还没有有效像素
+        uint32_t max;
+        int64_t argmin;
+        int64_t argmax;
+        uint64_t valid;
+        uint64_t sum;
+    };
+
+    void compute_region(const cv::Mat& depth, const cv::Rect& roi, depth_summary& out);
+
+    depth_stats_options options_;
+    std::vector<partial> partials_;
+    std::vector<uint32_t> partial_histograms_;   // 每个分块两段（奇偶像素）
+    depth_summary frame_;
+    std::vector<depth_summary> rois_;
+};
+
+// 最近 N 帧的滑动窗口统计：每帧只加入新直方图、减去移出的直方图，
+// 最值由窗口内各帧的结果合并，不需要重新遍历像素
+class depth_stats_window {
+public:
+    explicit depth_stats_window(size_t frames);
+
+    void push(const depth_summary& frame);
+    void clear();
+
+    size_t size() const { return history_.size(); }
+    // 窗口内所有帧合并后的统计（argmin / argmax 为窗口内最值首次出现所在帧的位置）
+    const depth_summary& summary() const { return summary_; }
+
+private:
+    size_t capacity_;
+    std::deque<depth_summary> history_;
+    depth_summary summary_;
+};
+
+} // namespace rsd
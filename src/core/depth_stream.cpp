@@ -0,0 +1,609 @@
+#include "core/depth_stream.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace rsd {
+
+namespace {
+
+const uint32_t stream_magic = 0x53445352;   // "RSDS"
+const uint16_t stream_version = 1;
+const uint16_t flag_delta = 1;
+const uint16_t flag_color = 2;
+
+// 读完消息头后，消息剩余部分的等待上限；超时视为连接失效
+const int payload_timeout_ms = 5000;
+
+// 消息头，按小端原样写出
+struct stream_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint64_t sequence;
+    uint64_t frame_number;
+    double depth_timestamp;
+    double color_timestamp;
+    float depth_scale;
+    uint16_t width;
+    uint16_t height;
+    uint16_t color_width;
+    uint16_t color_height;
+    uint32_t depth_bytes;
+    uint32_t color_bytes;
+    rs2_intrinsics depth_intrinsics;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(stream_header) == 112, "stream_header layout changed");
+
+// "unix:<路径>" 或 "<主机>:<端口>"
+struct socket_address {
+    bool local;
+    std::string path;
+    std::string host;
+    std::string port;
+};
+
+socket_address parse_address(const std::string& address) {
+    socket_address result;
+    if (address.compare(0, 5, "unix:") == 0) {
+        result.local = true;
+        result.path = address.substr(5);
+        if (result.path.empty() || result.path.size() >= sizeof(sockaddr_un().sun_path)) {
+            throw std::invalid_argument("stream address: bad unix socket path in " + address);
+        }
+        return result;
+    }
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size()) {
+        throw std::invalid_argument("stream address must be unix:<path> or <host>:<port>, got " + address);
+    }
+    result.local = false;
+    result.host = address.substr(0, colon);
+    result.port = address.substr(colon + 1);
+    return result;
+}
+
+// 打开监听套接字；TCP 时 host 为空表示所有地址
+int open_listener(const socket_address& address) {
+    if (address.local) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.path.c_str(), sizeof(addr.sun_path) - 1);
+        ::unlink(address.path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 8) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* list = nullptr;
+    if (::getaddrinfo(address.host.empty() ? nullptr : address.host.c_str(), address.port.c_str(), &hints, &list) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        const int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(fd, 8) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(list);
+    return fd;
+}
+
+int open_connection(const socket_address& address) {
+    if (address.local) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.path.c_str(), sizeof(addr.sun_path) - 1);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* list = nullptr;
+    if (::getaddrinfo(address.host.empty() ? "localhost" : address.host.c_str(), address.port.c_str(), &hints, &list) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(list);
+    return fd;
+}
+
+// 每帧一次 sendmsg 写出全部分段，被信号打断或只写出一部分时从断点继续
+bool send_all(int fd, iovec* iov, int count) {
+    while (count > 0) {
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = size_t(std::min(count, IOV_MAX));
+        const ssize_t written = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        size_t remaining = size_t(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+// 与基准帧逐像素相减（模 2^16），差值 zigzag 映射：不变的像素为 0，小的正负变化都是小的正数
+void zigzag_delta(const cv::Mat& current, const cv::Mat& reference, cv::Mat& delta) {
+    delta.create(current.size(), CV_16UC1);
+    for (int y = 0; y < current.rows; ++y) {
+        const uint16_t* c = current.ptr<uint16_t>(y);
+        const uint16_t* r = reference.ptr<uint16_t>(y);
+        uint16_t* d = delta.ptr<uint16_t>(y);
+        for (int x = 0; x < current.cols; ++x) {
+            const uint16_t diff = uint16_t(c[x] - r[x]);
+            d[x] = uint16_t((diff << 1) ^ uint16_t(-(diff >> 15)));
+        }
+    }
+}
+
+// zigzag_delta 的逆操作，结果直接写回基准帧
+void apply_zigzag_delta(const cv::Mat& delta, cv::Mat& reference) {
+    for (int y = 0; y < delta.rows; ++y) {
+        const uint16_t* d = delta.ptr<uint16_t>(y);
+        uint16_t* r = reference.ptr<uint16_t>(y);
+        for (int x = 0; x < delta.cols; ++x) {
+            r[x] = uint16_t(r[x] + ((d[x] >> 1) ^ uint16_t(-(d[x] & 1))));
+        }
+    }
+}
+
+} // namespace
+
+bool parse_stream_args(int argc, char** argv, stream_server_options& options) {
+    bool enabled = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--stream") {
+            if (i + 1 >= argc) throw std::invalid_argument("--stream requires an address such as unix:/tmp/rsd_depth.sock");
+            options.address = argv[++i];
+            enabled = true;
+        } else if (arg == "--stream-keyframe") {
+            if (i + 1 >= argc) throw std::invalid_argument("--stream-keyframe requires a frame count");
+            options.keyframe_interval = std::atoi(argv[++i]);
+        } else if (arg == "--stream-no-delta") {
+            options.delta = false;
+        }
+    }
+    return enabled;
+}
+
+// ---------------------------------------------------------------------------
+// stream_server
+
+stream_server::stream_server(const stream_server_options& options)
+    : options_(options), listen_fd_(-1), buffers_(16), stop_(false), retired_dropped_(0), next_sequence_(0),
+      sent_(0), key_frames_(0), raw_bytes_(0), bytes_(0) {
+    const socket_address address = parse_address(options.address);
+    listen_fd_ = open_listener(address);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("stream_server: cannot listen on " + options.address + ": " + std::strerror(errno));
+    }
+    if (address.local) {
+        unix_path_ = address.path;
+    }
+    accept_thread_ = std::thread(&stream_server::accept_loop, this);
+}
+
+stream_server::~stream_server() {
+    stop_ = true;
+    accept_thread_.join();
+    reap(true);
+    ::close(listen_fd_);
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+    }
+}
+
+void stream_server::accept_loop() {
+    trace::set_thread_name("stream_accept");
+    const bool tcp = unix_path_.empty();
+    while (!stop_) {
+        reap(false);
+        pollfd p = {listen_fd_, POLLIN, 0};
+        if (::poll(&p, 1, 100) <= 0) {
+            continue;
+        }
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (int(sessions_.size()) >= options_.max_clients) {
+            ::close(fd);
+            continue;
+        }
+        if (tcp) {
+            // 每帧一次写出，不需要 Nagle 合并小包
+            const int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        sessions_.emplace_back(new session);
+        session& s = *sessions_.back();
+        s.fd = fd;
+        s.thread = std::thread(&stream_server::serve, this, std::ref(s));
+    }
+}
+
+// 回收已断开的会话；all 为 true 时断开全部会话
+void stream_server::reap(bool all) {
+    std::list<std::unique_ptr<session>> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = sessions_.begin(); it != sessions_.end();) {
+            if (all || (*it)->done) {
+                retired_dropped_ += (*it)->slot.overwritten();
+                finished.splice(finished.end(), sessions_, it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (std::unique_ptr<session>& s : finished) {
+        // 让阻塞在 sendmsg 中的发送线程立即返回
+        ::shutdown(s->fd, SHUT_RDWR);
+        s->thread.join();
+        ::close(s->fd);
+    }
+}
+
+void stream_server::serve(session& s) {
+    trace::set_thread_name("stream_send");
+    item frame;
+    while (!stop_) {
+        if (!s.slot.take(frame, 100)) {
+            continue;
+        }
+        if (!write_frame(s, frame)) {
+            break;
+        }
+        frame = item();   // 尽早释放帧内存
+    }
+    s.done = true;
+}
+
+bool stream_server::write_frame(session& s, const item& frame) {
+    RSD_TRACE_SCOPE("stream_send");
+    const cv::Mat& depth = frame.depth;
+
+    // 差分帧比上一个关键帧还大（场景大幅变化）时改发关键帧
+    bool key = !options_.delta || s.reference.size() != depth.size() || s.since_key + 1 >= options_.keyframe_interval;
+    if (!key) {
+        zigzag_delta(depth, s.reference, s.delta);
+        s.codec.encode(s.delta, s.encoded);
+        key = s.encoded.size() >= s.key_bytes;
+    }
+    if (key) {
+        s.codec.encode(depth, s.encoded);
+        s.key_bytes = s.encoded.size();
+        s.since_key = 0;
+    } else {
+        ++s.since_key;
+    }
+    if (options_.delta) {
+        depth.copyTo(s.reference);
+    }
+
+    const cv::Mat& color = frame.color;
+    stream_header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = stream_magic;
+    header.version = stream_version;
+    header.flags = uint16_t((key ? 0 : flag_delta) | (color.empty() ? 0 : flag_color));
+    header.sequence = frame.sequence;
+    header.frame_number = frame.frame_number;
+    header.depth_timestamp = frame.depth_timestamp;
+    header.color_timestamp = frame.color_timestamp;
+    header.depth_scale = frame.depth_scale;
+    header.width = uint16_t(depth.cols);
+    header.height = uint16_t(depth.rows);
+    header.color_width = uint16_t(color.cols);
+    header.color_height = uint16_t(color.rows);
+    header.depth_bytes = uint32_t(s.encoded.size());
+    header.color_bytes = uint32_t(color.total() * color.elemSize());
+    header.depth_intrinsics = frame.depth_intrinsics;
+
+    // 消息头、压缩深度和彩色各行直接作为分散写出的分段，不拼接
+    std::vector<iovec> iov;
+    iov.reserve(2 + size_t(color.isContinuous() ? 1 : color.rows));
+    iov.push_back(iovec{&header, sizeof(header)});
+    iov.push_back(iovec{s.encoded.data(), s.encoded.size()});
+    if (!color.empty()) {
+        const size_t row_bytes = size_t(color.cols) * color.elemSize();
+        if (color.isContinuous()) {
+            iov.push_back(iovec{const_cast<uint8_t*>(color.ptr<uint8_t>()), row_bytes * size_t(color.rows)});
+        } else {
+            for (int y = 0; y < color.rows; ++y) {
+                iov.push_back(iovec{const_cast<uint8_t*>(color.ptr<uint8_t>(y)), row_bytes});
+            }
+        }
+    }
+    if (!send_all(s.fd, iov.data(), int(iov.size()))) {
+        return false;
+    }
+
+    ++sent_;
+    if (key) {
+        ++key_frames_;
+    }
+    raw_bytes_ += sizeof(header) + depth.total() * 2 + header.color_bytes;
+    bytes_ += sizeof(header) + header.depth_bytes + header.color_bytes;
+    return true;
+}
+
+void stream_server::post(item&& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frame.sequence = next_sequence_++;
+    for (std::unique_ptr<session>& s : sessions_) {
+        item copy = frame;
+        s->slot.put(std::move(copy));
+    }
+}
+
+void stream_server::send(const cv::Mat& depth, const rs2_intrinsics& depth_intrinsics, float depth_scale,
+                         double depth_timestamp, uint64_t frame_number, const cv::Mat& color, double color_timestamp) {
+    CV_Assert(depth.type() == CV_16UC1 && (color.empty() || color.type() == CV_8UC3));
+    if (depth.cols > 0xffff || depth.rows > 0xffff || color.cols > 0xffff || color.rows > 0xffff) {
+        throw std::invalid_argument("stream_server: frame too large");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sessions_.empty()) {
+            ++next_sequence_;
+            return;
+        }
+    }
+    item frame;
+    frame.depth = depth;
+    frame.color = color;
+    // 外部内存在调用方继续运行后可能失效，先拷贝到池中的缓冲
+    if (!depth.u) {
+        frame.depth = buffers_.acquire(depth.size(), depth.type());
+        depth.copyTo(frame.depth);
+    }
+    if (!color.empty() && !color.u) {
+        frame.color = buffers_.acquire(color.size(), color.type());
+        color.copyTo(frame.color);
+    }
+    frame.depth_intrinsics = depth_intrinsics;
+    frame.depth_scale = depth_scale;
+    frame.depth_timestamp = depth_timestamp;
+    frame.color_timestamp = color_timestamp;
+    frame.frame_number = frame_number;
+    post(std::move(frame));
+}
+
+void stream_server::send(const rs2::depth_frame& depth, const rs2::video_frame& color) {
+    item frame;
+    frame.depth = depth_view(depth);
+    frame.depth_owner = depth;
+    frame.depth_intrinsics = depth.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    frame.depth_scale = depth.get_units();
+    frame.depth_timestamp = depth.get_timestamp();
+    frame.frame_number = depth.get_frame_number();
+    frame.color_timestamp = 0;
+    if (color) {
+        frame.color = frame_view(color, CV_8UC3);
+        frame.color_owner = color;
+        frame.color_timestamp = color.get_timestamp();
+    }
+    post(std::move(frame));
+}
+
+void stream_server::send(const rs2::depth_frame& depth) {
+    send(depth, rs2::video_frame(rs2::frame()));
+}
+
+stream_server::stats stream_server::get_stats() const {
+    stats s;
+    s.sent = sent_;
+    s.key_frames = key_frames_;
+    s.raw_bytes = raw_bytes_;
+    s.bytes = bytes_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.clients = sessions_.size();
+    s.dropped = retired_dropped_;
+    for (const std::unique_ptr<session>& session : sessions_) {
+        s.dropped += session->slot.overwritten();
+    }
+    return s;
+}
+
+// ---------------------------------------------------------------------------
+// stream_client
+
+stream_client::stream_client(const std::string& address) : fd_(-1), stats_() {
+    fd_ = open_connection(parse_address(address));
+    if (fd_ < 0) {
+        throw std::runtime_error("stream_client: cannot connect to " + address + ": " + std::strerror(errno));
+    }
+}
+
+stream_client::~stream_client() {
+    disconnect();
+}
+
+void stream_client::disconnect() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool stream_client::read_exact(void* data, size_t size, int timeout_ms) {
+    uint8_t* p = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        pollfd fd = {fd_, POLLIN, 0};
+        const int ready = ::poll(&fd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        const ssize_t n = ::recv(fd_, p, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+bool stream_client::next(stream_frame& out, int timeout_ms) {
+    if (fd_ < 0) {
+        return false;
+    }
+    // 只在消息边界上等待超时，消息开始后按较长的上限读完，保证不会读到半条消息
+    pollfd fd = {fd_, POLLIN, 0};
+    if (::poll(&fd, 1, timeout_ms) <= 0) {
+        return false;
+    }
+    stream_header header;
+    if (!read_exact(&header, sizeof(header), payload_timeout_ms)) {
+        disconnect();
+        return false;
+    }
+    RSD_TRACE_SCOPE("stream_receive");
+    const bool delta = (header.flags & flag_delta) != 0;
+    const bool has_color = (header.flags & flag_color) != 0;
+    // 在读取数据之前校验各段长度：彩色长度须与标志和尺寸一致，深度长度不超过该尺寸压缩后的上限
+    const uint32_t expected_color = has_color ? uint32_t(header.color_width) * header.color_height * 3 : 0;
+    if (header.magic != stream_magic || header.version != stream_version || header.color_bytes != expected_color ||
+        header.depth_bytes > depth_codec::max_frame_size(header.width, header.height)) {
+        disconnect();
+        throw std::runtime_error("stream_client: corrupt stream header");
+    }
+
+    buffer_.resize(header.depth_bytes);
+    if (!read_exact(buffer_.data(), buffer_.size(), payload_timeout_ms)) {
+        disconnect();
+        return false;
+    }
+    if (has_color) {
+        color_.create(header.color_height, header.color_width, CV_8UC3);
+        if (!read_exact(color_.data, header.color_bytes, payload_timeout_ms)) {
+            disconnect();
+            return false;
+        }
+    }
+
+    // 解码失败后流已无法恢复（差分基准不可信），断开连接
+    try {
+        if (delta) {
+            if (depth_.rows != header.height || depth_.cols != header.width) {
+                throw std::runtime_error("stream_client: delta frame without a key frame");
+            }
+            codec_.decode(buffer_.data(), buffer_.size(), delta_);
+            if (delta_.size() != depth_.size()) {
+                throw std::runtime_error("stream_client: delta frame size mismatch");
+            }
+            apply_zigzag_delta(delta_, depth_);
+        } else {
+            codec_.decode(buffer_.data(), buffer_.size(), depth_);
+            if (depth_.rows != header.height || depth_.cols != header.width) {
+                throw std::runtime_error("stream_client: key frame size mismatch");
+            }
+        }
+    } catch (...) {
+        disconnect();
+        throw;
+    }
+
+    out.sequence = header.sequence;
+    out.frame_number = header.frame_number;
+    out.depth_timestamp = header.depth_timestamp;
+    out.color_timestamp = header.color_timestamp;
+    out.depth_scale = header.depth_scale;
+    out.depth_intrinsics = header.depth_intrinsics;
+    out.key_frame = !delta;
+    out.bytes = sizeof(header) + header.depth_bytes + header.color_bytes;
+    out.depth = depth_;
+    out.color = has_color ? color_ : cv::Mat();
+
+    ++stats_.frames;
+    if (!delta) {
+        ++stats_.key_frames;
+    }
+    stats_.bytes += out.bytes;
+    return true;
+}
+
+} // namespace rsd
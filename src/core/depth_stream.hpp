@@ -0,0 +1,179 @@
+#pragma once
+
+#include "core/depth_codec.hpp"
+#include "core/frame_pool.hpp"
+#include "core/mailbox.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsd {
+
+// 套接字深度流：服务端把 Z16 深度（可选 BGR 彩色）按帧推送给任意多个客户端，客户端用 stream_client 接收。
+// 深度用 depth_codec（RVL）无损压缩；启用差分时发送与该客户端上一帧之差（zigzag 映射后压缩），
+// 静止场景中大部分像素不变，压缩后的数据量远小于关键帧。每个客户端一个发送线程和一个单槽邮箱：
+// 客户端或网络跟不上时只保留最新一帧、旧帧直接丢弃，不会阻塞采集循环，也不影响其他客户端。
+// 每帧的消息头、压缩深度和彩色用一次 sendmsg 分散写出，不拼接到同一缓冲。
+//
+// 地址格式："unix:<路径>" 为 Unix 域套接字，"<主机>:<端口>" 为 TCP（主机为空时监听所有地址）
+//
+// 消息格式（小端）：固定 112 字节的消息头（magic 'RSDS'、标志、序号、帧号、时间戳、深度单位、尺寸、
+// 各段字节数、深度内参）| RVL 压缩帧 | 彩色像素（按行紧密排列）
+
+struct stream_server_options {
+    std::string address = "unix:/tmp/rsd_depth.sock";
+    bool delta = true;             // 差分编码；关闭时每帧都是关键帧
+    int keyframe_interval = 30;    // 至多每隔多少帧发送一个关键帧（新客户端的第一帧总是关键帧）
+    int max_clients = 8;           // 超出的连接直接关闭
+};
+
+// 从命令行读取：--stream <address> 启用推流，--stream-keyframe <n> 关键帧间隔，--stream-no-delta 关闭差分。
+// 给出 --stream 时返回 true；参数格式错误时抛出 std::invalid_argument
+bool parse_stream_args(int argc, char** argv, stream_server_options& options);
+
+// 推流服务端：构造时开始监听，析构时断开所有客户端。send() 可在任意一个线程调用
+class stream_server {
+public:
+    struct stats {
+        size_t clients;        // 当前连接数
+        uint64_t sent;         // 已发送的帧数（所有客户端合计）
+        uint64_t dropped;      // 因客户端跟不上被新帧覆盖的帧数
+        uint64_t key_frames;
+        uint64_t raw_bytes;    // 未压缩时的字节数
+        uint64_t bytes;        // 实际发送的字节数
+    };
+
+    // 无法监听时抛出 std::runtime_error，地址格式错误时抛出 std::invalid_argument
+    explicit stream_server(const stream_server_options& options = stream_server_options());
+    ~stream_server();
+
+    stream_server(const stream_server&) = delete;
+    stream_server& operator=(const stream_server&) = delete;
+
+    const stream_server_options& options() const { return options_; }
+
+    // 把一帧交给所有客户端，立即返回；没有客户端时几乎没有开销。
+    // depth 为 CV_16UC1，color 为空或 CV_8UC3；Mat 不持有内存时先拷贝到缓冲池，持有内存时按引用共享，调用方之后不能再修改
+    void send(const cv::Mat& depth, const rs2_intrinsics& depth_intrinsics, float depth_scale, double depth_timestamp,
+              uint64_t frame_number, const cv::Mat& color = cv::Mat(), double color_timestamp = 0);
+    // 内参、深度单位和时间戳取自帧本身，发送完成前持有帧，不拷贝；color 可为空帧
+    void send(const rs2::depth_frame& depth, const rs2::video_frame& color);
+    void send(const rs2::depth_frame& depth);
+
+    stats get_stats() const;
+
+private:
+    struct item {
+        cv::Mat depth;
+        cv::Mat color;
+        rs2::frame depth_owner;
+        rs2::frame color_owner;
+        rs2_intrinsics depth_intrinsics;
+        float depth_scale;
+        double depth_timestamp;
+        double color_timestamp;
+        uint64_t frame_number;
+        uint64_t sequence;
+    };
+
+    struct session {
+        int fd;
+        std::thread thread;
+        mailbox<item> slot;
+        std::atomic<bool> done;
+
+        // 以下只在该会话的发送线程中使用
+        depth_codec codec;
+        std::vector<uint8_t> encoded;
+        cv::Mat reference;     // 客户端当前持有的上一帧，差分的基准
+        cv::Mat delta;
+        int since_key;
+        size_t key_bytes;      // 上一个关键帧压缩后的字节数
+
+        session() : fd(-1), done(false), since_key(0), key_bytes(0) {}
+    };
+
+    void post(item&& frame);
+    void accept_loop();
+    void serve(session& s);
+    bool write_frame(session& s, const item& frame);
+    void reap(bool all);
+
+    stream_server_options options_;
+    std::string unix_path_;    // Unix 域套接字的路径，析构时删除
+    int listen_fd_;
+    frame_pool buffers_;
+    std::atomic<bool> stop_;
+    std::thread accept_thread_;
+
+    mutable std::mutex mutex_;                      // 保护 sessions_ 与 retired_dropped_
+    std::list<std::unique_ptr<session>> sessions_;
+    uint64_t retired_dropped_;                      // 已断开客户端的丢帧数
+    uint64_t next_sequence_;
+
+    std::atomic<uint64_t> sent_;
+    std::atomic<uint64_t> key_frames_;
+    std::atomic<uint64_t> raw_bytes_;
+    std::atomic<uint64_t> bytes_;
+};
+
+// 客户端收到的一帧。depth / color 指向客户端内部的缓冲，在下一次 next() 之前有效，且不能修改（差分解码的基准）
+struct stream_frame {
+    uint64_t sequence = 0;          // 服务端的发送序号，不连续说明中间的帧被丢弃
+    uint64_t frame_number = 0;
+    double depth_timestamp = 0;
+    double color_timestamp = 0;
+    float depth_scale = 0;
+    rs2_intrinsics depth_intrinsics;
+    bool key_frame = false;
+    size_t bytes = 0;               // 这一帧在线路上的字节数
+    cv::Mat depth;                  // CV_16UC1
+    cv::Mat color;                  // CV_8UC3，没有彩色时为空
+};
+
+// 推流客户端：连接服务端并逐帧接收、解压，只由一个线程使用
+class stream_client {
+public:
+    struct stats {
+        uint64_t frames;
+        uint64_t key_frames;
+        uint64_t bytes;
+    };
+
+    // 无法连接时抛出 std::runtime_error
+    explicit stream_client(const std::string& address);
+    ~stream_client();
+
+    stream_client(const stream_client&) = delete;
+    stream_client& operator=(const stream_client&) = delete;
+
+    // 等待下一帧至多 timeout_ms 毫秒；超时或连接断开时返回 false（用 connected() 区分）。
+    // 数据损坏时抛出 std::runtime_error
+    bool next(stream_frame& out, int timeout_ms = 1000);
+
+    bool connected() const { return fd_ >= 0; }
+    stats get_stats() const { return stats_; }
+
+private:
+    bool read_exact(void* data, size_t size, int timeout_ms);
+    void disconnect();
+
+    int fd_;
+    depth_codec codec_;
+    std::vector<uint8_t> buffer_;
+    cv::Mat depth_;
+    cv::Mat delta_;
+    cv::Mat color_;
+    stats stats_;
+};
+
+} // namespace rsd
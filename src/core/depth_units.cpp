@@ -0,0 +1,44 @@
+#include "core/depth_units.hpp"
+#include "core/pixel_pipeline.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rsd {
+
+uint16_t meters_to_units(float meters, float depth_scale) {
+    if (!(depth_scale > 0)) {
+        throw std::invalid_argument("meters_to_units: depth_scale must be positive");
+    }
+    const double units = std::floor(double(meters) / double(depth_scale) + 0.5);
+    return uint16_t(std::min(65535.0, std::max(0.0, units)));
+}
+
+void normalize_minmax(const cv::Mat& depth, cv::Mat& out) {
+    RSD_TRACE_SCOPE("normalize");
+    CV_Assert(depth.type() == CV_16UC1);
+    out.create(depth.size(), CV_8UC1);
+
+    double lo = 0, hi = 0;
+    cv::minMaxLoc(depth, &lo, &hi);
+    if (hi <= lo) {
+        out.setTo(cv::Scalar(0));
+        return;
+    }
+
+    // 减去最小值后范围为 [0, range]，定点乘以 255 / range
+    const int min_value = int(lo);
+    const uint32_t range = uint32_t(hi - lo);
+    const auto kernel = pixel::offset(-min_value) | pixel::fixed_scale(255.0 / range, range);
+    pixel::apply<uint8_t>(kernel, depth, out);
+}
+
+void export_meters(const cv::Mat& depth, float depth_scale, cv::Mat& out) {
+    RSD_TRACE_SCOPE("export_meters");
+    CV_Assert(depth.type() == CV_16UC1);
+    pixel::apply<float>(pixel::scale(depth_scale), depth, out);
+}
+
+} // namespace rsd
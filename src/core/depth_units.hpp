@@ -0,0 +1,27 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+
+namespace rsd {
+
+// 整数深度模式：处理链中的深度始终是设备单位的 Z16（CV_16UC1），depth_scale（每单位多少米）只作为元数据
+// 随帧传递（帧来源、录制元数据、共享内存与推流的消息头中都有）。米制的阈值在进入处理链前用
+// meters_to_units 换算成设备单位，裁剪、归一化、空洞填充、平滑和统计都在整数上完成，
+// 只有 export_meters 这一个出口把深度换算成浮点米。
+// 与逐帧转换为 CV_32F 相比，中间图像每像素从 4 字节降到 2 字节（显示用的 8 位图为 1 字节），
+// 并且可以用 16 位整数 SIMD
+
+// 米 -> 设备单位，四舍五入并截断到 [0, 65535]；depth_scale 不为正时抛出 std::invalid_argument
+uint16_t meters_to_units(float meters, float depth_scale);
+
+// 最小-最大归一化到 8 位：out = round((v - min) * 255 / (max - min))，min / max 取整幅图（含 0），
+// 与先转换为米再 cv::normalize(NORM_MINMAX, CV_8U) 的结果相同（最多因舍入相差 1）。
+// 只用整数运算：最值用 cv::minMaxLoc 在 Z16 上求，缩放为 uint32 定点乘法。
+// depth 为 CV_16UC1，out 分配为同尺寸 CV_8UC1（已分配则复用）；整幅图同值时输出全 0
+void normalize_minmax(const cv::Mat& depth, cv::Mat& out);
+
+// 浮点出口：Z16 换算为米（CV_32FC1），用于需要米制浮点的导出（npy-f32 录制等）
+void export_meters(const cv::Mat& depth, float depth_scale, cv::Mat& out);
+
+} // namespace rsd
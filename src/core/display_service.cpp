@@ -0,0 +1,224 @@
+#include "core/display_service.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace rsd {
+
+namespace {
+
+// 按键队列的上限，处理线程长时间不取时丢弃最早的按键
+const size_t max_pending_keys = 32;
+
+std::atomic<bool> interrupted(false);
+
+extern "C" void on_interrupt(int) {
+    interrupted.store(true);
+}
+
+} // namespace
+
+display_options parse_display_args(int argc, char** argv) {
+    display_options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--display-fps") {
+            if (i + 1 >= argc) throw std::invalid_argument("--display-fps requires a rate");
+            options.fps = std::atof(argv[++i]);
+        }
+    }
+    return options;
+}
+
+display_service::display_service(const display_options& options)
+    : options_(options), buffers_(16), stop_(false), window_closed_(false), rendered_(0) {}
+
+display_service::~display_service() {}
+
+display_service::window& display_service::find_window(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<window>& w = windows_[name];
+    if (!w) {
+        w.reset(new window);
+        w->name = name;
+        w->flags = cv::WINDOW_AUTOSIZE;
+        w->created = false;
+    }
+    return *w;
+}
+
+void display_service::create_window(const std::string& name, int flags, cv::Size size) {
+    window& w = find_window(name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    w.flags = flags;
+    w.size = size;
+}
+
+void display_service::post(const std::string& name, item&& value) {
+    find_window(name).slot.put(std::move(value));
+}
+
+void display_service::show(const std::string& window, const cv::Mat& image) {
+    if (options_.headless || image.empty()) {
+        return;
+    }
+    if (image.u) {
+        post(window, item{image, rs2::frame()});
+        return;
+    }
+    // 外部内存在处理线程继续运行后可能失效，先拷贝到池中的缓冲
+    cv::Mat copy = buffers_.acquire(image.size(), image.type());
+    image.copyTo(copy);
+    post(window, item{copy, rs2::frame()});
+}
+
+void display_service::show(const std::string& window, const cv::Mat& image, const rs2::frame& owner) {
+    if (options_.headless || image.empty()) {
+        return;
+    }
+    post(window, item{image, owner});
+}
+
+int display_service::poll_key() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keys_.empty()) {
+        return -1;
+    }
+    const int key = keys_.front();
+    keys_.pop_front();
+    return key;
+}
+
+void display_service::request_stop() {
+    stop_ = true;
+}
+
+bool display_service::stopping() const {
+    return stop_;
+}
+
+void display_service::render() {
+    std::vector<window*> windows;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : windows_) {
+            windows.push_back(entry.second.get());
+        }
+    }
+    // 窗口只增不删，指针在锁外仍然有效
+    for (window* w : windows) {
+        if (w->created && cv::getWindowProperty(w->name, cv::WND_PROP_AUTOSIZE) < 0) {
+            window_closed_ = true;
+        }
+        item latest;
+        if (!w->slot.try_take(latest)) {
+            continue;
+        }
+        if (!w->created) {
+            int flags;
+            cv::Size size;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                flags = w->flags;
+                size = w->size;
+            }
+            cv::namedWindow(w->name, flags);
+            if (size.width > 0 && size.height > 0) {
+                cv::resizeWindow(w->name, size.width, size.height);
+            }
+            w->created = true;
+        }
+        cv::imshow(w->name, latest.image);
+        ++rendered_;
+    }
+}
+
+void display_service::run(const std::function<bool()>& process) {
+    stop_ = false;
+    interrupted = false;
+    std::atomic<bool> done(false);
+    std::exception_ptr error;
+
+    // Ctrl+C 只请求退出，让处理循环正常收尾
+    void (*previous)(int) = std::signal(SIGINT, on_interrupt);
+
+    std::thread worker([&] {
+        trace::set_thread_name("process");
+        try {
+            while (!stop_ && process()) {
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        done = true;
+    });
+
+    const std::chrono::microseconds period(options_.fps > 0 ? int64_t(1000000 / options_.fps) : 0);
+    std::chrono::steady_clock::time_point next_frame = std::chrono::steady_clock::now();
+    bool shown = false;
+    while (!done) {
+        if (interrupted) {
+            request_stop();
+        }
+        if (options_.headless) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        {
+            RSD_TRACE_SCOPE("display");
+            render();
+        }
+        shown = shown || rendered_ > 0;
+
+        // 落后于刷新节拍时不追赶，从当前时刻重新计时
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        next_frame = std::max(next_frame + period, now);
+        const int wait_ms = std::max(1, int(std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - now).count()));
+        if (!shown) {
+            // 还没有窗口时 waitKey 不等待，直接休眠
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+            continue;
+        }
+        const int key = cv::waitKey(wait_ms);
+        if (key >= 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (keys_.size() >= max_pending_keys) {
+                keys_.pop_front();
+            }
+            keys_.push_back(key);
+        }
+    }
+
+    worker.join();
+    std::signal(SIGINT, previous);
+    if (shown) {
+        cv::destroyAllWindows();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+display_service::stats display_service::get_stats() const {
+    stats s;
+    s.posted = 0;
+    s.skipped = 0;
+    s.rendered = rendered_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : windows_) {
+        s.posted += entry.second->slot.posted();
+        s.skipped += entry.second->slot.overwritten();
+    }
+    return s;
+}
+
+} // namespace rsd
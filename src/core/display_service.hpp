@@ -0,0 +1,103 @@
+#pragma once
+
+#include "core/frame_pool.hpp"
+#include "core/mailbox.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rsd {
+
+struct display_options {
+    bool headless = false;   // 不创建任何窗口，show() 提交的帧直接丢弃
+    double fps = 60;         // 刷新率（显示器频率），不大于 0 时有新帧就刷新
+};
+
+// 从命令行读取：--headless 无窗口运行，--display-fps <n> 刷新率
+// 参数格式错误时抛出 std::invalid_argument
+display_options parse_display_args(int argc, char** argv);
+
+// 显示服务：处理与显示解耦。处理循环在后台线程运行，每帧把结果交给 show()，
+// 每个窗口一个单槽邮箱，只保留最新的一帧、从不等待；主线程（HighGUI 要求）按刷新率取出最新帧显示，
+// 并把按键转交给处理线程。处理吞吐因此与 GUI 无关，显示跟不上时只是跳过中间的帧。
+// 无窗口模式下 show() 几乎没有开销，Ctrl+C 请求退出，处理循环可以照常收尾（停止数据源、写完录制）
+class display_service {
+public:
+    struct stats {
+        uint64_t posted;     // show() 提交的帧数
+        uint64_t rendered;   // 实际显示的帧数
+        uint64_t skipped;    // 未显示就被更新的帧覆盖的帧数
+    };
+
+    explicit display_service(const display_options& options = display_options());
+    ~display_service();
+
+    display_service(const display_service&) = delete;
+    display_service& operator=(const display_service&) = delete;
+
+    const display_options& options() const { return options_; }
+    bool headless() const { return options_.headless; }
+
+    // 窗口属性，在窗口第一次显示时生效：flags 同 cv::namedWindow；size 非空时设置初始窗口大小，
+    // 缩放由窗口完成，处理线程不需要逐帧 cv::resize
+    void create_window(const std::string& name, int flags = cv::WINDOW_AUTOSIZE, cv::Size size = cv::Size());
+
+    // 任意线程调用：提交窗口的最新一帧，覆盖尚未显示的上一帧。
+    // image 不持有内存（例如直接包装 librealsense 帧数据的 Mat）时先拷贝到缓冲池；
+    // 给出 owner 时改为持有该帧直到显示完成，不拷贝
+    void show(const std::string& window, const cv::Mat& image);
+    void show(const std::string& window, const cv::Mat& image, const rs2::frame& owner);
+
+    // 任意线程调用：取出一次按键（cv::waitKey 的返回值），没有按键时返回 -1
+    int poll_key();
+
+    // 在主线程调用：process 在后台线程中循环调用，返回 false 或 request_stop() 后不再调用；
+    // 主线程同时按刷新率显示各窗口的最新帧。等后台线程结束后返回，process 抛出的异常在这里重新抛出
+    void run(const std::function<bool()>& process);
+
+    void request_stop();
+    bool stopping() const;
+
+    // 已显示过的窗口被用户关闭
+    bool window_closed() const { return window_closed_; }
+
+    stats get_stats() const;
+
+private:
+    struct item {
+        cv::Mat image;
+        rs2::frame owner;
+    };
+
+    struct window {
+        std::string name;
+        int flags;
+        cv::Size size;
+        bool created;
+        mailbox<item> slot;
+    };
+
+    window& find_window(const std::string& name);
+    void post(const std::string& name, item&& value);
+    void render();
+
+    display_options options_;
+    frame_pool buffers_;
+    mutable std::mutex mutex_;                            // 保护 windows_ 与 keys_
+    std::map<std::string, std::unique_ptr<window>> windows_;
+    std::deque<int> keys_;
+    std::atomic<bool> stop_;
+    std::atomic<bool> window_closed_;
+    std::atomic<uint64_t> rendered_;
+};
+
+} // namespace rsd
@@ -0,0 +1,107 @@
+#include "core/filter_chain.hpp"
+#include "core/spatial_filter.hpp"
+#include "core/temporal_filter.hpp"
+#include "core/trace.hpp"
+
+#include <sstream>
+
+namespace rsd {
+
+const char* filter_name(filter_kind kind) {
+    switch (kind) {
+    case filter_kind::decimation: return "decimation";
+    case filter_kind::spatial: return "spatial";
+    case filter_kind::temporal: return "temporal";
+    case filter_kind::hole_filling: return "hole";
+    default: return "unknown";
+    }
+}
+
+std::string filter_chain_config::describe() const {
+    std::ostringstream text;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i > 0) text << '>';
+        if ((order[i] == filter_kind::spatial && native_spatial) ||
+            (order[i] == filter_kind::temporal && native_temporal)) {
+            text << "native_";
+        }
+        text << filter_name(order[i]) << '(';
+        switch (order[i]) {
+        case filter_kind::decimation:
+            text << decimation_magnitude;
+            break;
+        case filter_kind::spatial:
+            text << spatial_magnitude << ',' << spatial_alpha << ',' << spatial_delta << ',' << spatial_holes_fill;
+            break;
+        case filter_kind::temporal:
+            text << temporal_alpha << ',' << temporal_delta << ',' << temporal_persistence;
+            break;
+        case filter_kind::hole_filling:
+            text << hole_filling_mode;
+            break;
+        }
+        text << ')';
+    }
+    return text.str();
+}
+
+filter_chain::filter_chain(const filter_chain_config& config)
+    : config_(config) {
+    for (filter_kind kind : config_.order) {
+        switch (kind) {
+        case filter_kind::decimation: {
+            std::shared_ptr<rs2::decimation_filter> f(new rs2::decimation_filter());
+            f->set_option(RS2_OPTION_FILTER_MAGNITUDE, config_.decimation_magnitude);
+            filters_.push_back(f);
+            break;
+        }
+        case filter_kind::spatial: {
+            if (config_.native_spatial) {
+                filters_.push_back(make_spatial_block(spatial_filter_options(
+                    int(config_.spatial_magnitude), config_.spatial_alpha,
+                    config_.spatial_delta, int(config_.spatial_holes_fill))));
+                break;
+            }
+            std::shared_ptr<rs2::spatial_filter> f(new rs2::spatial_filter());
+            f->set_option(RS2_OPTION_FILTER_MAGNITUDE, config_.spatial_magnitude);
+            f->set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, config_.spatial_alpha);
+            f->set_option(RS2_OPTION_FILTER_SMOOTH_DELTA, config_.spatial_delta);
+            f->set_option(RS2_OPTION_HOLES_FILL, config_.spatial_holes_fill);
+            filters_.push_back(f);
+            break;
+        }
+        case filter_kind::temporal: {
+            if (config_.native_temporal) {
+                filters_.push_back(make_temporal_block(temporal_filter_options(
+                    config_.temporal_alpha, config_.temporal_delta, int(config_.temporal_persistence))));
+                break;
+            }
+            std::shared_ptr<rs2::temporal_filter> f(new rs2::temporal_filter());
+            f->set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, config_.temporal_alpha);
+            f->set_option(RS2_OPTION_FILTER_SMOOTH_DELTA, config_.temporal_delta);
+            f->set_option(RS2_OPTION_HOLES_FILL, config_.temporal_persistence);
+            filters_.push_back(f);
+            break;
+        }
+        case filter_kind::hole_filling: {
+            std::shared_ptr<rs2::hole_filling_filter> f(new rs2::hole_filling_filter());
+            f->set_option(RS2_OPTION_HOLES_FILL, config_.hole_filling_mode);
+            filters_.push_back(f);
+            break;
+        }
+        }
+    }
+}
+
+rs2::frame filter_chain::process(rs2::frame frame) const {
+    // 按 filter_kind 的顺序，每种滤波器一个计时点
+    static const trace::site sites[] = {trace::site("decimation"), trace::site("spatial"),
+                                        trace::site("temporal"), trace::site("hole_filling")};
+    for (size_t i = 0; i < filters_.size(); ++i) {
+        trace::scope timer(sites[int(config_.order[i])]);
+        frame = filters_[i]->process(frame);
+    }
+    return frame;
+}
+
+} // namespace rsd
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rsd {
+
+enum class filter_kind {
+    decimation,
+    spatial,
+    temporal,
+    hole_filling
+};
+
+const char* filter_name(filter_kind kind);
+
+// 滤波链配置：滤波器顺序与各自参数，默认值与 version4/version5 相同
+struct filter_chain_config {
+    std::vector<filter_kind> order = {filter_kind::spatial, filter_kind::temporal,
+                                      filter_kind::hole_filling, filter_kind::decimation};
+
+    float decimation_magnitude = 2;
+    float spatial_magnitude = 3;
+    float spatial_alpha = 0.5f;
+    float spatial_delta = 50;
+    float spatial_holes_fill = 5;
+    bool native_spatial = false;      // 用 rsd::native_spatial_filter 代替 rs2::spatial_filter
+    float temporal_alpha = 0.4f;
+    float temporal_delta = 20;
+    float temporal_persistence = 3;   // temporal_filter 的 RS2_OPTION_HOLES_FILL
+    bool native_temporal = false;     // 用 rsd::native_temporal_filter 代替 rs2::temporal_filter
+    float hole_filling_mode = 1;      // 0: fill_from_left, 1: farest_from_around, 2: nearest_from_around
+
+    // 形如 "spatial(3,0.5,50,5)>temporal(0.4,20,3)>hole(1)>decimation(2)"，原生滤波器记为 native_spatial / native_temporal
+    std::string describe() const;
+};
+
+// 按配置构建的 rs2 滤波链，每个实例持有独立的滤波器状态（temporal 的历史帧等）
+class filter_chain {
+public:
+    explicit filter_chain(const filter_chain_config& config = filter_chain_config());
+
+    rs2::frame process(rs2::frame frame) const;
+
+    const filter_chain_config& config() const { return config_; }
+
+private:
+    filter_chain_config config_;
+    std::vector<std::shared_ptr<rs2::filter>> filters_;
+};
+
+} // namespace rsd
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace rsd {
+
+// 帧率显示：按刷新周期内的平均值计算，文字只在刷新时重新格式化，
+// 代替每帧 1.0 / duration 加 std::to_string 的瞬时帧率
+class fps_counter {
+public:
+    explicit fps_counter(double refresh_seconds = 0.5)
+        : refresh_(refresh_seconds), frames_(0), fps_(0.0), text_("FPS: --"),
+          last_(std::chrono::steady_clock::now()) {}
+
+    // 每帧调用一次，返回当前的显示文字
+    const std::string& tick() {
+        ++frames_;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - last_).count();
+        if (elapsed >= refresh_) {
+            fps_ = frames_ / elapsed;
+            frames_ = 0;
+            last_ = now;
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "FPS: %.1f", fps_);
+            text_ = buffer;
+        }
+        return text_;
+    }
+
+    double fps() const { return fps_; }
+    const std::string& text() const { return text_; }
+
+private:
+    double refresh_;
+    int frames_;
+    double fps_;
+    std::string text_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+} // namespace rsd
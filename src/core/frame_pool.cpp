@@ -0,0 +1,50 @@
+#include "core/frame_pool.hpp"
+
+#include <stdexcept>
+
+namespace rsd {
+
+frame_pool::frame_pool(size_t capacity) : capacity_(capacity), allocations_(0) {
+    if (capacity == 0) {
+        throw std::invalid_argument("frame_pool: capacity must be positive");
+    }
+    buffers_.reserve(capacity);
+}
+
+bool frame_pool::idle(const cv::Mat& buffer) {
+    // 引用计数只剩池自己这一份；用原子读取，保证其他线程对缓冲的最后一次使用已经结束
+    return buffer.u && CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+cv::Mat frame_pool::acquire(cv::Size size, int type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t reusable = buffers_.size();
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+        const cv::Mat& buffer = buffers_[i];
+        if (!idle(buffer)) {
+            continue;
+        }
+        if (buffer.size() == size && buffer.type() == type) {
+            return buffer;
+        }
+        reusable = i;
+    }
+
+    ++allocations_;
+    cv::Mat buffer(size, type);
+    if (buffers_.size() < capacity_) {
+        buffers_.push_back(buffer);
+    } else if (reusable < buffers_.size()) {
+        // 分辨率变化后旧规格的缓冲不再使用，直接替换
+        buffers_[reusable] = buffer;
+    }
+    return buffer;
+}
+
+uint64_t frame_pool::allocations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocations_;
+}
+
+} // namespace rsd
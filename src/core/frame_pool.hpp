@@ -0,0 +1,41 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace rsd {
+
+// 处理循环的输出缓冲池：按尺寸和类型回收 cv::Mat，稳态下不再分配内存。
+// 池中每块缓冲只有池自己持有引用时视为空闲；acquire 返回的 Mat（及其 ROI、拷贝）
+// 全部析构后缓冲自动回到池中，不需要显式归还，因此也可以随 frame_packet 交给其他线程。
+// 需要写入的数据一律先放进池中的缓冲，不再 const_cast 改写 librealsense 的帧内存
+class frame_pool {
+public:
+    // capacity：池中最多保留的缓冲块数，应不少于同时在用的输出数
+    explicit frame_pool(size_t capacity = 8);
+
+    frame_pool(const frame_pool&) = delete;
+    frame_pool& operator=(const frame_pool&) = delete;
+
+    // 取一块 size x type 的缓冲，内容未初始化；线程安全
+    // 没有空闲的同规格缓冲时分配新的一块，池满时替换一块空闲的其他规格缓冲，
+    // 全部在用时返回不入池的临时缓冲（计入 allocations）
+    cv::Mat acquire(cv::Size size, int type);
+    cv::Mat acquire(int rows, int cols, int type) { return acquire(cv::Size(cols, rows), type); }
+
+    // 累计分配次数，分辨率不变时应在最初几帧后停止增长
+    uint64_t allocations() const;
+
+private:
+    static bool idle(const cv::Mat& buffer);
+
+    mutable std::mutex mutex_;
+    std::vector<cv::Mat> buffers_;
+    size_t capacity_;
+    uint64_t allocations_;
+};
+
+} // namespace rsd
@@ -0,0 +1,477 @@
+#include "core/frame_source.hpp"
+#include "core/depth_sequence.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace rsd {
+
+bool frame_source::next(rs2::frameset& frames) {
+    if (max_frames_ > 0 && frame_count_ >= max_frames_) {
+        return false;
+    }
+    RSD_TRACE_SCOPE("capture");
+    if (!read(frames)) {
+        return false;
+    }
+    ++frame_count_;
+    return true;
+}
+
+namespace {
+
+float query_depth_scale(const rs2::pipeline_profile& profile) {
+    return profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+}
+
+// 实时相机
+class live_source : public frame_source {
+public:
+    explicit live_source(const source_config& config)
+        : frame_source(config.max_frames), config_(config) {}
+
+    void start() override {
+        rs2::config cfg;
+        if (!config_.serial.empty()) {
+            cfg.enable_device(config_.serial);
+        }
+        cfg.enable_stream(RS2_STREAM_DEPTH, config_.depth_width, config_.depth_height, RS2_FORMAT_Z16, config_.depth_fps);
+        if (config_.color_enabled()) {
+            cfg.enable_stream(RS2_STREAM_COLOR, config_.color_width, config_.color_height, RS2_FORMAT_BGR8, config_.color_fps);
+        }
+        profile_ = pipe_.start(cfg);
+        depth_scale_ = query_depth_scale(profile_);
+        if (config_.global_time) {
+            for (rs2::sensor& sensor : profile_.get_device().query_sensors()) {
+                if (sensor.supports(RS2_OPTION_GLOBAL_TIME_ENABLED)) {
+                    sensor.set_option(RS2_OPTION_GLOBAL_TIME_ENABLED, 1);
+                }
+            }
+        }
+    }
+
+    void stop() override { pipe_.stop(); }
+
+    float depth_scale() const override { return depth_scale_; }
+
+    std::string description() const override {
+        return config_.serial.empty() ? "live camera" : "live camera " + config_.serial;
+    }
+
+protected:
+    bool read(rs2::frameset& frames) override {
+        frames = pipe_.wait_for_frames();
+        return true;
+    }
+
+private:
+    source_config config_;
+    rs2::pipeline pipe_;
+    rs2::pipeline_profile profile_;
+    float depth_scale_ = 0.001f;
+};
+
+// bag 文件回放，流配置取自文件本身
+class bag_source : public frame_source {
+public:
+    explicit bag_source(const source_config& config)
+        : frame_source(config.max_frames), config_(config) {}
+
+    void start() override {
+        rs2::config cfg;
+        cfg.enable_device_from_file(config_.bag_path, config_.loop);
+        profile_ = pipe_.start(cfg);
+        // 非实时模式下回放不会丢帧，速度只受处理速度限制
+        profile_.get_device().as<rs2::playback>().set_real_time(config_.real_time);
+        depth_scale_ = query_depth_scale(profile_);
+    }
+
+    void stop() override { pipe_.stop(); }
+
+    float depth_scale() const override { return depth_scale_; }
+
+    std::string description() const override { return "bag " + config_.bag_path; }
+
+protected:
+    bool read(rs2::frameset& frames) override {
+        rs2::playback playback = profile_.get_device().as<rs2::playback>();
+        while (!pipe_.try_wait_for_frames(&frames, 100)) {
+            if (playback.current_status() == RS2_PLAYBACK_STATUS_STOPPED) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    source_config config_;
+    rs2::pipeline pipe_;
+    rs2::pipeline_profile profile_;
+    float depth_scale_ = 0.001f;
+};
+
+void release_pixels(void* pixels) {
+    delete[] static_cast<uint8_t*>(pixels);
+}
+
+// 合成数据：通过 rs2::software_device 注入，输出的帧与真实相机一样可以送入 rs2 滤波器和对齐
+// 彩色流（若启用）与深度同分辨率、同帧率
+class synthetic_source : public frame_source {
+public:
+    explicit synthetic_source(const source_config& config)
+        : frame_source(config.max_frames),
+          config_(config),
+          scene_(scene_options(config)),
+          depth_sensor_(device_.add_sensor("Depth")),
+          color_sensor_(device_.add_sensor("Color")) {
+        const synthetic_options& options = scene_.options();
+        const rs2_intrinsics intrinsics = scene_.intrinsics();
+
+        depth_profile_ = depth_sensor_.add_video_stream({RS2_STREAM_DEPTH, 0, 0, options.width, options.height,
+                                                         options.fps, 2, RS2_FORMAT_Z16, intrinsics});
+        depth_sensor_.add_read_only_option(RS2_OPTION_DEPTH_UNITS, options.depth_units);
+
+        if (config_.color_enabled()) {
+            color_profile_ = color_sensor_.add_video_stream({RS2_STREAM_COLOR, 0, 1, options.width, options.height,
+                                                             options.fps, 3, RS2_FORMAT_BGR8, intrinsics});
+            // 彩色与深度共用光心，rs2::align 需要已注册的外参
+            depth_profile_.register_extrinsics_to(color_profile_, {{1, 0, 0, 0, 1, 0, 0, 0, 1}, {0, 0, 0}});
+            device_.create_matcher(RS2_MATCHER_DLR_C);
+        }
+        device_.register_info(RS2_CAMERA_INFO_NAME, "Synthetic Depth Camera");
+    }
+
+    void start() override {
+        depth_sensor_.open(depth_profile_);
+        depth_sensor_.start(sync_);
+        if (config_.color_enabled()) {
+            color_sensor_.open(color_profile_);
+            color_sensor_.start(sync_);
+        }
+        start_time_ = std::chrono::steady_clock::now();
+        index_ = 0;
+    }
+
+    void stop() override {
+        depth_sensor_.stop();
+        depth_sensor_.close();
+        if (config_.color_enabled()) {
+            color_sensor_.stop();
+            color_sensor_.close();
+        }
+    }
+
+    float depth_scale() const override { return scene_.options().depth_units; }
+
+    std::string description() const override { return "synthetic"; }
+
+protected:
+    bool read(rs2::frameset& frames) override {
+        const synthetic_options& options = scene_.options();
+        if (config_.real_time) {
+            std::this_thread::sleep_until(start_time_ + std::chrono::microseconds(index_ * 1000000 / options.fps));
+        }
+
+        // 像素内存交给 librealsense，帧释放时由 release_pixels 回收
+        const size_t depth_bytes = size_t(options.width) * options.height * 2;
+        const size_t color_bytes = size_t(options.width) * options.height * 3;
+        uint8_t* depth_pixels = new uint8_t[depth_bytes];
+        uint8_t* color_pixels = config_.color_enabled() ? new uint8_t[color_bytes] : nullptr;
+
+        cv::Mat depth(options.height, options.width, CV_16U, depth_pixels);
+        cv::Mat color;
+        if (color_pixels) {
+            color = cv::Mat(options.height, options.width, CV_8UC3, color_pixels);
+        }
+        scene_.render(index_, depth, color_pixels ? &color : nullptr);
+
+        const rs2_time_t timestamp = index_ * 1000.0 / options.fps;
+        depth_sensor_.on_video_frame({depth_pixels, release_pixels, options.width * 2, 2, timestamp,
+                                      RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK, int(index_), depth_profile_.get()});
+        if (color_pixels) {
+            color_sensor_.on_video_frame({color_pixels, release_pixels, options.width * 3, 3, timestamp,
+                                          RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK, int(index_), color_profile_.get()});
+        }
+        ++index_;
+
+        return sync_.try_wait_for_frames(&frames, 1000);
+    }
+
+private:
+    static synthetic_options scene_options(const source_config& config) {
+        synthetic_options options = config.synthetic;
+        options.width = config.depth_width;
+        options.height = config.depth_height;
+        options.fps = config.depth_fps;
+        return options;
+    }
+
+    source_config config_;
+    synthetic_scene scene_;
+    rs2::software_device device_;
+    rs2::software_sensor depth_sensor_;
+    rs2::software_sensor color_sensor_;
+    rs2::stream_profile depth_profile_;
+    rs2::stream_profile color_profile_;
+    rs2::syncer sync_;
+    std::chrono::steady_clock::time_point start_time_;
+    uint64_t index_ = 0;
+};
+
+// 回放帧直接引用序列文件的映射内存。librealsense 的释放回调只拿到像素指针，
+// 因此用一张表记录每个在途指针所属的 reader，帧全部释放之后映射才会随 reader 解除
+std::mutex pinned_mutex;
+std::multimap<const void*, std::shared_ptr<sequence_reader>> pinned_frames;
+
+void* pin_pixels(const uint8_t* pixels, const std::shared_ptr<sequence_reader>& reader) {
+    std::lock_guard<std::mutex> lock(pinned_mutex);
+    pinned_frames.insert(std::make_pair(static_cast<const void*>(pixels), reader));
+    return const_cast<uint8_t*>(pixels);
+}
+
+void unpin_pixels(void* pixels) {
+    std::shared_ptr<sequence_reader> reader;
+    {
+        std::lock_guard<std::mutex> lock(pinned_mutex);
+        auto it = pinned_frames.find(pixels);
+        if (it != pinned_frames.end()) {
+            reader = std::move(it->second);
+            pinned_frames.erase(it);
+        }
+    }
+    // 最后一个引用在锁外释放，解除映射不阻塞其他帧
+}
+
+// rs2_software_video_frame 的帧号字段是 int：帧号在仓库内保持 uint64_t，只在交给 librealsense 时
+// 回绕到 [0, INT_MAX]，不产生负数或依赖实现定义的截断（90 Hz 下约 9 个月才回绕一次）
+int sdk_frame_number(uint64_t frame_number) {
+    return int(frame_number & uint64_t(INT_MAX));
+}
+
+// 深度序列回放：与合成数据一样通过 rs2::software_device 注入，流配置、内参和外参取自文件。
+// z16 深度和彩色帧不拷贝，直接把映射内存交给 librealsense；rvl 深度逐帧解压
+class sequence_source : public frame_source {
+public:
+    explicit sequence_source(const source_config& config)
+        : frame_source(config.max_frames),
+          config_(config),
+          reader_(new sequence_reader(config.sequence_path)),
+          depth_sensor_(device_.add_sensor("Depth")),
+          color_sensor_(device_.add_sensor("Color")) {
+        const sequence_info& info = reader_->info();
+        if (reader_->size() == 0) {
+            throw std::runtime_error("sequence " + config.sequence_path + " contains no frames");
+        }
+        const int fps = nominal_fps();
+        depth_profile_ = depth_sensor_.add_video_stream({RS2_STREAM_DEPTH, 0, 0, info.depth_intrinsics.width,
+                                                         info.depth_intrinsics.height, fps, 2, RS2_FORMAT_Z16,
+                                                         info.depth_intrinsics});
+        depth_sensor_.add_read_only_option(RS2_OPTION_DEPTH_UNITS, info.depth_scale);
+
+        if (info.has_color) {
+            color_profile_ = color_sensor_.add_video_stream({RS2_STREAM_COLOR, 0, 1, info.color_intrinsics.width,
+                                                             info.color_intrinsics.height, fps, 3, RS2_FORMAT_BGR8,
+                                                             info.color_intrinsics});
+            depth_profile_.register_extrinsics_to(color_profile_, info.depth_to_color);
+            device_.create_matcher(RS2_MATCHER_DLR_C);
+        }
+        device_.register_info(RS2_CAMERA_INFO_NAME, "Depth Sequence Playback");
+
+        // 定位只是一次二分查找，与录像长度无关
+        first_ = reader_->find(reader_->entry(0).depth_timestamp + config.seek_ms);
+        const sequence_entry& last = reader_->entry(reader_->size() - 1);
+        duration_ = last.depth_timestamp - reader_->entry(0).depth_timestamp + 1000.0 / fps;
+        frame_span_ = last.frame_number + 1;
+    }
+
+    void start() override {
+        depth_sensor_.open(depth_profile_);
+        depth_sensor_.start(sync_);
+        if (reader_->info().has_color) {
+            color_sensor_.open(color_profile_);
+            color_sensor_.start(sync_);
+        }
+        index_ = first_;
+        loops_ = 0;
+        start_time_ = std::chrono::steady_clock::now();
+        reader_->prefetch(index_);
+    }
+
+    void stop() override {
+        depth_sensor_.stop();
+        depth_sensor_.close();
+        if (reader_->info().has_color) {
+            color_sensor_.stop();
+            color_sensor_.close();
+        }
+    }
+
+    float depth_scale() const override { return reader_->info().depth_scale; }
+
+    std::string description() const override { return "sequence " + config_.sequence_path; }
+
+protected:
+    bool read(rs2::frameset& frames) override {
+        if (index_ == reader_->size()) {
+            if (!config_.loop) {
+                return false;
+            }
+            index_ = 0;
+            ++loops_;
+        }
+        const sequence_info& info = reader_->info();
+        const sequence_entry& entry = reader_->entry(index_);
+        // 循环播放时时间戳和帧号继续递增，同步器和时域滤波器看到的仍是连续的流
+        const double timestamp = entry.depth_timestamp + loops_ * duration_;
+        const uint64_t frame_number = entry.frame_number + loops_ * frame_span_;
+
+        if (config_.real_time) {
+            const double elapsed_ms = timestamp - reader_->entry(first_).depth_timestamp;
+            std::this_thread::sleep_until(start_time_ + std::chrono::microseconds(int64_t(elapsed_ms * 1000.0)));
+        }
+
+        void* depth_pixels;
+        void (*release_depth)(void*);
+        if (info.codec == sequence_codec::z16) {
+            depth_pixels = pin_pixels(reader_->depth_data(index_), reader_);
+            release_depth = unpin_pixels;
+        } else {
+            uint8_t* pixels = new uint8_t[size_t(info.depth_intrinsics.width) * info.depth_intrinsics.height * 2];
+            cv::Mat depth(info.depth_intrinsics.height, info.depth_intrinsics.width, CV_16U, pixels);
+            try {
+                codec_.decode(reader_->depth_data(index_), entry.depth_size, depth);
+                if (depth.data != pixels) {
+                    throw std::runtime_error("sequence frame size does not match the stream intrinsics");
+                }
+            } catch (...) {
+                delete[] pixels;
+                throw;
+            }
+            depth_pixels = pixels;
+            release_depth = release_pixels;
+        }
+        depth_sensor_.on_video_frame({depth_pixels, release_depth, info.depth_intrinsics.width * 2, 2, timestamp,
+                                      RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK, sdk_frame_number(frame_number), depth_profile_.get()});
+        if (entry.color_offset != 0) {
+            color_sensor_.on_video_frame({pin_pixels(reader_->color_data(index_), reader_), unpin_pixels,
+                                          info.color_intrinsics.width * 3, 3,
+                                          entry.color_timestamp + loops_ * duration_,
+                                          RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK, sdk_frame_number(frame_number), color_profile_.get()});
+        }
+        ++index_;
+        reader_->prefetch(index_);
+
+        return sync_.try_wait_for_frames(&frames, 1000);
+    }
+
+private:
+    // 由时间戳估计的帧率，只用于填写流配置和循环时的时间戳衔接
+    int nominal_fps() const {
+        const size_t count = reader_->size();
+        const double span = reader_->entry(count - 1).depth_timestamp - reader_->entry(0).depth_timestamp;
+        if (count < 2 || span <= 0) {
+            return config_.depth_fps;
+        }
+        return std::max(1, int(std::lround((count - 1) * 1000.0 / span)));
+    }
+
+    source_config config_;
+    std::shared_ptr<sequence_reader> reader_;
+    rs2::software_device device_;
+    rs2::software_sensor depth_sensor_;
+    rs2::software_sensor color_sensor_;
+    rs2::stream_profile depth_profile_;
+    rs2::stream_profile color_profile_;
+    rs2::syncer sync_;
+    depth_codec codec_;
+    std::chrono::steady_clock::time_point start_time_;
+    size_t first_ = 0;
+    size_t index_ = 0;
+    uint64_t loops_ = 0;
+    double duration_ = 0;
+    uint64_t frame_span_ = 0;
+};
+
+bool parse_size(const std::string& text, int& width, int& height) {
+    size_t x = text.find('x');
+    if (x == std::string::npos) {
+        return false;
+    }
+    width = std::atoi(text.substr(0, x).c_str());
+    height = std::atoi(text.substr(x + 1).c_str());
+    return width > 0 && height > 0;
+}
+
+} // namespace
+
+std::unique_ptr<frame_source> make_frame_source(const source_config& config) {
+    switch (config.kind) {
+    case source_kind::bag:
+        return std::unique_ptr<frame_source>(new bag_source(config));
+    case source_kind::synthetic:
+        return std::unique_ptr<frame_source>(new synthetic_source(config));
+    case source_kind::sequence:
+        return std::unique_ptr<frame_source>(new sequence_source(config));
+    case source_kind::live:
+    default:
+        return std::unique_ptr<frame_source>(new live_source(config));
+    }
+}
+
+void parse_source_args(int argc, char** argv, source_config& config) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--bag") {
+            if (!has_value) throw std::invalid_argument("--bag requires a file path");
+            config.kind = source_kind::bag;
+            config.bag_path = argv[++i];
+        } else if (arg == "--sequence") {
+            if (!has_value) throw std::invalid_argument("--sequence requires a file path");
+            config.kind = source_kind::sequence;
+            config.sequence_path = argv[++i];
+        } else if (arg == "--seek") {
+            if (!has_value) throw std::invalid_argument("--seek requires a time in milliseconds");
+            config.seek_ms = std::atof(argv[++i]);
+        } else if (arg == "--synthetic") {
+            config.kind = source_kind::synthetic;
+        } else if (arg == "--serial") {
+            if (!has_value) throw std::invalid_argument("--serial requires a serial number");
+            config.serial = argv[++i];
+        } else if (arg == "--size") {
+            int width = 0, height = 0;
+            if (!has_value || !parse_size(argv[++i], width, height)) {
+                throw std::invalid_argument("--size expects WIDTHxHEIGHT, e.g. 640x480");
+            }
+            // 彩色流已启用且与深度同分辨率时一起修改
+            if (config.color_width == config.depth_width && config.color_height == config.depth_height) {
+                config.color_width = width;
+                config.color_height = height;
+            }
+            config.depth_width = width;
+            config.depth_height = height;
+        } else if (arg == "--fps") {
+            if (!has_value || std::atoi(argv[i + 1]) <= 0) throw std::invalid_argument("--fps expects a positive number");
+            config.depth_fps = std::atoi(argv[++i]);
+        } else if (arg == "--realtime") {
+            config.real_time = true;
+        } else if (arg == "--loop") {
+            config.loop = true;
+        } else if (arg == "--frames") {
+            if (!has_value) throw std::invalid_argument("--frames requires a count");
+            config.max_frames = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+}
+
+} // namespace rsd
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core/synthetic_scene.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rsd {
+
+// 帧来源类型
+enum class source_kind {
+    live,       // 实时相机
+    bag,        // .bag 文件回放
+    synthetic,  // 确定性合成数据
+    sequence    // 深度序列文件（.rsq，见 depth_sequence.hpp）回放
+};
+
+// 帧来源配置，默认与各程序原来的 rs2::config 一致
+struct source_config {
+    source_kind kind = source_kind::live;
+
+    int depth_width = 640;
+    int depth_height = 480;
+    int depth_fps = 30;
+    int color_width = 0;        // 0 表示不启用彩色流
+    int color_height = 0;
+    int color_fps = 0;
+
+    std::string serial;         // 实时相机：指定设备序列号，空表示默认设备
+    std::string bag_path;       // bag 回放：文件路径
+    std::string sequence_path;  // 序列回放：文件路径
+    double seek_ms = 0;         // 序列回放：从录像开始后多少毫秒处开始
+    bool real_time = false;     // bag/序列/合成：按原始帧率节拍输出，否则尽可能快
+    bool loop = false;          // bag/序列：播放结束后从头开始
+    uint64_t max_frames = 0;    // 读取多少帧后结束，0 表示不限
+    bool global_time = false;   // 实时相机：开启全局时间，帧时间戳为映射到主机时钟的硬件时间戳，多台相机之间可比
+
+    synthetic_options synthetic;
+
+    void enable_depth(int width, int height, int fps) {
+        depth_width = width; depth_height = height; depth_fps = fps;
+    }
+    void enable_color(int width, int height, int fps) {
+        color_width = width; color_height = height; color_fps = fps;
+    }
+    bool color_enabled() const { return color_width > 0 && color_height > 0; }
+};
+
+// 统一的帧来源接口：实时相机、bag 回放和合成数据都输出 rs2::frameset，
+// 因此 rs2 的滤波器和对齐可以不加修改地作用在任何一种来源上
+class frame_source {
+public:
+    virtual ~frame_source() {}
+
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+    // 获取下一组帧，数据源结束（bag 播放完毕或达到 max_frames）时返回 false
+    bool next(rs2::frameset& frames);
+
+    virtual float depth_scale() const = 0;
+    virtual std::string description() const = 0;
+
+    uint64_t frame_count() const { return frame_count_; }
+
+protected:
+    explicit frame_source(uint64_t max_frames) : max_frames_(max_frames) {}
+
+    virtual bool read(rs2::frameset& frames) = 0;
+
+private:
+    uint64_t max_frames_;
+    uint64_t frame_count_ = 0;
+};
+
+// 根据配置创建帧来源（尚未启动）
+std::unique_ptr<frame_source> make_frame_source(const source_config& config);
+
+// 从命令行覆盖配置，未识别的参数会被忽略：
+//   --bag <file>       回放 bag 文件
+//   --sequence <file>  回放深度序列文件（.rsq）
+//   --seek <ms>        序列回放从录像开始后 ms 毫秒处开始
+//   --synthetic        使用合成数据
+//   --serial <sn>      指定实时相机
+//   --size <WxH>       深度（以及合成彩色）分辨率
+//   --fps <n>          深度帧率
+//   --realtime         回放/合成时按帧率节拍输出
+//   --loop             bag/序列循环播放
+//   --frames <n>       读取 n 帧后结束
+// 参数格式错误时抛出 std::invalid_argument
+void parse_source_args(int argc, char** argv, source_config& config);
+
+} // namespace rsd
@@ -0,0 +1,247 @@
+#include "core/height_map.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+#include <librealsense2/rsutil.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 3x3 行优先矩阵乘法 a * b
+void multiply(const float* a, const float* b, float* out) {
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            out[3 * r + c] = a[3 * r] * b[c] + a[3 * r + 1] * b[3 + c] + a[3 * r + 2] * b[6 + c];
+        }
+    }
+}
+
+inline void store_min(std::atomic<float>& slot, float value) {
+    float current = slot.load(std::memory_order_relaxed);
+    while (value < current && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+inline void store_max(std::atomic<float>& slot, float value) {
+    float current = slot.load(std::memory_order_relaxed);
+    while (value > current && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// 条带内连续落在同一格的点的合并结果
+struct cell_run {
+    int index = -1;
+    float min_height = 0;
+    float max_height = 0;
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+};
+
+} // namespace
+
+camera_pose camera_pose::level() {
+    return mount(0, 0);
+}
+
+camera_pose camera_pose::mount(float height, float pitch_deg, float roll_deg, float yaw_deg) {
+    const float to_rad = float(CV_PI / 180.0);
+    const float p = -pitch_deg * to_rad;
+    const float r = roll_deg * to_rad;
+    const float y = yaw_deg * to_rad;
+    // 水平朝前：相机 x -> 世界 x，相机 z（前）-> 世界 y，相机 y（下）-> 世界 -z
+    const float base[9] = {1, 0, 0,
+                           0, 0, 1,
+                           0, -1, 0};
+    // 依次绕世界 x 轴俯仰、绕前向 y 轴横滚、绕竖直 z 轴偏航
+    const float pitch[9] = {1, 0, 0,
+                            0, std::cos(p), -std::sin(p),
+                            0, std::sin(p), std::cos(p)};
+    const float roll[9] = {std::cos(r), 0, std::sin(r),
+                           0, 1, 0,
+                           -std::sin(r), 0, std::cos(r)};
+    const float yaw[9] = {std::cos(y), -std::sin(y), 0,
+                          std::sin(y), std::cos(y), 0,
+                          0, 0, 1};
+    float a[9], b[9];
+    multiply(pitch, base, a);
+    multiply(roll, a, b);
+
+    camera_pose pose;
+    multiply(yaw, b, pose.rotation);
+    pose.translation[0] = 0;
+    pose.translation[1] = 0;
+    pose.translation[2] = height;
+    return pose;
+}
+
+height_map::height_map(const height_map_options& options)
+    : options_(options), configured_(false) {
+    if (options.cols <= 0 || options.rows <= 0 || !(options.resolution > 0)) {
+        throw std::invalid_argument("height_map: grid size and resolution must be positive");
+    }
+    std::memset(&intrinsics_, 0, sizeof(intrinsics_));
+    cells_.reset(new cell_data[size_t(options.cols) * options.rows]);
+    clear();
+}
+
+void height_map::clear() {
+    const size_t count = size_t(options_.cols) * options_.rows;
+    for (size_t i = 0; i < count; ++i) {
+        cells_[i].min_height.store(std::numeric_limits<float>::infinity(), std::memory_order_relaxed);
+        cells_[i].max_height.store(-std::numeric_limits<float>::infinity(), std::memory_order_relaxed);
+        cells_[i].hits.store(0, std::memory_order_relaxed);
+        cells_[i].misses.store(0, std::memory_order_relaxed);
+    }
+}
+
+void height_map::configure(const rs2_intrinsics& intrinsics) {
+    if (configured_ && std::memcmp(&intrinsics, &intrinsics_, sizeof(intrinsics)) == 0) {
+        return;
+    }
+    intrinsics_ = intrinsics;
+    const size_t count = size_t(intrinsics.width) * intrinsics.height;
+    ray_x_.resize(count);
+    ray_y_.resize(count);
+    for (int v = 0; v < intrinsics.height; ++v) {
+        for (int u = 0; u < intrinsics.width; ++u) {
+            const float pixel[2] = {float(u), float(v)};
+            float ray[3];
+            rs2_deproject_pixel_to_point(ray, &intrinsics_, pixel, 1.0f);
+            ray_x_[size_t(v) * intrinsics.width + u] = ray[0];
+            ray_y_[size_t(v) * intrinsics.width + u] = ray[1];
+        }
+    }
+    configured_ = true;
+}
+
+void height_map::update(const cv::Mat& depth, const rs2_intrinsics& intrinsics, float depth_scale,
+                        const camera_pose& pose) {
+    RSD_TRACE_SCOPE("height_map");
+    CV_Assert(depth.type() == CV_16UC1 && depth.cols == intrinsics.width && depth.rows == intrinsics.height);
+    if (!(depth_scale > 0)) {
+        throw std::invalid_argument("height_map: depth scale must be positive");
+    }
+    configure(intrinsics);
+
+    const height_map_options o = options_;
+    const int32_t min_depth = std::max(1, int32_t(std::ceil(o.min_range / depth_scale)));
+    const int32_t max_depth = std::min(65535, int32_t(o.max_range / depth_scale));
+    const float inv_resolution = 1.0f / o.resolution;
+    const float* R = pose.rotation;
+    const float* t = pose.translation;
+    cell_data* cells = cells_.get();
+    const float* rays_x = ray_x_.data();
+    const float* rays_y = ray_y_.data();
+
+    auto flush = [cells](const cell_run& run) {
+        cell_data& c = cells[run.index];
+        store_min(c.min_height, run.min_height);
+        store_max(c.max_height, run.max_height);
+        if (run.hits) c.hits.fetch_add(run.hits, std::memory_order_relaxed);
+        if (run.misses) c.misses.fetch_add(run.misses, std::memory_order_relaxed);
+    };
+
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        cell_run run;
+        for (int v = range.start; v < range.end; ++v) {
+            const uint16_t* row = depth.ptr<uint16_t>(v);
+            const float* rx = rays_x + size_t(v) * depth.cols;
+            const float* ry = rays_y + size_t(v) * depth.cols;
+            for (int u = 0; u < depth.cols; ++u) {
+                const int32_t d = row[u];
+                if (d < min_depth || d > max_depth) {
+                    continue;
+                }
+                const float z = float(d) * depth_scale;
+                const float x = z * rx[u];
+                const float y = z * ry[u];
+                const float h = R[6] * x + R[7] * y + R[8] * z + t[2];
+                if (h < o.min_height || h > o.max_height) {
+                    continue;
+                }
+                const float gx = (R[0] * x + R[1] * y + R[2] * z + t[0] - o.origin_x) * inv_resolution;
+                const float gy = (R[3] * x + R[4] * y + R[5] * z + t[1] - o.origin_y) * inv_resolution;
+                // 先在浮点范围内判断越界，转换为整数时不会溢出
+                if (!(gx >= 0 && gx < float(o.cols) && gy >= 0 && gy < float(o.rows))) {
+                    continue;
+                }
+                const int index = int(gy) * o.cols + int(gx);
+                const bool hit = h > o.obstacle_height;
+                if (index != run.index) {
+                    if (run.index >= 0) {
+                        flush(run);
+                    }
+                    run.index = index;
+                    run.min_height = h;
+                    run.max_height = h;
+                    run.hits = 0;
+                    run.misses = 0;
+                } else {
+                    run.min_height = std::min(run.min_height, h);
+                    run.max_height = std::max(run.max_height, h);
+                }
+                run.hits += hit;
+                run.misses += !hit;
+            }
+        }
+        if (run.index >= 0) {
+            flush(run);
+        }
+    });
+}
+
+void height_map::update(const rs2::depth_frame& depth, const camera_pose& pose) {
+    const rs2_intrinsics intrinsics = depth.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    update(depth_view(depth), intrinsics, depth.get_units(), pose);
+}
+
+height_cell_state height_map::cell(int col, int row) const {
+    if (col < 0 || row < 0 || col >= options_.cols || row >= options_.rows) {
+        throw std::out_of_range("height_map: cell out of range");
+    }
+    const cell_data& c = cells_[size_t(row) * options_.cols + col];
+    height_cell_state state;
+    state.min_height = c.min_height.load(std::memory_order_relaxed);
+    state.max_height = c.max_height.load(std::memory_order_relaxed);
+    state.hits = c.hits.load(std::memory_order_relaxed);
+    state.misses = c.misses.load(std::memory_order_relaxed);
+    return state;
+}
+
+void height_map::occupancy(cv::Mat& out, float occupied_ratio, uint32_t min_hits) const {
+    out.create(options_.rows, options_.cols, CV_8UC1);
+    for (int row = 0; row < options_.rows; ++row) {
+        // 图像第 0 行是最远的一行
+        uint8_t* dst = out.ptr<uint8_t>(options_.rows - 1 - row);
+        const cell_data* src = &cells_[size_t(row) * options_.cols];
+        for (int col = 0; col < options_.cols; ++col) {
+            const uint32_t hits = src[col].hits.load(std::memory_order_relaxed);
+            const uint32_t total = hits + src[col].misses.load(std::memory_order_relaxed);
+            if (total == 0) {
+                dst[col] = 128;
+            } else {
+                dst[col] = hits >= min_hits && hits >= occupied_ratio * total ? 0 : 255;
+            }
+        }
+    }
+}
+
+void height_map::max_heights(cv::Mat& out) const {
+    out.create(options_.rows, options_.cols, CV_32FC1);
+    for (int row = 0; row < options_.rows; ++row) {
+        float* dst = out.ptr<float>(options_.rows - 1 - row);
+        const cell_data* src = &cells_[size_t(row) * options_.cols];
+        for (int col = 0; col < options_.cols; ++col) {
+            const float h = src[col].max_height.load(std::memory_order_relaxed);
+            dst[col] = std::isinf(h) ? std::numeric_limits<float>::quiet_NaN() : h;
+        }
+    }
+}
+
+} // namespace rsd
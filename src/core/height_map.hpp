@@ -0,0 +1,91 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rsd {
+
+// 相机位姿：相机坐标（rs2：x 向右、y 向下、z 向前）-> 世界坐标（x 向右、y 向前、z 向上），单位米
+struct camera_pose {
+    float rotation[9];      // 行优先，world = R * camera + t
+    float translation[3];   // 相机光心在世界坐标中的位置
+
+    // 相机水平朝前安装在原点
+    static camera_pose level();
+    // 安装高度（米）与姿态（度）：pitch 向下为正，roll 绕前向轴右倾为正，yaw 向左为正
+    static camera_pose mount(float height, float pitch_deg, float roll_deg = 0, float yaw_deg = 0);
+};
+
+struct height_map_options {
+    int cols = 200;                 // 栅格列数（x 方向）
+    int rows = 200;                 // 栅格行数（y 方向）
+    float resolution = 0.05f;       // 格边长（米）
+    float origin_x = -5.0f;         // 第 0 列左边界的 x（米）
+    float origin_y = 0.0f;          // 第 0 行近边界的 y（米）
+    float min_height = -0.5f;       // 只统计该高度范围内的点（米），排除地面以下的噪声和天花板
+    float max_height = 2.0f;
+    float obstacle_height = 0.1f;   // 高于该值的点记为命中（障碍），否则记为未命中（可通行的地面）
+    float min_range = 0.1f;         // 深度有效范围（米）
+    float max_range = 6.0f;
+};
+
+// 单个格子的统计
+struct height_cell_state {
+    float min_height;   // 没有观测时为 +inf
+    float max_height;   // 没有观测时为 -inf
+    uint32_t hits;
+    uint32_t misses;
+
+    bool observed() const { return hits + misses > 0; }
+};
+
+// 2.5D 高度图 / 占据栅格：把每帧深度反投影到世界坐标，按俯视网格累计每格的最低、最高高度
+// 以及命中 / 未命中次数，多帧之间增量累加（位姿可以每帧不同）。
+// 深度图按行分成条带并行处理；同一行相邻像素大多落在同一格，条带内先合并连续落在同一格的点，
+// 格子变化时才用原子操作写回，各线程之间无需加锁
+class height_map {
+public:
+    explicit height_map(const height_map_options& options = height_map_options());
+
+    const height_map_options& options() const { return options_; }
+
+    // depth 为 CV_16UC1，intrinsics 与其尺寸一致；射线表只在内参变化时重建
+    void update(const cv::Mat& depth, const rs2_intrinsics& intrinsics, float depth_scale, const camera_pose& pose);
+    // 内参和深度单位取自帧的流配置（例如降采样后的帧）
+    void update(const rs2::depth_frame& depth, const camera_pose& pose);
+
+    // 清空所有统计
+    void clear();
+
+    // 读取单个格子，越界时抛出 std::out_of_range；与 update 并发调用时读到的是某一时刻的近似值
+    height_cell_state cell(int col, int row) const;
+
+    // 占据图（CV_8UC1，rows x cols，图像上方为 y 正方向即前方）：
+    // 命中比例不低于 occupied_ratio 且命中至少 min_hits 次为 0（障碍），其余观测过的格子为 255（可通行），未观测为 128
+    void occupancy(cv::Mat& out, float occupied_ratio = 0.5f, uint32_t min_hits = 2) const;
+    // 每格最高高度（CV_32FC1，米，方向同 occupancy），未观测为 NaN
+    void max_heights(cv::Mat& out) const;
+
+private:
+    struct cell_data {
+        std::atomic<float> min_height;
+        std::atomic<float> max_height;
+        std::atomic<uint32_t> hits;
+        std::atomic<uint32_t> misses;
+    };
+
+    void configure(const rs2_intrinsics& intrinsics);
+
+    height_map_options options_;
+    std::unique_ptr<cell_data[]> cells_;
+    rs2_intrinsics intrinsics_;
+    bool configured_;
+    std::vector<float> ray_x_;   // 每个像素在 z = 1 平面上的射线，行优先
+    std::vector<float> ray_y_;
+};
+
+} // namespace rsd
@@ -0,0 +1,129 @@
+#include "core/hole_filler.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 行数较少的粗层直接串行处理，避免并行调度开销
+const int parallel_min_rows = 64;
+
+template <typename Fn>
+void for_rows(int rows, Fn fn) {
+    if (rows < parallel_min_rows) {
+        fn(cv::Range(0, rows));
+    } else {
+        cv::parallel_for_(cv::Range(0, rows), fn);
+    }
+}
+
+// 加权合并最多 4 个候选深度：只保留与最远值相差不超过 band 的有效值
+inline uint16_t merge_far(const uint16_t* v, const uint32_t* w, int n, uint32_t band) {
+    uint32_t far = 0;
+    for (int i = 0; i < n; ++i) {
+        far = std::max<uint32_t>(far, v[i]);
+    }
+    if (far == 0) {
+        return 0;
+    }
+    const uint32_t limit = far > band ? far - band : 1;
+    uint32_t sum = 0;
+    uint32_t weight = 0;
+    for (int i = 0; i < n; ++i) {
+        if (v[i] >= limit) {
+            sum += w[i] * v[i];
+            weight += w[i];
+        }
+    }
+    return uint16_t((sum + weight / 2) / weight);
+}
+
+// fine -> coarse：每个粗层像素由对应的 2x2 细层像素合并
+void pull(const cv::Mat& fine, cv::Mat& coarse, uint32_t band) {
+    static const uint32_t equal[4] = {1, 1, 1, 1};
+    for_rows(coarse.rows, [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uint16_t* r0 = fine.ptr<uint16_t>(2 * y);
+            const uint16_t* r1 = fine.ptr<uint16_t>(std::min(2 * y + 1, fine.rows - 1));
+            uint16_t* dst = coarse.ptr<uint16_t>(y);
+            for (int x = 0; x < coarse.cols; ++x) {
+                const int x0 = 2 * x;
+                const int x1 = std::min(x0 + 1, fine.cols - 1);
+                const uint16_t v[4] = {r0[x0], r0[x1], r1[x0], r1[x1]};
+                dst[x] = merge_far(v, equal, 4, band);
+            }
+        }
+    });
+}
+
+// 细层坐标 x 对应的两个粗层邻居及其权重（3:1 双线性）
+inline void coarse_taps(int x, int coarse_size, int& near_index, int& far_index) {
+    near_index = std::min(x >> 1, coarse_size - 1);
+    far_index = (x & 1) ? near_index + 1 : near_index - 1;
+    far_index = std::max(0, std::min(far_index, coarse_size - 1));
+}
+
+// coarse -> fine：只改写细层中的空洞
+void push(const cv::Mat& coarse, cv::Mat& fine, uint32_t band) {
+    static const uint32_t bilinear[4] = {9, 3, 3, 1};
+    for_rows(fine.rows, [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            uint16_t* dst = fine.ptr<uint16_t>(y);
+            int ny, fy;
+            coarse_taps(y, coarse.rows, ny, fy);
+            const uint16_t* near_row = coarse.ptr<uint16_t>(ny);
+            const uint16_t* far_row = coarse.ptr<uint16_t>(fy);
+            for (int x = 0; x < fine.cols; ++x) {
+                if (dst[x] != 0) {
+                    continue;
+                }
+                int nx, fx;
+                coarse_taps(x, coarse.cols, nx, fx);
+                const uint16_t v[4] = {near_row[nx], near_row[fx], far_row[nx], far_row[fx]};
+                dst[x] = merge_far(v, bilinear, 4, band);
+            }
+        }
+    });
+}
+
+} // namespace
+
+push_pull_filler::push_pull_filler(const hole_fill_options& options)
+    : options_(options) {}
+
+void push_pull_filler::process(const cv::Mat& depth, cv::Mat& out) {
+    RSD_TRACE_SCOPE("hole_fill");
+    CV_Assert(depth.type() == CV_16UC1);
+    if (options_.max_levels < 1) {
+        throw std::invalid_argument("push_pull_filler: max_levels must be positive");
+    }
+    if (out.data != depth.data) {
+        depth.copyTo(out);
+    }
+
+    // 金字塔缓冲只在分辨率变化时重新分配
+    levels_.resize(1);
+    levels_[0] = out;
+    cv::Size size = depth.size();
+    for (int level = 1; level < options_.max_levels && (size.width > 1 || size.height > 1); ++level) {
+        size = cv::Size((size.width + 1) / 2, (size.height + 1) / 2);
+        if (pyramid_.size() < size_t(level)) {
+            pyramid_.push_back(cv::Mat());
+        }
+        pyramid_[level - 1].create(size, CV_16UC1);
+        levels_.push_back(pyramid_[level - 1]);
+    }
+
+    const uint32_t band = options_.far_band;
+    for (size_t i = 1; i < levels_.size(); ++i) {
+        pull(levels_[i - 1], levels_[i], band);
+    }
+    for (size_t i = levels_.size() - 1; i > 0; --i) {
+        push(levels_[i], levels_[i - 1], band);
+    }
+}
+
+} // namespace rsd
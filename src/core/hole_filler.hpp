@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rsd {
+
+struct hole_fill_options {
+    // 合并相邻深度时，只平均与其中最远值相差不超过 far_band 的像素（深度单位），
+    // 更近的像素视为前景被排除，使空洞按背景填充、深度边缘不被抹平
+    uint16_t far_band;
+    // 金字塔最多层数，层数用完仍为空洞的像素保持 0
+    int max_levels;
+
+    hole_fill_options(uint16_t far_band = 50, int max_levels = 16)
+        : far_band(far_band), max_levels(max_levels) {}
+};
+
+// 金字塔 push-pull 空洞填充，直接处理 Z16（0 为空洞）：
+// pull 逐层 2x2 下采样得到粗层深度，push 自顶向下用粗层的双线性邻域补齐细层空洞。
+// 每层只做一次线性遍历，耗时与空洞多少基本无关；金字塔缓冲跨帧复用
+class push_pull_filler {
+public:
+    explicit push_pull_filler(const hole_fill_options& options = hole_fill_options());
+
+    void set_options(const hole_fill_options& options) { options_ = options; }
+    const hole_fill_options& options() const { return options_; }
+
+    // depth 为 CV_16UC1，out 为同尺寸 CV_16UC1（可与 depth 相同），有效像素保持原值
+    void process(const cv::Mat& depth, cv::Mat& out);
+
+private:
+    hole_fill_options options_;
+    std::vector<cv::Mat> pyramid_;  // 各粗层缓冲，每层尺寸减半
+    std::vector<cv::Mat> levels_;   // 本帧用到的各层，levels_[0] 指向输出
+};
+
+} // namespace rsd
@@ -0,0 +1,237 @@
+#include "core/joint_bilateral.hpp"
+#include "core/simd.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 颜色权重表的分档数：一个 SIMD 查表寄存器（pshufb / vtbl）正好容纳 16 个 8 位权重
+const int color_bins = 16;
+
+// 一个邻域偏移对一行输出的贡献：邻域像素指针已按偏移对齐到输出像素
+struct tap_row {
+    const uint16_t* depth;
+    const uint8_t* plane[3];
+    const uint8_t* center[3];
+    float space;
+};
+
+// 颜色权重：BGR 绝对差之和右移 shift 位后查 16 档的 8 位权重表（最后一档包含所有更大的差值）
+struct color_table {
+    const uint8_t* weights;
+    int shift;
+};
+
+typedef void (*accumulate_fn)(const tap_row& tap, const color_table& color,
+                              float* sum_w, float* sum_d, int count);
+
+void accumulate_scalar(const tap_row& tap, const color_table& color,
+                       float* sum_w, float* sum_d, int count) {
+    for (int x = 0; x < count; ++x) {
+        const uint16_t d = tap.depth[x];
+        if (d == 0) {
+            continue;
+        }
+        const int distance = std::abs(tap.plane[0][x] - tap.center[0][x]) +
+                             std::abs(tap.plane[1][x] - tap.center[1][x]) +
+                             std::abs(tap.plane[2][x] - tap.center[2][x]);
+        const float w = tap.space * color.weights[std::min(color_bins - 1, distance >> color.shift)];
+        sum_w[x] += w;
+        sum_d[x] += w * d;
+    }
+}
+
+// 处理完向量部分后，剩余像素交给标量实现
+void accumulate_tail(const tap_row& tap, const color_table& color,
+                     float* sum_w, float* sum_d, int x, int count) {
+    tap_row rest = tap;
+    rest.depth += x;
+    for (int c = 0; c < 3; ++c) {
+        rest.plane[c] += x;
+        rest.center[c] += x;
+    }
+    accumulate_scalar(rest, color, sum_w + x, sum_d + x, count - x);
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("avx2")
+inline __m128i absdiff8_avx2(const uint8_t* a, const uint8_t* b) {
+    __m128i va = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a));
+    __m128i vb = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b));
+    return _mm_cvtepu8_epi16(_mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)));
+}
+
+RSD_TARGET("avx2")
+void accumulate_avx2(const tap_row& tap, const color_table& color,
+                     float* sum_w, float* sum_d, int count) {
+    const __m256 space = _mm256_set1_ps(tap.space);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color.weights));
+    const __m128i last_bin = _mm_set1_epi16(color_bins - 1);
+    const __m128i shift = _mm_cvtsi32_si128(color.shift);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i distance = _mm_add_epi16(_mm_add_epi16(absdiff8_avx2(tap.plane[0] + x, tap.center[0] + x),
+                                                       absdiff8_avx2(tap.plane[1] + x, tap.center[1] + x)),
+                                         absdiff8_avx2(tap.plane[2] + x, tap.center[2] + x));
+        __m128i bin = _mm_min_epu16(_mm_srl_epi16(distance, shift), last_bin);
+        __m128i weight8 = _mm_shuffle_epi8(table, _mm_packus_epi16(bin, bin));
+        __m256 color_w = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(weight8));
+
+        __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tap.depth + x)));
+        __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(d, zero));
+        __m256 w = _mm256_and_ps(_mm256_mul_ps(space, color_w), valid);
+
+        _mm256_storeu_ps(sum_w + x, _mm256_add_ps(_mm256_loadu_ps(sum_w + x), w));
+        _mm256_storeu_ps(sum_d + x, _mm256_add_ps(_mm256_loadu_ps(sum_d + x),
+                                                  _mm256_mul_ps(w, _mm256_cvtepi32_ps(d))));
+    }
+    accumulate_tail(tap, color, sum_w, sum_d, x, count);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+inline uint16x8_t absdiff8_neon(const uint8_t* a, const uint8_t* b) {
+    return vmovl_u8(vabd_u8(vld1_u8(a), vld1_u8(b)));
+}
+
+void accumulate_neon(const tap_row& tap, const color_table& color,
+                     float* sum_w, float* sum_d, int count) {
+    const float32x4_t space = vdupq_n_f32(tap.space);
+    uint8x8x2_t table;
+    table.val[0] = vld1_u8(color.weights);
+    table.val[1] = vld1_u8(color.weights + 8);
+    const uint16x8_t last_bin = vdupq_n_u16(color_bins - 1);
+    const int16x8_t shift = vdupq_n_s16(int16_t(-color.shift));
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        uint16x8_t distance = vaddq_u16(vaddq_u16(absdiff8_neon(tap.plane[0] + x, tap.center[0] + x),
+                                                  absdiff8_neon(tap.plane[1] + x, tap.center[1] + x)),
+                                        absdiff8_neon(tap.plane[2] + x, tap.center[2] + x));
+        uint16x8_t bin = vminq_u16(vshlq_u16(distance, shift), last_bin);
+        uint16x8_t weight = vmovl_u8(vtbl2_u8(table, vmovn_u16(bin)));
+
+        uint16x8_t d = vld1q_u16(tap.depth + x);
+        // 深度为 0 的像素权重置 0
+        weight = vbicq_u16(weight, vceqq_u16(d, vdupq_n_u16(0)));
+
+        float32x4_t w_lo = vmulq_f32(space, vcvtq_f32_u32(vmovl_u16(vget_low_u16(weight))));
+        float32x4_t w_hi = vmulq_f32(space, vcvtq_f32_u32(vmovl_u16(vget_high_u16(weight))));
+        float32x4_t d_lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(d)));
+        float32x4_t d_hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(d)));
+
+        vst1q_f32(sum_w + x, vaddq_f32(vld1q_f32(sum_w + x), w_lo));
+        vst1q_f32(sum_w + x + 4, vaddq_f32(vld1q_f32(sum_w + x + 4), w_hi));
+        vst1q_f32(sum_d + x, vaddq_f32(vld1q_f32(sum_d + x), vmulq_f32(w_lo, d_lo)));
+        vst1q_f32(sum_d + x + 4, vaddq_f32(vld1q_f32(sum_d + x + 4), vmulq_f32(w_hi, d_hi)));
+    }
+    accumulate_tail(tap, color, sum_w, sum_d, x, count);
+}
+
+#endif
+
+accumulate_fn select_accumulate() {
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: return accumulate_avx2;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: return accumulate_neon;
+#endif
+    default: return accumulate_scalar;
+    }
+}
+
+} // namespace
+
+joint_bilateral_filter::joint_bilateral_filter(const joint_bilateral_options& options) {
+    set_options(options);
+}
+
+void joint_bilateral_filter::set_options(const joint_bilateral_options& options) {
+    if (options.radius < 1 || options.sigma_space <= 0 || options.sigma_color <= 0) {
+        throw std::invalid_argument("joint_bilateral_filter: radius and sigmas must be positive");
+    }
+    options_ = options;
+
+    const int r = options.radius;
+    space_weights_.clear();
+    for (int dy = -r; dy <= r; ++dy) {
+        for (int dx = -r; dx <= r; ++dx) {
+            space_weights_.push_back(std::exp(-(dx * dx + dy * dy) / (2 * options.sigma_space * options.sigma_space)));
+        }
+    }
+
+    // 前 15 档覆盖 3 sigma，每档取下边界处的高斯值，第 0 档为 255
+    color_shift_ = 0;
+    while ((color_bins - 1) << color_shift_ < 3 * options.sigma_color && color_shift_ < 6) {
+        ++color_shift_;
+    }
+    for (int b = 0; b < color_bins; ++b) {
+        const float distance = float(b << color_shift_);
+        color_weights_[b] = uint8_t(std::lround(255 * std::exp(-distance * distance /
+                                                               (2 * options.sigma_color * options.sigma_color))));
+    }
+}
+
+void joint_bilateral_filter::process(const cv::Mat& depth, const cv::Mat& guide, cv::Mat& out) {
+    RSD_TRACE_SCOPE("joint_bilateral");
+    CV_Assert(depth.type() == CV_16UC1 && guide.type() == CV_8UC3 && depth.size() == guide.size());
+
+    // 边界复制一次，内层循环不再需要判断越界
+    const int r = options_.radius;
+    cv::copyMakeBorder(depth, padded_depth_, r, r, r, r, cv::BORDER_REPLICATE);
+    cv::copyMakeBorder(guide, padded_guide_, r, r, r, r, cv::BORDER_REPLICATE);
+    cv::split(padded_guide_, guide_planes_);
+    out.create(depth.size(), CV_16UC1);
+
+    const accumulate_fn accumulate = select_accumulate();
+    color_table color;
+    color.weights = color_weights_;
+    color.shift = color_shift_;
+    const int cols = depth.cols;
+
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        cv::AutoBuffer<float> sums(2 * size_t(cols));
+        float* sum_w = sums.data();
+        float* sum_d = sum_w + cols;
+
+        for (int y = range.start; y < range.end; ++y) {
+            std::fill(sum_w, sum_w + 2 * cols, 0.0f);
+
+            tap_row tap;
+            for (int c = 0; c < 3; ++c) {
+                tap.center[c] = guide_planes_[c].ptr<uint8_t>(y + r) + r;
+            }
+            int k = 0;
+            for (int dy = -r; dy <= r; ++dy) {
+                for (int dx = -r; dx <= r; ++dx, ++k) {
+                    tap.depth = padded_depth_.ptr<uint16_t>(y + r + dy) + r + dx;
+                    for (int c = 0; c < 3; ++c) {
+                        tap.plane[c] = guide_planes_[c].ptr<uint8_t>(y + r + dy) + r + dx;
+                    }
+                    tap.space = space_weights_[k];
+                    accumulate(tap, color, sum_w, sum_d, cols);
+                }
+            }
+
+            uint16_t* dst = out.ptr<uint16_t>(y);
+            for (int x = 0; x < cols; ++x) {
+                dst[x] = sum_w[x] > 0 ? uint16_t(sum_d[x] / sum_w[x] + 0.5f) : 0;
+            }
+        }
+    });
+}
+
+} // namespace rsd
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rsd {
+
+struct joint_bilateral_options {
+    int radius;           // 邻域半径，窗口为 (2r+1)x(2r+1)
+    float sigma_space;    // 空间高斯（像素）
+    float sigma_color;    // 颜色高斯，以 BGR 三通道绝对差之和计
+
+    joint_bilateral_options(int radius = 2, float sigma_space = 2.0f, float sigma_color = 20.0f)
+        : radius(radius), sigma_space(sigma_space), sigma_color(sigma_color) {}
+};
+
+// 彩色引导的联合双边滤波，直接处理 Z16：
+// 邻域像素的权重 = 空间权重 x 颜色相似度（与中心像素的 BGR 差查表），深度为 0 的邻域像素不参与。
+// 深度边缘通常与颜色边缘重合，因此单次滤波即可去噪并保持边缘与彩色图对齐。
+// 颜色权重为 16 档 8 位查找表，可放进一个寄存器用 pshufb / vtbl 查表；按行并行，每次处理 8 个像素
+class joint_bilateral_filter {
+public:
+    explicit joint_bilateral_filter(const joint_bilateral_options& options = joint_bilateral_options());
+
+    void set_options(const joint_bilateral_options& options);
+    const joint_bilateral_options& options() const { return options_; }
+
+    // depth 为 CV_16UC1，guide 为同尺寸 CV_8UC3（BGR），out 为 CV_16UC1（可与 depth 相同）
+    void process(const cv::Mat& depth, const cv::Mat& guide, cv::Mat& out);
+
+private:
+    joint_bilateral_options options_;
+    std::vector<float> space_weights_;   // 每个邻域偏移的空间权重
+    uint8_t color_weights_[16];          // BGR 绝对差之和 >> color_shift_ -> 颜色权重（16 档）
+    int color_shift_;
+    cv::Mat padded_depth_;               // 边界复制后的输入，跨帧复用
+    cv::Mat padded_guide_;
+    std::vector<cv::Mat> guide_planes_;  // 引导图按通道拆分，便于 SIMD 逐通道求差
+};
+
+} // namespace rsd
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace rsd {
+
+// 单槽邮箱：写入方总是覆盖槽中的值、从不等待，读取方取走最新的一份。
+// 适合生产快、消费慢且只关心最新数据的场合（例如显示），旧值被覆盖时计数
+template <typename T>
+class mailbox {
+public:
+    mailbox() : full_(false), posted_(0), overwritten_(0) {}
+
+    mailbox(const mailbox&) = delete;
+    mailbox& operator=(const mailbox&) = delete;
+
+    // 覆盖了未被取走的旧值时返回 true
+    bool put(T&& value) {
+        bool replaced;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replaced = full_;
+            if (full_) {
+                ++overwritten_;
+            }
+            value_ = std::move(value);
+            full_ = true;
+            ++posted_;
+        }
+        ready_.notify_one();
+        return replaced;
+    }
+
+    // 取走槽中的值，槽为空时返回 false
+    bool try_take(T& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return take_locked(out);
+    }
+
+    // 等待至多 timeout_ms 毫秒
+    bool take(T& out, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return full_; });
+        return take_locked(out);
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !full_;
+    }
+
+    uint64_t posted() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return posted_;
+    }
+
+    // 未被取走就被覆盖的次数
+    uint64_t overwritten() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return overwritten_;
+    }
+
+private:
+    bool take_locked(T& out) {
+        if (!full_) {
+            return false;
+        }
+        out = std::move(value_);
+        value_ = T();   // 释放槽中持有的资源（例如帧内存）
+        full_ = false;
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    T value_;
+    bool full_;
+    uint64_t posted_;
+    uint64_t overwritten_;
+};
+
+} // namespace rsd
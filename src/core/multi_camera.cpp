@@ -0,0 +1,277 @@
+#include "core/multi_camera.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+namespace rsd {
+
+struct multi_camera::device {
+    source_config config;
+    std::unique_ptr<frame_source> source;
+    std::unique_ptr<stage_pipeline> pipeline;
+    frame_packet head;          // 等待配组的帧
+    bool has_head = false;
+    double head_timestamp = 0;
+    uint64_t unmatched = 0;
+};
+
+namespace {
+
+double depth_timestamp(const frame_packet& packet) {
+    rs2::depth_frame depth = packet.frames.get_depth_frame();
+    return depth ? depth.get_timestamp() : packet.frames.get_timestamp();
+}
+
+} // namespace
+
+std::vector<device_info> list_devices() {
+    std::vector<device_info> result;
+    rs2::context ctx;
+    for (auto&& dev : ctx.query_devices()) {
+        device_info info;
+        info.serial = dev.supports(RS2_CAMERA_INFO_SERIAL_NUMBER) ? dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER) : "";
+        info.name = dev.supports(RS2_CAMERA_INFO_NAME) ? dev.get_info(RS2_CAMERA_INFO_NAME) : "";
+        result.push_back(info);
+    }
+    return result;
+}
+
+multi_camera::multi_camera(const std::vector<source_config>& sources, const multi_camera_options& options)
+    : options_(options), tolerance_ms_(options.sync_tolerance_ms) {
+    if (sources.empty()) {
+        throw std::invalid_argument("multi_camera: no sources");
+    }
+    int max_fps = 0;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        std::unique_ptr<device> d(new device);
+        d->config = sources[i];
+        d->source = make_frame_source(sources[i]);
+        devices_.push_back(std::move(d));
+        max_fps = std::max(max_fps, sources[i].depth_fps);
+    }
+    if (tolerance_ms_ < 0) {
+        tolerance_ms_ = max_fps > 0 ? 500.0 / max_fps : 0;
+    }
+}
+
+multi_camera::~multi_camera() {
+    stop();
+}
+
+frame_source& multi_camera::source(size_t device) {
+    return *devices_.at(device)->source;
+}
+
+void multi_camera::set_processing(process_fn fn) {
+    if (running_) {
+        throw std::logic_error("multi_camera: cannot change processing while running");
+    }
+    process_ = fn;
+}
+
+void multi_camera::start() {
+    if (running_) {
+        return;
+    }
+    // 每台设备 1 个采集线程，有处理函数时另加 1 个处理线程；CPU 不够时交给系统调度
+    const int threads_per_device = process_ ? 2 : 1;
+    const int cpu_count = int(std::thread::hardware_concurrency());
+    const bool pin = options_.pin_threads && cpu_count > 0 &&
+                     int(devices_.size()) * threads_per_device <= cpu_count;
+
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        device& d = *devices_[i];
+        d.source->start();
+        d.pipeline.reset(new stage_pipeline(options_.policy, options_.queue_capacity));
+
+        frame_source* source = d.source.get();
+        d.pipeline->set_source([source](frame_packet& packet) {
+            if (!source->next(packet.frames)) {
+                return false;
+            }
+            packet.depth = packet.frames.get_depth_frame();
+            return true;
+        });
+        if (process_) {
+            process_fn fn = process_;
+            d.pipeline->add_stage("process", [fn, i](frame_packet& packet) { return fn(i, packet); });
+        }
+        if (pin) {
+            std::vector<int> cpus;
+            for (int k = 0; k < threads_per_device; ++k) {
+                cpus.push_back(int(i) * threads_per_device + k);
+            }
+            d.pipeline->set_cpus(cpus);
+        }
+        d.pipeline->start();
+    }
+    running_ = true;
+    finished_ = false;
+}
+
+void multi_camera::stop() {
+    if (!running_) {
+        return;
+    }
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        devices_[i]->pipeline->stop();
+    }
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        devices_[i]->source->stop();
+    }
+    running_ = false;
+}
+
+bool multi_camera::next(multi_frame& out, int timeout_ms) {
+    if (!running_ || finished_) {
+        return false;
+    }
+    RSD_TRACE_SCOPE("merge");
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    for (;;) {
+        // 补齐每台设备的待配组帧
+        for (size_t i = 0; i < devices_.size(); ++i) {
+            device& d = *devices_[i];
+            if (d.has_head) {
+                continue;
+            }
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (!d.pipeline->pop_output(d.head, int(std::max<int64_t>(0, remaining)))) {
+                if (d.pipeline->finished()) {
+                    finished_ = true;
+                }
+                return false;
+            }
+            d.head_timestamp = depth_timestamp(d.head);
+            d.has_head = true;
+        }
+
+        double oldest = devices_[0]->head_timestamp;
+        double newest = oldest;
+        for (size_t i = 1; i < devices_.size(); ++i) {
+            oldest = std::min(oldest, devices_[i]->head_timestamp);
+            newest = std::max(newest, devices_[i]->head_timestamp);
+        }
+
+        if (newest - oldest <= tolerance_ms_) {
+            out.sequence = sets_++;
+            out.views.resize(devices_.size());
+            out.timestamps.resize(devices_.size());
+            out.spread_ms = newest - oldest;
+            for (size_t i = 0; i < devices_.size(); ++i) {
+                device& d = *devices_[i];
+                out.views[i] = std::move(d.head);
+                out.timestamps[i] = d.head_timestamp;
+                d.head = frame_packet();
+                d.has_head = false;
+            }
+            return true;
+        }
+
+        // 比最新一帧早超过容差的帧不可能再与其他设备配上，丢弃后取该设备的下一帧
+        for (size_t i = 0; i < devices_.size(); ++i) {
+            device& d = *devices_[i];
+            if (d.head_timestamp < newest - tolerance_ms_) {
+                d.head = frame_packet();
+                d.has_head = false;
+                ++d.unmatched;
+            }
+        }
+    }
+}
+
+bool multi_camera::finished() const {
+    return finished_;
+}
+
+std::vector<multi_camera::device_stats> multi_camera::stats() const {
+    std::vector<device_stats> result;
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        const device& d = *devices_[i];
+        device_stats s;
+        s.description = d.source->description();
+        s.captured = 0;
+        s.dropped = 0;
+        s.unmatched = d.unmatched;
+        if (d.pipeline) {
+            // 采集线程仍在运行，计数取流水线的原子统计
+            const std::vector<stage_pipeline::stage_stats> stages = d.pipeline->stats();
+            s.captured = stages.front().processed;
+            for (const stage_pipeline::stage_stats& stage : stages) {
+                s.dropped += stage.dropped;
+            }
+        }
+        result.push_back(s);
+    }
+    return result;
+}
+
+std::vector<source_config> parse_multi_source_args(int argc, char** argv, const source_config& base) {
+    source_config common = base;
+    parse_source_args(argc, argv, common);
+
+    std::vector<source_config> result;
+    std::vector<std::string> serials;
+    int cameras = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--bag") {
+            source_config config = common;
+            config.kind = source_kind::bag;
+            config.bag_path = argv[++i];
+            result.push_back(config);
+        } else if (arg == "--sequence") {
+            source_config config = common;
+            config.kind = source_kind::sequence;
+            config.sequence_path = argv[++i];
+            result.push_back(config);
+        } else if (arg == "--serial") {
+            serials.push_back(argv[++i]);
+        } else if (arg == "--cameras") {
+            cameras = std::atoi(argv[++i]);
+            if (cameras <= 0) {
+                throw std::invalid_argument("--cameras expects a positive number");
+            }
+        }
+    }
+    if (!result.empty()) {
+        return result;
+    }
+
+    if (common.kind == source_kind::synthetic) {
+        for (int i = 0; i < (cameras > 0 ? cameras : 2); ++i) {
+            source_config config = common;
+            config.synthetic.seed = common.synthetic.seed + uint32_t(i);
+            result.push_back(config);
+        }
+        return result;
+    }
+
+    if (serials.empty()) {
+        for (const device_info& info : list_devices()) {
+            serials.push_back(info.serial);
+        }
+    }
+    if (cameras > 0 && serials.size() > size_t(cameras)) {
+        serials.resize(size_t(cameras));
+    }
+    for (size_t i = 0; i < serials.size(); ++i) {
+        source_config config = common;
+        config.kind = source_kind::live;
+        config.serial = serials[i];
+        config.global_time = true;
+        result.push_back(config);
+    }
+    if (result.empty()) {
+        throw std::invalid_argument("no cameras connected; use --bag, --sequence or --synthetic");
+    }
+    return result;
+}
+
+} // namespace rsd
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "core/frame_source.hpp"
+#include "core/stage_pipeline.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rsd {
+
+// 已连接的设备
+struct device_info {
+    std::string serial;
+    std::string name;
+};
+
+// 枚举当前连接的 RealSense 设备（与 print_info 相同，经 rs2::context 查询）
+std::vector<device_info> list_devices();
+
+struct multi_camera_options {
+    drop_policy policy = drop_policy::keep_latest;
+    size_t queue_capacity = 4;      // 级间队列容量，只在 policy 为 block 时生效；keep_latest 时每级只保留最新一帧
+    double sync_tolerance_ms = -1;  // 同一组内时间戳的最大差值，小于 0 时取最高帧率的半个帧间隔
+    bool pin_threads = true;        // 各设备的线程绑定到不同的 CPU（线程数超过 CPU 数时不绑定）
+};
+
+// 按时间戳对齐的一组多视图帧
+struct multi_frame {
+    uint64_t sequence = 0;
+    std::vector<frame_packet> views;   // 按设备顺序
+    std::vector<double> timestamps;    // 各视图深度帧的时间戳（毫秒）
+    double spread_ms = 0;              // 组内最大与最小时间戳之差
+};
+
+// 多相机运行时：每台设备一个 stage_pipeline（采集线程 + 可选的处理线程），各自绑定 CPU，
+// 设备之间不共享任何状态，因此吞吐随核数近似线性增长。调用线程用 next() 按硬件时间戳把各设备的输出
+// 合并成同步的多视图组：组内时间戳之差超过容差时丢弃最旧的一帧，再取该设备的下一帧。
+// 实时相机开启全局时间（见 source_config::global_time），不同设备的时间戳才可比较；
+// 合成数据的时间戳为帧序号 / 帧率，多个合成来源天然对齐，可以代替相机测试
+class multi_camera {
+public:
+    // 处理函数在设备自己的处理线程中调用，device 为设备序号；返回 false 表示丢弃这一帧
+    typedef std::function<bool(size_t device, frame_packet&)> process_fn;
+
+    struct device_stats {
+        std::string description;
+        uint64_t captured;    // 采集到的帧数
+        uint64_t dropped;     // 流水线中因积压丢弃的帧数
+        uint64_t unmatched;   // 合并时找不到同步帧而丢弃的帧数
+    };
+
+    explicit multi_camera(const std::vector<source_config>& sources,
+                          const multi_camera_options& options = multi_camera_options());
+    ~multi_camera();
+
+    multi_camera(const multi_camera&) = delete;
+    multi_camera& operator=(const multi_camera&) = delete;
+
+    // 必须在 start() 之前调用
+    void set_processing(process_fn fn);
+
+    void start();
+    void stop();
+
+    size_t size() const { return devices_.size(); }
+    frame_source& source(size_t device);
+    double sync_tolerance_ms() const { return tolerance_ms_; }
+
+    // 取出下一组同步帧；超时返回 false（可以再次调用），任一设备结束后也返回 false，见 finished()
+    bool next(multi_frame& out, int timeout_ms = 1000);
+
+    // 任一设备的数据源已结束，不会再有完整的组
+    bool finished() const;
+
+    uint64_t set_count() const { return sets_; }
+    std::vector<device_stats> stats() const;
+
+private:
+    struct device;
+
+    multi_camera_options options_;
+    std::vector<std::unique_ptr<device>> devices_;
+    process_fn process_;
+    double tolerance_ms_;
+    uint64_t sets_ = 0;
+    bool running_ = false;
+    bool finished_ = false;
+};
+
+// 从命令行生成多个帧来源的配置，公共参数（--size、--fps、--realtime、--loop、--frames）按 parse_source_args 处理：
+//   --bag <file> / --sequence <file>  可重复，每个文件一路
+//   --synthetic --cameras <n>         n 路合成数据（默认 2），各路噪声种子不同
+//   --serial <sn>                     可重复，指定实时相机；未指定时使用全部已连接的设备，--cameras 限制数量
+// 没有任何来源时抛出 std::invalid_argument
+std::vector<source_config> parse_multi_source_args(int argc, char** argv, const source_config& base);
+
+} // namespace rsd
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace rsd {
+namespace pixel {
+
+// 编译期融合的逐像素处理链（只有头文件）：
+//   auto kernel = pixel::invalid_mask(100, 5000) | pixel::scale(255.0f / 5000) | pixel::fill_invalid(0);
+//   pixel::apply<uint8_t>(kernel, depth, out);
+// 每个阶段是一个小函数对象，用 | 组合成一个类型，apply 时整条链内联展开：
+// 不论有多少个阶段，都只读一次输入、写一次输出，不产生中间 Mat。
+// 一行按 block_size 个像素分块，各阶段依次处理同一块，中间结果只在栈上的块缓冲里（留在 L1 缓存中）。
+// 每个阶段对块是一个没有分支的简单循环，编译器可以可靠地向量化；把整条链写成一个逐像素内核时，
+// 有效标志带来的选择会被编译器拆成分支，反而无法向量化。按行分条带并行执行。
+// 每个像素带一个有效标志，invalid_mask 清除它，fill_invalid 用给定值替换无效像素，写出时仍无效的像素输出 0。
+// 值的类型沿链传递：uint16 乘以 float 得到 float，写出时饱和转换（四舍五入）为输出类型
+
+// 每块的像素数
+const int block_size = 256;
+
+// 所有阶段的基类，只用于识别可以用 | 组合的类型。
+// 阶段提供 result<T>（输入类型为 T 时的输出类型）、masks（是否读写有效标志）和
+// run(in, out, valid, n)：处理一块 n 个像素，in 与 out 不重叠
+struct stage {};
+
+template <typename T>
+using is_stage = std::is_base_of<stage, std::decay_t<T>>;
+
+// 饱和转换：浮点转整数时四舍五入（远离 0），超出范围的值截断到目标类型的上下限
+template <typename U, typename T>
+inline U saturate(T v) {
+    if constexpr (std::is_same<U, T>::value) {
+        return v;
+    } else if constexpr (std::is_integral<U>::value && std::is_floating_point<T>::value) {
+        // 先截断再转换；目标不超过 16 位时经 int32 转换，向量化时不必扩展到 64 位
+        using wide = std::conditional_t<(sizeof(U) < 4), int32_t, int64_t>;
+        const T lo = T(std::numeric_limits<U>::lowest());
+        const T hi = T(std::numeric_limits<U>::max());
+        if constexpr (std::is_unsigned<U>::value) {
+            return U(wide(std::min(std::max(v + T(0.5), lo), hi + T(0.5))));
+        } else {
+            const T rounded = v + (v >= T(0) ? T(0.5) : T(-0.5));
+            return U(wide(std::min(std::max(rounded, lo), hi)));
+        }
+    } else if constexpr (std::is_integral<U>::value && std::is_integral<T>::value) {
+        // 两边都不超过 16 位时在 int32 中比较，向量化时不必扩展到 64 位
+        using wide = std::conditional_t<(sizeof(T) < 4 && sizeof(U) < 4), int32_t, int64_t>;
+        const wide lo = wide(std::numeric_limits<U>::lowest());
+        const wide hi = wide(std::numeric_limits<U>::max());
+        return U(std::min(std::max(wide(v), lo), hi));
+    } else {
+        return U(v);
+    }
+}
+
+// a | b：先执行 a，再执行 b，a 的输出放在栈上的块缓冲里
+template <typename A, typename B>
+struct fused : stage {
+    A first;
+    B second;
+
+    template <typename T>
+    using result = typename B::template result<typename A::template result<T>>;
+
+    static constexpr bool masks = A::masks || B::masks;
+
+    fused(const A& first, const B& second) : first(first), second(second) {}
+
+    template <typename T>
+    void run(const T* in, result<T>* out, uint8_t* valid, int n) const {
+        typename A::template result<T> between[block_size];
+        first.run(in, between, valid, n);
+        second.run(between, out, valid, n);
+    }
+};
+
+template <typename A, typename B, typename = std::enable_if_t<is_stage<A>::value && is_stage<B>::value>>
+fused<std::decay_t<A>, std::decay_t<B>> operator|(A&& a, B&& b) {
+    return fused<std::decay_t<A>, std::decay_t<B>>(a, b);
+}
+
+// 截断到 [lo, hi]，值的类型不变
+template <typename P>
+struct clip_stage : stage {
+    P lo, hi;
+
+    template <typename T>
+    using result = T;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, T* __restrict out, uint8_t*, int n) const {
+        const T l = T(lo), h = T(hi);
+        for (int i = 0; i < n; ++i) {
+            out[i] = std::min(std::max(in[i], l), h);
+        }
+    }
+};
+
+template <typename P>
+clip_stage<P> clip(P lo, P hi) {
+    return {{}, lo, hi};
+}
+
+// 乘以 k，值的类型提升为两者的公共类型（整数乘以 float 得到 float）
+template <typename P>
+struct scale_stage : stage {
+    P k;
+
+    template <typename T>
+    using result = std::common_type_t<T, P>;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, result<T>* __restrict out, uint8_t*, int n) const {
+        using R = result<T>;
+        const R factor = R(k);
+        for (int i = 0; i < n; ++i) {
+            out[i] = R(in[i]) * factor;
+        }
+    }
+};
+
+template <typename P>
+scale_stage<P> scale(P k) {
+    return {{}, k};
+}
+
+// 加上 b，类型规则同 scale
+template <typename P>
+struct offset_stage : stage {
+    P b;
+
+    template <typename T>
+    using result = std::common_type_t<T, P>;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, result<T>* __restrict out, uint8_t*, int n) const {
+        using R = result<T>;
+        const R addend = R(b);
+        for (int i = 0; i < n; ++i) {
+            out[i] = R(in[i]) + addend;
+        }
+    }
+};
+
+template <typename P>
+offset_stage<P> offset(P b) {
+    return {{}, b};
+}
+
+// 定点乘法：out = (x * mul + 2^(shift-1)) >> shift，mul = round(k * 2^shift)，全程 uint32 整数运算。
+// 输入须为不小于 0、不大于 max_input 的整数（前面用 clip 限定），输出为 uint32
+struct fixed_scale_stage : stage {
+    uint32_t mul;
+    int shift;
+
+    template <typename T>
+    using result = uint32_t;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, uint32_t* __restrict out, uint8_t*, int n) const {
+        static_assert(std::is_integral<T>::value, "pixel::fixed_scale needs an integer input");
+        const uint32_t round = shift > 0 ? 1u << (shift - 1) : 0u;
+        for (int i = 0; i < n; ++i) {
+            out[i] = (uint32_t(in[i]) * mul + round) >> shift;
+        }
+    }
+};
+
+// 选择不超过 24 的最大 shift，使 max_input * mul 在 uint32 中不溢出；k 为负或过大时抛出 std::invalid_argument
+inline fixed_scale_stage fixed_scale(double k, uint32_t max_input = 65535) {
+    if (!(k >= 0)) {
+        throw std::invalid_argument("pixel::fixed_scale: factor must not be negative");
+    }
+    for (int shift = 24; shift >= 0; --shift) {
+        const double mul = std::floor(k * double(1u << shift) + 0.5);
+        const double round = shift > 0 ? double(1u << (shift - 1)) : 0.0;
+        if (double(max_input) * mul + round <= double(std::numeric_limits<uint32_t>::max())) {
+            return {{}, uint32_t(mul), shift};
+        }
+    }
+    throw std::invalid_argument("pixel::fixed_scale: factor too large for the input range");
+}
+
+// 转换为 U（饱和、四舍五入），用于在链中途缩窄类型，例如先量化到 uint8 再查表
+template <typename U>
+struct convert_stage : stage {
+    template <typename T>
+    using result = U;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, U* __restrict out, uint8_t*, int n) const {
+        for (int i = 0; i < n; ++i) {
+            out[i] = saturate<U>(in[i]);
+        }
+    }
+};
+
+template <typename U>
+convert_stage<U> convert() {
+    return {};
+}
+
+// 大于 t 时取 above，否则取 below
+template <typename P, typename R>
+struct threshold_stage : stage {
+    P t;
+    R above, below;
+
+    template <typename T>
+    using result = R;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, R* __restrict out, uint8_t*, int n) const {
+        const T limit = T(t);
+        for (int i = 0; i < n; ++i) {
+            const T x = in[i];
+            out[i] = x > limit ? above : below;
+        }
+    }
+};
+
+template <typename P, typename R>
+threshold_stage<P, R> threshold(P t, R above, R below) {
+    return {{}, t, above, below};
+}
+
+// 查表：值（整数）作为下标，超出表长的值取最后一项。查表需要逐元素读取，这一阶段不能向量化，
+// 但整条链仍然只有一次遍历。表由调用方持有，在 apply 期间有效
+template <typename E>
+struct lut_stage : stage {
+    const E* table;
+    size_t size;
+
+    template <typename T>
+    using result = E;
+
+    static constexpr bool masks = false;
+
+    template <typename T>
+    void run(const T* __restrict in, E* __restrict out, uint8_t*, int n) const {
+        static_assert(std::is_integral<T>::value, "pixel::lut needs an integer input; use convert<> first");
+        for (int i = 0; i < n; ++i) {
+            const T x = in[i];
+            out[i] = table[std::min(size_t(x < T(0) ? T(0) : x), size - 1)];
+        }
+    }
+};
+
+template <typename E>
+lut_stage<E> lut(const E* table, size_t size) {
+    return {{}, table, size};
+}
+
+template <typename E>
+lut_stage<E> lut(const std::vector<E>& table) {
+    return {{}, table.data(), table.size()};
+}
+
+// 值在 [lo, hi] 之外的像素标记为无效（深度中 0 表示没有测量值，通常以 lo > 0 一并排除）
+template <typename P>
+struct invalid_mask_stage : stage {
+    P lo, hi;
+
+    template <typename T>
+    using result = T;
+
+    static constexpr bool masks = true;
+
+    template <typename T>
+    void run(const T* __restrict in, T* __restrict out, uint8_t* __restrict valid, int n) const {
+        const T l = T(lo), h = T(hi);
+        for (int i = 0; i < n; ++i) {
+            const T x = in[i];
+            valid[i] &= uint8_t((x >= l) & (x <= h));
+            out[i] = x;
+        }
+    }
+};
+
+template <typename P>
+invalid_mask_stage<P> invalid_mask(P lo, P hi) {
+    return {{}, lo, hi};
+}
+
+// 只排除小于 lo 的像素
+template <typename P>
+struct invalid_below_stage : stage {
+    P lo;
+
+    template <typename T>
+    using result = T;
+
+    static constexpr bool masks = true;
+
+    template <typename T>
+    void run(const T* __restrict in, T* __restrict out, uint8_t* __restrict valid, int n) const {
+        const T l = T(lo);
+        for (int i = 0; i < n; ++i) {
+            const T x = in[i];
+            valid[i] &= uint8_t(x >= l);
+            out[i] = x;
+        }
+    }
+};
+
+template <typename P>
+invalid_below_stage<P> invalid_below(P lo) {
+    return {{}, lo};
+}
+
+// 无效像素的值替换为 v，之后视为有效
+template <typename P>
+struct fill_invalid_stage : stage {
+    P v;
+
+    template <typename T>
+    using result = T;
+
+    static constexpr bool masks = true;
+
+    template <typename T>
+    void run(const T* __restrict in, T* __restrict out, uint8_t* __restrict valid, int n) const {
+        const T fill = T(v);
+        for (int i = 0; i < n; ++i) {
+            // 先无条件读出，选择才能向量化
+            const T x = in[i];
+            out[i] = valid[i] != 0 ? x : fill;
+        }
+        std::memset(valid, 1, size_t(n));
+    }
+};
+
+template <typename P>
+fill_invalid_stage<P> fill_invalid(P v) {
+    return {{}, v};
+}
+
+// 对一行 count 个像素执行融合内核；src 与 dst 不能重叠。链中没有读写有效标志的阶段时省去标志
+template <typename Out, typename In, typename Kernel>
+inline void apply_row(const Kernel& kernel, const In* src, Out* __restrict dst, int count) {
+    using R = typename Kernel::template result<In>;
+    uint8_t valid[block_size];
+    R values[block_size];
+    for (int x = 0; x < count; x += block_size) {
+        const int n = std::min(block_size, count - x);
+        Out* out = dst + x;
+        if (Kernel::masks) {
+            std::memset(valid, 1, size_t(n));
+        }
+        kernel.run(src + x, values, valid, n);
+        for (int i = 0; i < n; ++i) {
+            const Out q = saturate<Out>(values[i]);
+            out[i] = !Kernel::masks || valid[i] != 0 ? q : Out(0);
+        }
+    }
+}
+
+// 对整幅图执行融合内核：src 的类型须为 In（默认 uint16 深度），dst 分配为同尺寸的 Out（已分配则复用），
+// 两者不能共用内存。像素数较少时串行执行，避免并行调度开销
+template <typename Out, typename In = uint16_t, typename Kernel>
+void apply(const Kernel& kernel, const cv::Mat& src, cv::Mat& dst) {
+    static_assert(is_stage<Kernel>::value, "pixel::apply needs a stage or a chain of stages");
+    CV_Assert(src.type() == cv::DataType<In>::type);
+    dst.create(src.size(), cv::DataType<Out>::type);
+    CV_Assert(dst.data != src.data);
+
+    const int cols = src.cols;
+    auto rows = [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            apply_row<Out>(kernel, src.ptr<In>(y), dst.ptr<Out>(y), cols);
+        }
+    };
+    const size_t parallel_min_pixels = 64 * 1024;
+    if (src.total() < parallel_min_pixels) {
+        rows(cv::Range(0, src.rows));
+    } else {
+        cv::parallel_for_(cv::Range(0, src.rows), rows);
+    }
+}
+
+} // namespace pixel
+} // namespace rsd
@@ -0,0 +1,446 @@
+#include "core/point_cloud.hpp"
+#include "core/simd.hpp"
+#include "core/trace.hpp"
+
+#include <librealsense2/rsutil.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+struct deproject_params {
+    int32_t min_depth;
+    int32_t max_depth;
+    float depth_scale;
+};
+
+// 有效点的紧凑写出：掩码的第 i 位为 1 表示第 i 路有效，表项依次列出有效路的序号
+struct compress_table {
+    uint32_t lanes8[256][8];     // AVX2 _mm256_permutevar8x32 的下标
+    uint8_t bytes4[16][16];      // SSE _mm_shuffle_epi8 的字节下标（4 路 32 位）
+    uint8_t count[256];
+
+    compress_table() {
+        for (int mask = 0; mask < 256; ++mask) {
+            int n = 0;
+            for (int lane = 0; lane < 8; ++lane) {
+                if (mask & (1 << lane)) {
+                    lanes8[mask][n++] = uint32_t(lane);
+                }
+            }
+            count[mask] = uint8_t(n);
+            for (int k = n; k < 8; ++k) {
+                lanes8[mask][k] = 0;
+            }
+        }
+        for (int mask = 0; mask < 16; ++mask) {
+            for (int k = 0; k < 4; ++k) {
+                const int lane = int(lanes8[mask][k]);
+                for (int b = 0; b < 4; ++b) {
+                    bytes4[mask][4 * k + b] = uint8_t(4 * lane + b);
+                }
+            }
+        }
+    }
+};
+
+const compress_table& compress_lut() {
+    static const compress_table table;
+    return table;
+}
+
+// 各实现处理 src[0, count) 个连续像素，first_pixel 为 src[0] 的像素序号，
+// 有效点依次写到 out 的 written 处，返回写出后的点数。
+// 写出位置不会超过已处理的像素数，out 只需容纳全部像素
+size_t deproject_scalar(const uint16_t* src, const float* ray_x, const float* ray_y, size_t count,
+                        uint32_t first_pixel, const deproject_params& p, point_cloud& out, size_t written) {
+    float* ox = out.x.data();
+    float* oy = out.y.data();
+    float* oz = out.z.data();
+    uint32_t* op = out.pixel.data();
+    for (size_t i = 0; i < count; ++i) {
+        const int32_t d = src[i];
+        const float z = float(d) * p.depth_scale;
+        // 无条件写出，只在有效时前移，避免分支预测失败
+        ox[written] = z * ray_x[i];
+        oy[written] = z * ray_y[i];
+        oz[written] = z;
+        op[written] = first_pixel + uint32_t(i);
+        written += (d >= p.min_depth) & (d <= p.max_depth);
+    }
+    return written;
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("sse4.1")
+size_t deproject_sse41(const uint16_t* src, const float* ray_x, const float* ray_y, size_t count,
+                       uint32_t first_pixel, const deproject_params& p, point_cloud& out, size_t written) {
+    const compress_table& lut = compress_lut();
+    const __m128i vmin = _mm_set1_epi32(p.min_depth - 1);
+    const __m128i vmax = _mm_set1_epi32(p.max_depth + 1);
+    const __m128 vscale = _mm_set1_ps(p.depth_scale);
+    __m128i pixel = _mm_add_epi32(_mm_set1_epi32(int(first_pixel)), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i step = _mm_set1_epi32(4);
+    float* ox = out.x.data();
+    float* oy = out.y.data();
+    float* oz = out.z.data();
+    uint32_t* op = out.pixel.data();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i d = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        const __m128i valid = _mm_and_si128(_mm_cmpgt_epi32(d, vmin), _mm_cmpgt_epi32(vmax, d));
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(valid));
+        const __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(d), vscale);
+        const __m128 x = _mm_mul_ps(z, _mm_loadu_ps(ray_x + i));
+        const __m128 y = _mm_mul_ps(z, _mm_loadu_ps(ray_y + i));
+        const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut.bytes4[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ox + written), _mm_shuffle_epi8(_mm_castps_si128(x), shuffle));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(oy + written), _mm_shuffle_epi8(_mm_castps_si128(y), shuffle));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(oz + written), _mm_shuffle_epi8(_mm_castps_si128(z), shuffle));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(op + written), _mm_shuffle_epi8(pixel, shuffle));
+        pixel = _mm_add_epi32(pixel, step);
+        written += lut.count[mask];
+    }
+    return deproject_scalar(src + i, ray_x + i, ray_y + i, count - i, first_pixel + uint32_t(i), p, out, written);
+}
+
+RSD_TARGET("avx2")
+size_t deproject_avx2(const uint16_t* src, const float* ray_x, const float* ray_y, size_t count,
+                      uint32_t first_pixel, const deproject_params& p, point_cloud& out, size_t written) {
+    const compress_table& lut = compress_lut();
+    const __m256i vmin = _mm256_set1_epi32(p.min_depth - 1);
+    const __m256i vmax = _mm256_set1_epi32(p.max_depth + 1);
+    const __m256 vscale = _mm256_set1_ps(p.depth_scale);
+    __m256i pixel = _mm256_add_epi32(_mm256_set1_epi32(int(first_pixel)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i step = _mm256_set1_epi32(8);
+    float* ox = out.x.data();
+    float* oy = out.y.data();
+    float* oz = out.z.data();
+    uint32_t* op = out.pixel.data();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        const __m256i valid = _mm256_and_si256(_mm256_cmpgt_epi32(d, vmin), _mm256_cmpgt_epi32(vmax, d));
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(valid));
+        const __m256 z = _mm256_mul_ps(_mm256_cvtepi32_ps(d), vscale);
+        const __m256 x = _mm256_mul_ps(z, _mm256_loadu_ps(ray_x + i));
+        const __m256 y = _mm256_mul_ps(z, _mm256_loadu_ps(ray_y + i));
+        // 有效路移到低位后整组写出，多写的部分会被后面的点覆盖
+        const __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lut.lanes8[mask]));
+        _mm256_storeu_ps(ox + written, _mm256_permutevar8x32_ps(x, perm));
+        _mm256_storeu_ps(oy + written, _mm256_permutevar8x32_ps(y, perm));
+        _mm256_storeu_ps(oz + written, _mm256_permutevar8x32_ps(z, perm));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(op + written), _mm256_permutevar8x32_epi32(pixel, perm));
+        pixel = _mm256_add_epi32(pixel, step);
+        written += lut.count[mask];
+    }
+    return deproject_scalar(src + i, ray_x + i, ray_y + i, count - i, first_pixel + uint32_t(i), p, out, written);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+size_t deproject_neon(const uint16_t* src, const float* ray_x, const float* ray_y, size_t count,
+                      uint32_t first_pixel, const deproject_params& p, point_cloud& out, size_t written) {
+    const uint32x4_t vmin = vdupq_n_u32(uint32_t(p.min_depth));
+    const uint32x4_t vmax = vdupq_n_u32(uint32_t(p.max_depth));
+    float* ox = out.x.data();
+    float* oy = out.y.data();
+    float* oz = out.z.data();
+    uint32_t* op = out.pixel.data();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t d = vmovl_u16(vld1_u16(src + i));
+        const uint32x4_t valid = vandq_u32(vcgeq_u32(d, vmin), vcleq_u32(d, vmax));
+        const float32x4_t z = vmulq_n_f32(vcvtq_f32_u32(d), p.depth_scale);
+        float x[4], y[4], zs[4];
+        uint32_t v[4];
+        vst1q_f32(x, vmulq_f32(z, vld1q_f32(ray_x + i)));
+        vst1q_f32(y, vmulq_f32(z, vld1q_f32(ray_y + i)));
+        vst1q_f32(zs, z);
+        vst1q_u32(v, valid);
+        // NEON 没有按掩码压缩的指令，逐路无分支写出
+        for (int lane = 0; lane < 4; ++lane) {
+            ox[written] = x[lane];
+            oy[written] = y[lane];
+            oz[written] = zs[lane];
+            op[written] = first_pixel + uint32_t(i + lane);
+            written += v[lane] & 1;
+        }
+    }
+    return deproject_scalar(src + i, ray_x + i, ray_y + i, count - i, first_pixel + uint32_t(i), p, out, written);
+}
+
+#endif
+
+typedef size_t (*deproject_fn)(const uint16_t*, const float*, const float*, size_t, uint32_t,
+                               const deproject_params&, point_cloud&, size_t);
+
+deproject_fn select_deproject() {
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: return deproject_avx2;
+    case simd::isa::sse41: return deproject_sse41;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: return deproject_neon;
+#endif
+    default: return deproject_scalar;
+    }
+}
+
+// 截断取整在负数时向零取整，修正为向下取整
+inline int32_t floor_to_int(float v) {
+    const int32_t i = int32_t(v);
+    return i - (v < float(i));
+}
+
+// 每个分量 21 位（偏移 2^20 后按无符号存放），1 cm 体素时覆盖 ±10 km
+inline uint64_t voxel_key(int32_t ix, int32_t iy, int32_t iz) {
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return (uint64_t(ix + (1 << 20)) & mask) | ((uint64_t(iy + (1 << 20)) & mask) << 21) |
+           ((uint64_t(iz + (1 << 20)) & mask) << 42);
+}
+
+} // namespace
+
+void point_cloud::reserve(size_t points) {
+    if (x.size() < points) {
+        x.resize(points);
+        y.resize(points);
+        z.resize(points);
+        pixel.resize(points);
+    }
+}
+
+point_cloud_generator::point_cloud_generator(const point_cloud_options& options)
+    : options_(options), configured_(false), depth_scale_(0) {
+    std::memset(&intrinsics_, 0, sizeof(intrinsics_));
+}
+
+void point_cloud_generator::configure(const rs2_intrinsics& intrinsics, float depth_scale) {
+    if (configured_ && depth_scale == depth_scale_ && std::memcmp(&intrinsics, &intrinsics_, sizeof(intrinsics)) == 0) {
+        return;
+    }
+    if (intrinsics.width <= 0 || intrinsics.height <= 0 || depth_scale <= 0) {
+        throw std::invalid_argument("point_cloud_generator: invalid stream parameters");
+    }
+    intrinsics_ = intrinsics;
+    depth_scale_ = depth_scale;
+
+    // 与 rs2::pointcloud 相同，像素 (u, v) 按整数坐标反投影，畸变由 rsutil 处理
+    const size_t count = size_t(intrinsics.width) * intrinsics.height;
+    ray_x_.resize(count);
+    ray_y_.resize(count);
+    for (int v = 0; v < intrinsics.height; ++v) {
+        for (int u = 0; u < intrinsics.width; ++u) {
+            const float pixel[2] = {float(u), float(v)};
+            float ray[3];
+            rs2_deproject_pixel_to_point(ray, &intrinsics_, pixel, 1.0f);
+            const size_t i = size_t(v) * intrinsics.width + u;
+            ray_x_[i] = ray[0];
+            ray_y_[i] = ray[1];
+        }
+    }
+    configured_ = true;
+}
+
+void point_cloud_generator::configure(const rs2::depth_frame& frame) {
+    configure(frame.get_profile().as<rs2::video_stream_profile>().get_intrinsics(), frame.get_units());
+}
+
+void point_cloud_generator::process(const cv::Mat& depth, point_cloud& out) const {
+    RSD_TRACE_SCOPE("point_cloud");
+    if (!configured_) {
+        throw std::logic_error("point_cloud_generator: not configured");
+    }
+    CV_Assert(depth.type() == CV_16UC1 && depth.cols == intrinsics_.width && depth.rows == intrinsics_.height);
+
+    static const deproject_fn deproject = select_deproject();
+    const deproject_params p = {int32_t(options_.min_depth), int32_t(options_.max_depth), depth_scale_};
+    out.reserve(depth.total());
+
+    if (depth.isContinuous()) {
+        out.count = deproject(depth.ptr<uint16_t>(), ray_x_.data(), ray_y_.data(), depth.total(), 0, p, out, 0);
+        return;
+    }
+    size_t written = 0;
+    for (int v = 0; v < depth.rows; ++v) {
+        const size_t first = size_t(v) * depth.cols;
+        written = deproject(depth.ptr<uint16_t>(v), ray_x_.data() + first, ray_y_.data() + first, size_t(depth.cols),
+                            uint32_t(first), p, out, written);
+    }
+    out.count = written;
+}
+
+voxel_grid::voxel_grid(float leaf_size) : leaf_size_(0), bits_(0), stamp_(0) {
+    set_leaf_size(leaf_size);
+}
+
+void voxel_grid::set_leaf_size(float leaf_size) {
+    if (!(leaf_size > 0)) {
+        throw std::invalid_argument("voxel_grid: leaf size must be positive");
+    }
+    leaf_size_ = leaf_size;
+}
+
+void voxel_grid::downsample(const point_cloud& in, point_cloud& out) {
+    RSD_TRACE_SCOPE("voxel");
+    if (&in == &out) {
+        throw std::invalid_argument("voxel_grid: input and output must differ");
+    }
+    const size_t n = in.size();
+    out.reserve(n);
+    out.count = 0;
+    if (n == 0) {
+        return;
+    }
+
+    // 表按体素数而不是点数确定大小，小到可以留在缓存中；上一帧的大小作为起点，不够时加倍
+    if (table_.empty()) {
+        table_.assign(size_t(1) << 12, cell());
+        bits_ = 12;
+        stamp_ = 0;
+    }
+    if (++stamp_ == 0) {
+        for (cell& c : table_) {
+            c.stamp = 0;
+        }
+        stamp_ = 1;
+    }
+    if (counts_.size() < n) {
+        counts_.resize(n);
+        keys_.resize(n);
+    }
+
+    const float inv = 1.0f / leaf_size_;
+    const float* x = in.x.data();
+    const float* y = in.y.data();
+    const float* z = in.z.data();
+    float* sx = out.x.data();
+    float* sy = out.y.data();
+    float* sz = out.z.data();
+    uint32_t voxels = 0;
+    uint64_t last_key = ~uint64_t(0);
+    uint32_t last_voxel = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t key = voxel_key(floor_to_int(x[i] * inv), floor_to_int(y[i] * inv), floor_to_int(z[i] * inv));
+        // 点按像素顺序排列，同一行相邻的点常落在同一体素，不必查表
+        if (key != last_key) {
+            last_key = key;
+            cell* c = find(key);
+            if (c->stamp != stamp_) {
+                // 新体素；装载率超过 1/2 时加倍并重新插入已有体素
+                if (2 * (size_t(voxels) + 1) > table_.size()) {
+                    grow(voxels);
+                    c = find(key);
+                }
+                c->key = key;
+                c->stamp = stamp_;
+                c->voxel = voxels;
+                keys_[voxels] = key;
+                sx[voxels] = 0;
+                sy[voxels] = 0;
+                sz[voxels] = 0;
+                counts_[voxels] = 0;
+                out.pixel[voxels] = in.pixel[i];
+                ++voxels;
+            }
+            last_voxel = c->voxel;
+        }
+        sx[last_voxel] += x[i];
+        sy[last_voxel] += y[i];
+        sz[last_voxel] += z[i];
+        ++counts_[last_voxel];
+    }
+
+    for (uint32_t j = 0; j < voxels; ++j) {
+        const float scale = 1.0f / float(counts_[j]);
+        sx[j] *= scale;
+        sy[j] *= scale;
+        sz[j] *= scale;
+    }
+    out.count = voxels;
+}
+
+voxel_grid::cell* voxel_grid::find(uint64_t key) {
+    const size_t mask = table_.size() - 1;
+    size_t h = size_t((key * 0x9E3779B97F4A7C15ull) >> (64 - bits_));
+    while (table_[h].stamp == stamp_ && table_[h].key != key) {
+        h = (h + 1) & mask;
+    }
+    return &table_[h];
+}
+
+void voxel_grid::grow(uint32_t voxels) {
+    table_.assign(table_.size() * 2, cell());
+    ++bits_;
+    stamp_ = 1;
+    for (uint32_t j = 0; j < voxels; ++j) {
+        cell* c = find(keys_[j]);
+        c->key = keys_[j];
+        c->stamp = stamp_;
+        c->voxel = j;
+    }
+}
+
+bool write_ply(const std::string& path, const point_cloud& cloud, const cv::Mat& color) {
+    RSD_TRACE_SCOPE("ply");
+    CV_Assert(color.empty() || color.type() == CV_8UC3);
+    const bool has_color = !color.empty();
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    char header[256];
+    const int header_size = std::snprintf(header, sizeof(header),
+        "ply\nformat binary_little_endian 1.0\nelement vertex %llu\n"
+        "property float x\nproperty float y\nproperty float z\n%s"
+        "end_header\n",
+        (unsigned long long)cloud.size(),
+        has_color ? "property uchar red\nproperty uchar green\nproperty uchar blue\n" : "");
+    bool ok = std::fwrite(header, 1, size_t(header_size), file) == size_t(header_size);
+
+    // 按块交错成顶点记录后整块写出；x86 和 ARM 主机都是小端，float 直接按内存布局写
+    const size_t vertex_size = has_color ? 15 : 12;
+    const size_t block = 4096;
+    const size_t color_pixels = color.total();
+    std::vector<uint8_t> buffer(block * vertex_size);
+    for (size_t begin = 0; begin < cloud.size() && ok; begin += block) {
+        const size_t end = std::min(cloud.size(), begin + block);
+        uint8_t* dst = buffer.data();
+        for (size_t i = begin; i < end; ++i, dst += vertex_size) {
+            std::memcpy(dst, &cloud.x[i], 4);
+            std::memcpy(dst + 4, &cloud.y[i], 4);
+            std::memcpy(dst + 8, &cloud.z[i], 4);
+            if (has_color) {
+                const uint32_t pixel = cloud.pixel[i];
+                if (pixel < color_pixels) {
+                    const uint8_t* bgr = color.ptr<uint8_t>(int(pixel / color.cols)) + 3 * (pixel % color.cols);
+                    dst[12] = bgr[2];
+                    dst[13] = bgr[1];
+                    dst[14] = bgr[0];
+                } else {
+                    dst[12] = dst[13] = dst[14] = 0;
+                }
+            }
+        }
+        const size_t bytes = size_t(dst - buffer.data());
+        ok = std::fwrite(buffer.data(), 1, bytes, file) == bytes;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+} // namespace rsd
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rsd {
+
+// 点云，按分量分开存放（SoA），单位为米，坐标系与 rs2::pointcloud 相同（x 向右、y 向下、z 向前）。
+// 缓冲按最大点数分配并跨帧复用，只有前 size() 个点有效
+struct point_cloud {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<uint32_t> pixel;   // 点对应的深度像素序号 v * width + u，可用于取彩色
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // 保证能容纳 points 个点，不改变 count，不留额外余量。生成点云时按像素总数预留即可：
+    // SIMD 实现整组写出的位置不会超过已处理的像素数，末尾不足一组的像素逐个写入
+    void reserve(size_t points);
+};
+
+// 点云生成的深度范围（深度单位），范围外（包括 0）的像素不输出
+struct point_cloud_options {
+    uint16_t min_depth = 1;
+    uint16_t max_depth = 65535;
+
+    point_cloud_options() {}
+    point_cloud_options(uint16_t min_depth, uint16_t max_depth) : min_depth(min_depth), max_depth(max_depth) {}
+};
+
+// 深度图 -> 点云：每个像素在 z = 1 平面上的射线 (x/z, y/z) 在内参变化时才重建（含畸变校正），
+// 每帧只需 z = d * depth_scale、x = z * ray_x、y = z * ray_y，并把有效点紧凑地写出。
+// 运行时自动选择 AVX2 / SSE4.1 / NEON / 标量实现，各实现结果逐位相同；
+// 单线程即可跟上 640x480@90，比 rs2::pointcloud 少了逐像素的投影计算和纹理坐标
+class point_cloud_generator {
+public:
+    explicit point_cloud_generator(const point_cloud_options& options = point_cloud_options());
+
+    // 设置深度内参与深度单位，只有变化时才重建射线表
+    void configure(const rs2_intrinsics& intrinsics, float depth_scale);
+    // 从深度帧的流配置读取
+    void configure(const rs2::depth_frame& frame);
+
+    bool configured() const { return configured_; }
+    const rs2_intrinsics& intrinsics() const { return intrinsics_; }
+    const point_cloud_options& options() const { return options_; }
+    void set_options(const point_cloud_options& options) { options_ = options; }
+
+    // depth 为 CV_16UC1，尺寸与内参一致；out 的缓冲已足够时不重新分配
+    void process(const cv::Mat& depth, point_cloud& out) const;
+
+private:
+    point_cloud_options options_;
+    bool configured_;
+    rs2_intrinsics intrinsics_;
+    float depth_scale_;
+    std::vector<float> ray_x_;   // 每个像素的射线，行优先
+    std::vector<float> ray_y_;
+};
+
+// 体素网格降采样：落入同一体素（边长 leaf_size 米的立方体）的点合并为它们的质心。
+// 体素用开放寻址哈希表索引，表按体素数增长并跨帧复用，用代号标记而不是每帧清零
+class voxel_grid {
+public:
+    explicit voxel_grid(float leaf_size = 0.01f);
+
+    float leaf_size() const { return leaf_size_; }
+    void set_leaf_size(float leaf_size);
+
+    // 输出顺序为各体素首次出现的顺序，pixel 取该体素中第一个点的像素；in 与 out 不能是同一个对象
+    void downsample(const point_cloud& in, point_cloud& out);
+
+private:
+    struct cell {
+        uint64_t key;
+        uint32_t stamp;    // 等于 stamp_ 时该格在本次调用中已被占用
+        uint32_t voxel;    // 输出点序号
+    };
+
+    cell* find(uint64_t key);
+    void grow(uint32_t voxels);
+
+    float leaf_size_;
+    std::vector<cell> table_;      // 大小为 2^bits_
+    int bits_;
+    std::vector<uint64_t> keys_;   // 各输出体素的键，扩表时重新插入
+    std::vector<uint32_t> counts_;
+    uint32_t stamp_;
+};
+
+// 写出二进制（小端）PLY。color 为空，或为与深度同尺寸的 CV_8UC3（BGR，例如对齐到深度的彩色图），
+// 按各点的 pixel 取颜色；写盘失败时返回 false
+bool write_ply(const std::string& path, const point_cloud& cloud, const cv::Mat& color = cv::Mat());
+
+} // namespace rsd
@@ -0,0 +1,332 @@
+#include "core/recorder.hpp"
+#include "core/depth_units.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 写一个 NumPy .npy（格式版本 1.0）：魔数、版本、头长度、Python 字典形式的头，头部补空格对齐到 64 字节。
+// descr 按小端书写，x86 和 ARM 主机的内存布局都是小端，数据可以直接写出
+bool write_npy(const std::string& path, const char* descr, const cv::Mat& data) {
+    char header[192];
+    int length = data.channels() == 1
+        ? std::snprintf(header, sizeof(header), "{'descr': '%s', 'fortran_order': False, 'shape': (%d, %d), }",
+                        descr, data.rows, data.cols)
+        : std::snprintf(header, sizeof(header), "{'descr': '%s', 'fortran_order': False, 'shape': (%d, %d, %d), }",
+                        descr, data.rows, data.cols, data.channels());
+    const int preamble_size = 10;
+    while ((preamble_size + length + 1) % 64 != 0) {
+        header[length++] = ' ';
+    }
+    header[length++] = '\n';
+
+    const unsigned char preamble[preamble_size] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                                   (unsigned char)(length & 0xff), (unsigned char)(length >> 8)};
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const size_t bytes = data.total() * data.elemSize();
+    bool ok = std::fwrite(preamble, 1, preamble_size, file) == size_t(preamble_size) &&
+              std::fwrite(header, 1, size_t(length), file) == size_t(length) &&
+              std::fwrite(data.data, 1, bytes, file) == bytes;
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+std::FILE* open_stream(const std::string& path, std::vector<char>& buffer) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file) {
+        // 大块顺序写，减少系统调用次数
+        buffer.resize(4 << 20);
+        std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    }
+    return file;
+}
+
+void write_intrinsics(std::FILE* file, const char* name, const rs2_intrinsics& in) {
+    std::fprintf(file,
+                 "  \"%s\": {\"width\": %d, \"height\": %d, \"fx\": %.6f, \"fy\": %.6f, \"ppx\": %.6f, \"ppy\": %.6f, "
+                 "\"model\": %d, \"coeffs\": [%.8f, %.8f, %.8f, %.8f, %.8f]}",
+                 name, in.width, in.height, in.fx, in.fy, in.ppx, in.ppy, int(in.model),
+                 in.coeffs[0], in.coeffs[1], in.coeffs[2], in.coeffs[3], in.coeffs[4]);
+}
+
+} // namespace
+
+record_format parse_record_format(const std::string& name) {
+    if (name == "npy") return record_format::npy_u16;
+    if (name == "npy-f32") return record_format::npy_f32;
+    if (name == "raw") return record_format::raw_z16;
+    if (name == "rvl") return record_format::rvl;
+    if (name == "seq") return record_format::sequence;
+    if (name == "seq-rvl") return record_format::sequence_rvl;
+    throw std::invalid_argument("unknown record format: " + name + " (expected npy, npy-f32, raw, rvl, seq or seq-rvl)");
+}
+
+const char* record_format_name(record_format format) {
+    switch (format) {
+    case record_format::npy_u16: return "npy";
+    case record_format::npy_f32: return "npy-f32";
+    case record_format::raw_z16: return "raw";
+    case record_format::rvl: return "rvl";
+    case record_format::sequence: return "seq";
+    case record_format::sequence_rvl: return "seq-rvl";
+    }
+    return "unknown";
+}
+
+namespace {
+
+size_t slot_count(const recorder_options& options) {
+    if (options.queue_frames > 0) {
+        return options.queue_frames;
+    }
+    const double frames = std::ceil(double(options.fps) * options.max_write_latency_ms / 1000.0);
+    return std::max<size_t>(8, size_t(std::max(0.0, frames)));
+}
+
+} // namespace
+
+recorder::recorder(const recorder_options& options)
+    : options_(options),
+      slots_(slot_count(options)),
+      free_(slots_.size()),
+      filled_(slots_.size()),
+      frames_csv_(nullptr),
+      depth_stream_(nullptr),
+      color_stream_(nullptr),
+      metadata_written_(false),
+      have_extrinsics_(false),
+      depth_to_color_(sequence_info().depth_to_color),
+      queued_(0),
+      written_(0),
+      dropped_(0),
+      errors_(0),
+      stopping_(false) {
+    const bool streamed = options_.format == record_format::raw_z16 || options_.format == record_format::rvl;
+    frames_csv_ = std::fopen((options_.directory + "/frames.csv").c_str(), "w");
+    if (streamed) {
+        depth_stream_ = open_stream(options_.directory + (options_.format == record_format::rvl ? "/depth.rvl" : "/depth.z16"),
+                                    depth_stream_buffer_);
+        if (options_.color) {
+            color_stream_ = open_stream(options_.directory + "/color.bgr", color_stream_buffer_);
+        }
+    }
+    if (!frames_csv_ || (streamed && (!depth_stream_ || (options_.color && !color_stream_)))) {
+        if (frames_csv_) std::fclose(frames_csv_);
+        if (depth_stream_) std::fclose(depth_stream_);
+        if (color_stream_) std::fclose(color_stream_);
+        throw std::runtime_error("recorder: cannot write to " + options_.directory);
+    }
+    std::fprintf(frames_csv_, "index,depth_timestamp_ms,depth_frame_number,color_timestamp_ms,color_frame_number\n");
+
+    // 所有槽位一开始都可用；写线程启动前在这里填充，之后只由写线程归还
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        size_t index = i;
+        free_.try_push(std::move(index));
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+recorder::~recorder() {
+    stop();
+}
+
+bool recorder::push(const rs2::depth_frame& depth, const rs2::frame& color) {
+    RSD_TRACE_SCOPE("record");
+    size_t index;
+    if (!free_.try_pop(index)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    slot& s = slots_[index];
+    depth_view(depth).copyTo(s.depth);
+    s.depth_intrinsics = depth.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    s.depth_timestamp = depth.get_timestamp();
+    s.depth_frame_number = depth.get_frame_number();
+
+    const rs2::video_frame color_video = color.as<rs2::video_frame>();
+    s.has_color = options_.color && bool(color_video);
+    if (s.has_color) {
+        frame_view(color_video, CV_8UC3).copyTo(s.color);
+        s.color_intrinsics = color_video.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+        s.color_timestamp = color_video.get_timestamp();
+        s.color_frame_number = color_video.get_frame_number();
+        if (!have_extrinsics_) {
+            try {
+                depth_to_color_ = depth.get_profile().get_extrinsics_to(color_video.get_profile());
+            } catch (const rs2::error&) {
+                // 没有注册外参的来源按共光心处理
+            }
+            have_extrinsics_ = true;
+        }
+        s.depth_to_color = depth_to_color_;
+    }
+
+    filled_.try_push(std::move(index));
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    wake_writer();
+    return true;
+}
+
+void recorder::wake_writer() {
+    // 写线程在持锁时检查队列，这里先取一次锁，保证通知不会落在检查与等待之间
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_one();
+}
+
+void recorder::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    stopping_.store(true, std::memory_order_release);
+    wake_writer();
+    thread_.join();
+
+    if (sequence_ && !sequence_->close()) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (frames_csv_) std::fclose(frames_csv_);
+    if (depth_stream_) std::fclose(depth_stream_);
+    if (color_stream_) std::fclose(color_stream_);
+    frames_csv_ = depth_stream_ = color_stream_ = nullptr;
+}
+
+recorder::stats recorder::get_stats() const {
+    stats s;
+    s.queued = queued_.load(std::memory_order_relaxed);
+    s.written = written_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.errors = errors_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void recorder::run() {
+    trace::set_thread_name("recorder");
+    uint64_t sequence = 0;
+    while (true) {
+        size_t index;
+        if (filled_.try_pop(index)) {
+            write(slots_[index], sequence++);
+            free_.try_push(std::move(index));
+        } else if (stopping_.load(std::memory_order_acquire)) {
+            // stop 之前 push 的帧此时都已可见，队列空即可退出
+            if (filled_.size_approx() == 0) {
+                break;
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this] {
+                return filled_.size_approx() > 0 || stopping_.load(std::memory_order_acquire);
+            });
+        }
+    }
+}
+
+void recorder::write(slot& s, uint64_t index) {
+    RSD_TRACE_SCOPE("record_write");
+    if (!metadata_written_) {
+        write_metadata(s);
+        metadata_written_ = true;
+    }
+
+    char name[64];
+    bool ok = true;
+    switch (options_.format) {
+    case record_format::npy_u16:
+        std::snprintf(name, sizeof(name), "/depth_%06llu.npy", (unsigned long long)index);
+        ok = write_npy(options_.directory + name, "<u2", s.depth);
+        break;
+    case record_format::npy_f32:
+        export_meters(s.depth, options_.depth_scale, meters_);
+        std::snprintf(name, sizeof(name), "/depth_%06llu.npy", (unsigned long long)index);
+        ok = write_npy(options_.directory + name, "<f4", meters_);
+        break;
+    case record_format::raw_z16: {
+        const size_t bytes = s.depth.total() * s.depth.elemSize();
+        ok = std::fwrite(s.depth.data, 1, bytes, depth_stream_) == bytes;
+        break;
+    }
+    case record_format::rvl:
+        // 每帧自带帧头和长度，依次拼接即可顺序读回
+        codec_.encode(s.depth, encoded_);
+        ok = std::fwrite(encoded_.data(), 1, encoded_.size(), depth_stream_) == encoded_.size();
+        break;
+    case record_format::sequence:
+    case record_format::sequence_rvl:
+        // 彩色帧一起写入同一条记录
+        try {
+            if (!sequence_) {
+                sequence_info info;
+                info.codec = options_.format == record_format::sequence_rvl ? sequence_codec::rvl : sequence_codec::z16;
+                info.depth_scale = options_.depth_scale;
+                info.has_color = s.has_color;
+                info.depth_intrinsics = s.depth_intrinsics;
+                if (s.has_color) {
+                    info.color_intrinsics = s.color_intrinsics;
+                    info.depth_to_color = s.depth_to_color;
+                }
+                sequence_.reset(new sequence_writer(options_.directory + "/capture.rsq", info));
+            }
+            ok = sequence_->write(s.depth, s.has_color ? s.color : cv::Mat(), s.depth_timestamp, s.color_timestamp,
+                                  s.depth_frame_number);
+        } catch (const std::exception&) {
+            // 无法创建文件或中途分辨率变化
+            ok = false;
+        }
+        break;
+    }
+
+    if (s.has_color) {
+        if (depth_stream_) {
+            const size_t bytes = s.color.total() * s.color.elemSize();
+            ok = std::fwrite(s.color.data, 1, bytes, color_stream_) == bytes && ok;
+        } else if (options_.format == record_format::npy_u16 || options_.format == record_format::npy_f32) {
+            std::snprintf(name, sizeof(name), "/color_%06llu.npy", (unsigned long long)index);
+            ok = write_npy(options_.directory + name, "|u1", s.color) && ok;
+        }
+        std::fprintf(frames_csv_, "%llu,%.3f,%llu,%.3f,%llu\n", (unsigned long long)index, s.depth_timestamp,
+                     s.depth_frame_number, s.color_timestamp, s.color_frame_number);
+    } else {
+        std::fprintf(frames_csv_, "%llu,%.3f,%llu,,\n", (unsigned long long)index, s.depth_timestamp,
+                     s.depth_frame_number);
+    }
+
+    (ok ? written_ : errors_).fetch_add(1, std::memory_order_relaxed);
+}
+
+void recorder::write_metadata(const slot& s) {
+    std::FILE* file = std::fopen((options_.directory + "/recording.json").c_str(), "w");
+    if (!file) {
+        return;
+    }
+    std::fprintf(file, "{\n  \"format\": \"%s\",\n  \"depth_scale\": %.9g,\n", record_format_name(options_.format),
+                 options_.depth_scale);
+    if (options_.format == record_format::raw_z16) {
+        std::fprintf(file, "  \"depth_file\": \"depth.z16\",\n  \"color_file\": \"color.bgr\",\n");
+    } else if (options_.format == record_format::rvl) {
+        std::fprintf(file, "  \"depth_file\": \"depth.rvl\",\n  \"color_file\": \"color.bgr\",\n");
+    } else if (options_.format == record_format::sequence || options_.format == record_format::sequence_rvl) {
+        std::fprintf(file, "  \"depth_file\": \"capture.rsq\",\n  \"color_file\": \"capture.rsq\",\n");
+    } else {
+        std::fprintf(file, "  \"depth_file\": \"depth_%%06d.npy\",\n  \"color_file\": \"color_%%06d.npy\",\n");
+    }
+    write_intrinsics(file, "depth", s.depth_intrinsics);
+    if (s.has_color) {
+        std::fprintf(file, ",\n");
+        write_intrinsics(file, "color", s.color_intrinsics);
+    }
+    std::fprintf(file, "\n}\n");
+    std::fclose(file);
+}
+
+} // namespace rsd
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/depth_codec.hpp"
+#include "core/depth_sequence.hpp"
+#include "core/spsc_queue.hpp"
+
+namespace rsd {
+
+// 录制格式
+enum class record_format {
+    npy_u16,   // 每帧一个 NumPy .npy，uint16 原始深度（乘 depth_scale 得到米）
+    npy_f32,   // 每帧一个 NumPy .npy，float32 米（换算在写线程中完成）
+    raw_z16,   // 所有帧连续写入 depth.z16（彩色写入 color.bgr），逐帧信息见 frames.csv
+    rvl,       // 与 raw_z16 相同，但深度帧经 RVL 无损压缩后写入 depth.rvl（见 depth_codec.hpp）
+    sequence,  // 深度与彩色帧、时间戳索引和内参写入单个 capture.rsq（见 depth_sequence.hpp），可按序号/时间戳随机读取
+    sequence_rvl   // 与 sequence 相同，但深度帧经 RVL 压缩
+};
+
+// "npy" / "npy-f32" / "raw" / "rvl" / "seq" / "seq-rvl"
+record_format parse_record_format(const std::string& name);
+const char* record_format_name(record_format format);
+
+struct recorder_options {
+    std::string directory = ".";   // 输出目录，需已存在
+    record_format format = record_format::npy_u16;
+    float depth_scale = 0.001f;    // npy_f32 的换算系数，同时写入 recording.json
+    bool color = true;             // 同时保存彩色帧（npy 为 uint8 HxWx3，raw 为连续的 BGR 数据）
+    float fps = 90;                // 录制的帧率，用于计算槽位数
+    int max_write_latency_ms = 700;   // 需要吸收的最长写盘停顿（磁盘短时抖动、文件系统刷写）
+    size_t queue_frames = 0;       // 槽位数；为 0 时取 fps x max_write_latency_ms 对应的帧数（至少 8）
+};
+
+// 异步录制器：push 只把帧数据拷贝进预分配的槽位（不持有 librealsense 的帧，不占用其帧池），
+// 由后台线程顺序写盘，写线程空闲时等待条件变量，push 后立即被唤醒。
+// 槽位数按帧率 x 最长写盘停顿计算，槽位内存在首次使用时分配，之后循环复用。
+// 丢帧策略：写盘停顿超过 max_write_latency_ms、槽位全部在用时丢弃新帧并计入 stats::dropped，
+// 处理循环永远不会因为磁盘而阻塞。
+// 每个输出目录另有两个侧车文件：recording.json（尺寸、内参、深度单位、格式）
+// 和 frames.csv（逐帧时间戳与帧号）。录制期间分辨率应保持不变
+class recorder {
+public:
+    struct stats {
+        uint64_t queued = 0;     // 成功放入队列的帧数
+        uint64_t written = 0;    // 已写盘的帧数
+        uint64_t dropped = 0;    // 槽位用尽而丢弃的帧数
+        uint64_t errors = 0;     // 写盘失败的帧数
+    };
+
+    explicit recorder(const recorder_options& options);
+    ~recorder();
+
+    recorder(const recorder&) = delete;
+    recorder& operator=(const recorder&) = delete;
+
+    // 处理线程调用（始终是同一个线程），color 可以为空帧；返回 false 表示该帧被丢弃
+    bool push(const rs2::depth_frame& depth, const rs2::frame& color = rs2::frame());
+
+    // 等待队列中的帧全部写完后停止写线程，析构时自动调用
+    void stop();
+
+    stats get_stats() const;
+    const recorder_options& options() const { return options_; }
+
+private:
+    struct slot {
+        cv::Mat depth;            // CV_16UC1，行连续
+        cv::Mat color;            // CV_8UC3，行连续
+        bool has_color;
+        rs2_intrinsics depth_intrinsics;
+        rs2_intrinsics color_intrinsics;
+        rs2_extrinsics depth_to_color;
+        double depth_timestamp;
+        double color_timestamp;
+        unsigned long long depth_frame_number;
+        unsigned long long color_frame_number;
+    };
+
+    void run();
+    void write(slot& s, uint64_t index);
+    void write_metadata(const slot& s);
+    void wake_writer();
+
+    recorder_options options_;
+    std::vector<slot> slots_;
+    spsc_queue<size_t> free_;      // 写线程 -> 处理线程：可重用的槽位
+    spsc_queue<size_t> filled_;    // 处理线程 -> 写线程：待写的槽位
+
+    std::FILE* frames_csv_;
+    std::FILE* depth_stream_;      // raw_z16 / rvl
+    std::FILE* color_stream_;      // raw_z16 / rvl
+    std::vector<char> depth_stream_buffer_;
+    std::vector<char> color_stream_buffer_;
+    cv::Mat meters_;               // npy_f32 的换算缓冲，只在写线程中使用
+    depth_codec codec_;            // rvl 的压缩状态与缓冲，只在写线程中使用
+    std::vector<uint8_t> encoded_;
+    std::unique_ptr<sequence_writer> sequence_;   // sequence / sequence_rvl，首帧时按其内参创建
+    bool metadata_written_;
+    bool have_extrinsics_;         // 深度到彩色的外参只在处理线程中查询一次
+    rs2_extrinsics depth_to_color_;
+
+    std::atomic<uint64_t> queued_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> errors_;
+    std::atomic<bool> stopping_;
+    std::mutex wake_mutex_;        // 与 wake_ 配合，避免写线程错过唤醒
+    std::condition_variable wake_;
+    std::thread thread_;
+};
+
+} // namespace rsd
@@ -0,0 +1,32 @@
+#include "core/rs2_adapter.hpp"
+
+namespace rsd {
+
+cv::Mat frame_view(const rs2::video_frame& frame, int type) {
+    return cv::Mat(cv::Size(frame.get_width(), frame.get_height()), type,
+                   const_cast<void*>(frame.get_data()), size_t(frame.get_stride_in_bytes()));
+}
+
+cv::Mat depth_view(const rs2::video_frame& frame) {
+    return frame_view(frame, CV_16UC1);
+}
+
+std::shared_ptr<rs2::filter> make_rs2_filter(depth_kernel kernel) {
+    return std::make_shared<rs2::filter>([kernel](rs2::frame frame, rs2::frame_source& source) {
+        rs2::depth_frame depth = frame.as<rs2::depth_frame>();
+        if (!depth) {
+            source.frame_ready(frame);
+            return;
+        }
+
+        rs2::frame result = source.allocate_video_frame(depth.get_profile(), depth, 0,
+                                                        depth.get_width(), depth.get_height(),
+                                                        depth.get_stride_in_bytes(), RS2_EXTENSION_DEPTH_FRAME);
+        // 新分配的帧尚未交出，这里是它唯一的写入者
+        cv::Mat out = depth_view(result.as<rs2::video_frame>());
+        kernel(depth_view(depth), out);
+        source.frame_ready(result);
+    });
+}
+
+} // namespace rsd
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <memory>
+
+namespace rsd {
+
+// 原生深度处理内核：in / out 均为 CV_16UC1，out 已按输入尺寸分配好
+typedef std::function<void(const cv::Mat& in, cv::Mat& out)> depth_kernel;
+
+// 视频帧的 Mat 视图，不拷贝数据；type 需与帧格式的像素大小一致
+cv::Mat frame_view(const rs2::video_frame& frame, int type);
+
+// 深度帧的 Mat 视图（CV_16UC1）
+cv::Mat depth_view(const rs2::video_frame& frame);
+
+// 把原生内核包装成 rs2::filter：输出帧由 librealsense 的帧池分配，输入帧不被修改，
+// 因此可以和 rs2 自带的滤波器任意混合组成滤波链。非深度帧原样透传
+std::shared_ptr<rs2::filter> make_rs2_filter(depth_kernel kernel);
+
+} // namespace rsd
@@ -0,0 +1,401 @@
+#include "core/shm_ring.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 跨进程的原子变量必须是无锁的，否则锁位于各进程自己的地址空间
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shm_ring requires lock-free 32/64-bit atomics");
+
+namespace rsd {
+
+namespace {
+
+const char shm_magic[8] = {'R', 'S', 'D', 'S', 'H', 'M', '1', '\0'};
+const uint32_t shm_version = 1;
+const size_t shm_alignment = 64;   // 槽头与像素数据按缓存行对齐
+
+const uint32_t state_open = 1;
+const uint32_t state_closed = 2;
+
+size_t align_up(size_t value) {
+    return (value + shm_alignment - 1) & ~(shm_alignment - 1);
+}
+
+// 先自旋让出，再短暂休眠，避免空等占满一个核
+inline void backoff(int& spins) {
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+} // namespace
+
+bool parse_publish_args(int argc, char** argv, shm_ring_options& options) {
+    bool enabled = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--publish") {
+            if (i + 1 >= argc) throw std::invalid_argument("--publish requires a name such as /rsd_depth");
+            options.name = argv[++i];
+            enabled = true;
+        } else if (arg == "--publish-slots") {
+            if (i + 1 >= argc) throw std::invalid_argument("--publish-slots requires a count");
+            options.slots = uint32_t(std::atoi(argv[++i]));
+        }
+    }
+    return enabled;
+}
+
+// 共享内存段头部，位于偏移 0，之后依次是 slot_count 个槽
+struct shm_ring_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t slot_size;           // 每个槽的字节数（含槽头）
+    uint64_t depth_offset;        // 槽内深度像素的偏移
+    uint64_t depth_capacity;      // 深度像素的最大字节数
+    uint64_t color_offset;        // 槽内彩色像素的偏移，0 表示不发布彩色
+    uint64_t color_capacity;
+    int32_t publisher_pid;
+    uint32_t reserved;
+    std::atomic<uint64_t> published;   // 已发布的帧数（下一个发布序号）
+    std::atomic<uint32_t> state;       // state_open / state_closed，0 表示尚未初始化完成
+};
+
+// 槽头：version 为 seqlock 版本号，奇数表示发布方正在写入该槽
+struct shm_slot_header {
+    std::atomic<uint64_t> version;
+    uint64_t sequence;
+    uint64_t frame_number;
+    double depth_timestamp;
+    double color_timestamp;
+    float depth_scale;
+    int32_t depth_width;
+    int32_t depth_height;
+    int32_t color_width;          // 0 表示该帧没有彩色
+    int32_t color_height;
+    rs2_intrinsics depth_intrinsics;
+    rs2_intrinsics color_intrinsics;
+};
+
+// ---------------------------------------------------------------------------
+// shm_publisher
+
+shm_publisher::shm_publisher(const shm_ring_options& options)
+    : options_(options), base_(nullptr), mapped_size_(0), header_(nullptr), next_sequence_(0),
+      writing_(false), slot_version_(0) {
+    if (options.name.size() < 2 || options.name[0] != '/' || options.name.find('/', 1) != std::string::npos) {
+        throw std::invalid_argument("shm_publisher: name must look like /name");
+    }
+    if (options.slots < 2 || options.max_width <= 0 || options.max_height <= 0 ||
+        (options.color && (options.max_color_width <= 0 || options.max_color_height <= 0))) {
+        throw std::invalid_argument("shm_publisher: need at least 2 slots and positive frame sizes");
+    }
+
+    const size_t header_size = align_up(sizeof(shm_ring_header));
+    const size_t slot_header_size = align_up(sizeof(shm_slot_header));
+    const size_t depth_capacity = size_t(options.max_width) * options.max_height * 2;
+    const size_t color_capacity = options.color ? size_t(options.max_color_width) * options.max_color_height * 3 : 0;
+    const size_t slot_size = slot_header_size + align_up(depth_capacity) + align_up(color_capacity);
+    mapped_size_ = header_size + slot_size * options.slots;
+
+    // 上一次异常退出留下的同名段直接替换，仍映射着旧段的订阅方会看到它一直没有新帧
+    ::shm_unlink(options.name.c_str());
+    const int fd = ::shm_open(options.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("shm_publisher: cannot create shared memory " + options.name);
+    }
+    if (::ftruncate(fd, off_t(mapped_size_)) != 0) {
+        ::close(fd);
+        ::shm_unlink(options.name.c_str());
+        throw std::runtime_error("shm_publisher: cannot size shared memory " + options.name);
+    }
+    void* mapped = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        ::shm_unlink(options.name.c_str());
+        throw std::runtime_error("shm_publisher: cannot map shared memory " + options.name);
+    }
+    base_ = static_cast<uint8_t*>(mapped);
+
+    // ftruncate 得到的内存全部为 0，即所有槽的版本号为 0（偶数，尚未写入）
+    header_ = new (base_) shm_ring_header;
+    std::memcpy(header_->magic, shm_magic, sizeof(shm_magic));
+    header_->version = shm_version;
+    header_->slot_count = options.slots;
+    header_->slot_size = slot_size;
+    header_->depth_offset = slot_header_size;
+    header_->depth_capacity = depth_capacity;
+    header_->color_offset = options.color ? slot_header_size + align_up(depth_capacity) : 0;
+    header_->color_capacity = color_capacity;
+    header_->publisher_pid = int32_t(::getpid());
+    header_->reserved = 0;
+    header_->published.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < options.slots; ++i) {
+        shm_slot_header* s = new (base_ + header_size + slot_size * i) shm_slot_header;
+        s->version.store(0, std::memory_order_relaxed);
+    }
+    // 最后才标记可用，订阅方看到 state_open 时头部已经完整
+    header_->state.store(state_open, std::memory_order_release);
+}
+
+shm_publisher::~shm_publisher() {
+    header_->state.store(state_closed, std::memory_order_release);
+    ::munmap(base_, mapped_size_);
+    ::shm_unlink(options_.name.c_str());
+}
+
+shm_slot_header* shm_publisher::slot(uint64_t sequence) const {
+    const size_t index = size_t(sequence % header_->slot_count);
+    return reinterpret_cast<shm_slot_header*>(base_ + align_up(sizeof(shm_ring_header)) + header_->slot_size * index);
+}
+
+void shm_publisher::begin(cv::Size depth_size, cv::Mat& depth, cv::Size color_size, cv::Mat& color) {
+    if (writing_) {
+        throw std::logic_error("shm_publisher: begin() called twice without commit()");
+    }
+    if (depth_size.width <= 0 || depth_size.height <= 0 ||
+        size_t(depth_size.area()) * 2 > header_->depth_capacity) {
+        throw std::invalid_argument("shm_publisher: depth frame does not fit in a slot");
+    }
+    const bool has_color = color_size.width > 0 && color_size.height > 0;
+    if (has_color && (!options_.color || size_t(color_size.area()) * 3 > header_->color_capacity)) {
+        throw std::invalid_argument(options_.color ? "shm_publisher: colour frame does not fit in a slot"
+                                                   : "shm_publisher: colour was not enabled");
+    }
+
+    // seqlock 写端：版本号先变为奇数，release 栅栏保证之后的写入不会排到它之前
+    shm_slot_header* s = slot(next_sequence_);
+    slot_version_ = s->version.load(std::memory_order_relaxed);
+    s->version.store(slot_version_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(s);
+    depth = cv::Mat(depth_size, CV_16UC1, data + header_->depth_offset);
+    color = has_color ? cv::Mat(color_size, CV_8UC3, data + header_->color_offset) : cv::Mat();
+    depth_size_ = depth_size;
+    color_size_ = has_color ? color_size : cv::Size();
+    writing_ = true;
+}
+
+uint64_t shm_publisher::commit(const rs2_intrinsics& depth_intrinsics, float depth_scale, double depth_timestamp,
+                               uint64_t frame_number, const rs2_intrinsics* color_intrinsics,
+                               double color_timestamp) {
+    if (!writing_) {
+        throw std::logic_error("shm_publisher: commit() without begin()");
+    }
+    shm_slot_header* s = slot(next_sequence_);
+    s->sequence = next_sequence_;
+    s->frame_number = frame_number;
+    s->depth_timestamp = depth_timestamp;
+    s->color_timestamp = color_timestamp;
+    s->depth_scale = depth_scale;
+    s->depth_width = depth_size_.width;
+    s->depth_height = depth_size_.height;
+    s->color_width = color_size_.width;
+    s->color_height = color_size_.height;
+    s->depth_intrinsics = depth_intrinsics;
+    if (color_intrinsics) {
+        s->color_intrinsics = *color_intrinsics;
+    } else {
+        std::memset(&s->color_intrinsics, 0, sizeof(s->color_intrinsics));
+    }
+
+    // 版本号变为下一个偶数，槽中数据对读取方可见；随后推进发布计数
+    s->version.store(slot_version_ + 2, std::memory_order_release);
+    header_->published.store(next_sequence_ + 1, std::memory_order_release);
+    writing_ = false;
+    return next_sequence_++;
+}
+
+uint64_t shm_publisher::publish(const cv::Mat& depth, const rs2_intrinsics& depth_intrinsics, float depth_scale,
+                                double depth_timestamp, uint64_t frame_number, const cv::Mat& color,
+                                const rs2_intrinsics* color_intrinsics, double color_timestamp) {
+    RSD_TRACE_SCOPE("shm_publish");
+    CV_Assert(depth.type() == CV_16UC1 && (color.empty() || color.type() == CV_8UC3));
+    cv::Mat depth_slot, color_slot;
+    begin(depth.size(), depth_slot, color.empty() ? cv::Size() : color.size(), color_slot);
+    depth.copyTo(depth_slot);
+    if (!color.empty()) {
+        color.copyTo(color_slot);
+    }
+    return commit(depth_intrinsics, depth_scale, depth_timestamp, frame_number, color_intrinsics, color_timestamp);
+}
+
+uint64_t shm_publisher::publish(const rs2::depth_frame& depth, const rs2::video_frame& color) {
+    const rs2_intrinsics depth_intrinsics = depth.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    if (!color) {
+        return publish(depth_view(depth), depth_intrinsics, depth.get_units(), depth.get_timestamp(),
+                       depth.get_frame_number());
+    }
+    const rs2_intrinsics color_intrinsics = color.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    return publish(depth_view(depth), depth_intrinsics, depth.get_units(), depth.get_timestamp(),
+                   depth.get_frame_number(), frame_view(color, CV_8UC3), &color_intrinsics, color.get_timestamp());
+}
+
+uint64_t shm_publisher::publish(const rs2::depth_frame& depth) {
+    const rs2_intrinsics depth_intrinsics = depth.get_profile().as<rs2::video_stream_profile>().get_intrinsics();
+    return publish(depth_view(depth), depth_intrinsics, depth.get_units(), depth.get_timestamp(),
+                   depth.get_frame_number());
+}
+
+// ---------------------------------------------------------------------------
+// shm_subscriber
+
+shm_subscriber::shm_subscriber(const std::string& name)
+    : name_(name), base_(nullptr), mapped_size_(0), header_(nullptr), next_sequence_(0), skipped_(0) {
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("shm_subscriber: no shared memory named " + name);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || uint64_t(st.st_size) < align_up(sizeof(shm_ring_header))) {
+        ::close(fd);
+        throw std::runtime_error("shm_subscriber: " + name + " is not a depth ring (or is not ready yet)");
+    }
+    // 只读映射：订阅方不写共享内存，任意多个订阅方互不影响
+    void* mapped = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("shm_subscriber: cannot map " + name);
+    }
+    base_ = static_cast<const uint8_t*>(mapped);
+    mapped_size_ = size_t(st.st_size);
+    header_ = reinterpret_cast<const shm_ring_header*>(base_);
+
+    const uint32_t state = header_->state.load(std::memory_order_acquire);
+    const uint64_t slots_end = align_up(sizeof(shm_ring_header)) + header_->slot_size * uint64_t(header_->slot_count);
+    if (std::memcmp(header_->magic, shm_magic, sizeof(shm_magic)) != 0 || header_->version != shm_version ||
+        state == 0 || header_->slot_count < 2 || slots_end > mapped_size_ ||
+        header_->depth_offset + header_->depth_capacity > header_->slot_size ||
+        (header_->color_offset && header_->color_offset + header_->color_capacity > header_->slot_size)) {
+        ::munmap(const_cast<uint8_t*>(base_), mapped_size_);
+        throw std::runtime_error("shm_subscriber: " + name + " is not a depth ring (or is not ready yet)");
+    }
+
+    // 从当前最新的一帧开始，不回放订阅之前的帧
+    const uint64_t published = header_->published.load(std::memory_order_acquire);
+    next_sequence_ = published > 0 ? published - 1 : 0;
+}
+
+shm_subscriber::~shm_subscriber() {
+    ::munmap(const_cast<uint8_t*>(base_), mapped_size_);
+}
+
+uint32_t shm_subscriber::slots() const {
+    return header_->slot_count;
+}
+
+bool shm_subscriber::closed() const {
+    return header_->state.load(std::memory_order_acquire) == state_closed;
+}
+
+bool shm_subscriber::read(uint64_t sequence, shm_frame& out) const {
+    const size_t index = size_t(sequence % header_->slot_count);
+    const uint8_t* data = base_ + align_up(sizeof(shm_ring_header)) + header_->slot_size * index;
+    const shm_slot_header* s = reinterpret_cast<const shm_slot_header*>(data);
+
+    // seqlock 读端：版本号为偶数时读取元数据，acquire 栅栏后再次比较版本号
+    const uint64_t version = s->version.load(std::memory_order_acquire);
+    if (version & 1) {
+        return false;
+    }
+    const uint64_t slot_sequence = s->sequence;
+    shm_frame frame;
+    frame.sequence = slot_sequence;
+    frame.frame_number = s->frame_number;
+    frame.depth_timestamp = s->depth_timestamp;
+    frame.color_timestamp = s->color_timestamp;
+    frame.depth_scale = s->depth_scale;
+    frame.depth_intrinsics = s->depth_intrinsics;
+    frame.color_intrinsics = s->color_intrinsics;
+    const int depth_width = s->depth_width, depth_height = s->depth_height;
+    const int color_width = s->color_width, color_height = s->color_height;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->version.load(std::memory_order_relaxed) != version || slot_sequence != sequence) {
+        return false;
+    }
+    if (depth_width <= 0 || depth_height <= 0 ||
+        uint64_t(depth_width) * uint64_t(depth_height) * 2 > header_->depth_capacity ||
+        (color_width > 0 && (!header_->color_offset ||
+                             uint64_t(color_width) * uint64_t(color_height) * 3 > header_->color_capacity))) {
+        return false;
+    }
+
+    // 像素不拷贝，直接引用只读映射
+    frame.depth = cv::Mat(depth_height, depth_width, CV_16UC1, const_cast<uint8_t*>(data + header_->depth_offset));
+    if (color_width > 0 && color_height > 0) {
+        frame.color = cv::Mat(color_height, color_width, CV_8UC3, const_cast<uint8_t*>(data + header_->color_offset));
+    }
+    frame.slot = uint32_t(index);
+    frame.version = version;
+    out = frame;
+    return true;
+}
+
+bool shm_subscriber::next(shm_frame& out, int timeout_ms) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    const uint64_t slots = header_->slot_count;
+    int spins = 0;
+    for (;;) {
+        const uint64_t published = header_->published.load(std::memory_order_acquire);
+        if (published > next_sequence_) {
+            // 发布方可能正在写序号 published 所在的槽，可读的是最近 slots - 1 帧
+            if (published - next_sequence_ > slots - 1) {
+                skipped_ += published - 1 - next_sequence_;
+                next_sequence_ = published - 1;
+            }
+            if (read(next_sequence_, out)) {
+                ++next_sequence_;
+                return true;
+            }
+            // 读取期间该槽被覆盖，重新读取发布计数
+            continue;
+        }
+        if (closed() || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        backoff(spins);
+    }
+}
+
+bool shm_subscriber::latest(shm_frame& out) {
+    for (;;) {
+        const uint64_t published = header_->published.load(std::memory_order_acquire);
+        if (published == 0) {
+            return false;
+        }
+        if (read(published - 1, out)) {
+            if (out.sequence + 1 > next_sequence_) {
+                skipped_ += out.sequence - next_sequence_;
+                next_sequence_ = out.sequence + 1;
+            }
+            return true;
+        }
+    }
+}
+
+bool shm_subscriber::valid(const shm_frame& frame) const {
+    const uint8_t* data = base_ + align_up(sizeof(shm_ring_header)) + header_->slot_size * frame.slot;
+    const shm_slot_header* s = reinterpret_cast<const shm_slot_header*>(data);
+    // 之前对像素的读取不能排到版本号检查之后
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s->version.load(std::memory_order_relaxed) == frame.version;
+}
+
+} // namespace rsd
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rsd {
+
+// 共享内存环形缓冲：发布进程把处理后的深度（可选对齐彩色）写入 POSIX 共享内存中的多槽环，
+// 同一台机器上任意多个订阅进程以只读映射直接读取，不经过序列化也不拷贝。
+// 每个槽用 seqlock 保证一致性：写入前把槽版本号置为奇数，写完置为下一个偶数；
+// 读取方在读取前后比较版本号，发布方从不等待读取方，读取方也不加锁
+
+struct shm_ring_options {
+    std::string name = "/rsd_depth";   // shm_open 名称，以 '/' 开头
+    uint32_t slots = 8;                // 槽数：订阅方处理一帧的时间不超过 (slots - 1) 个帧间隔时数据不会被覆盖
+    int max_width = 1280;              // 深度帧的最大尺寸，决定每个槽的大小
+    int max_height = 720;
+    bool color = false;                // 是否同时发布彩色（BGR8）
+    int max_color_width = 1280;
+    int max_color_height = 720;
+};
+
+// 从命令行读取：--publish <name> 启用发布，--publish-slots <n> 槽数。给出 --publish 时返回 true
+// 参数格式错误时抛出 std::invalid_argument
+bool parse_publish_args(int argc, char** argv, shm_ring_options& options);
+
+struct shm_slot_header;
+struct shm_ring_header;
+
+// 订阅方得到的一帧。depth / color 直接指向共享内存（只读映射，写入会触发段错误），
+// 在对应的槽被发布方复用之前有效，处理完后用 shm_subscriber::valid() 确认期间没有被覆盖
+struct shm_frame {
+    uint64_t sequence = 0;          // 发布序号，从 0 开始连续递增
+    uint64_t frame_number = 0;      // 相机帧号
+    double depth_timestamp = 0;     // 毫秒
+    double color_timestamp = 0;
+    float depth_scale = 0;          // 每个深度单位对应的米数
+    rs2_intrinsics depth_intrinsics;
+    rs2_intrinsics color_intrinsics;
+    cv::Mat depth;                  // CV_16UC1
+    cv::Mat color;                  // CV_8UC3，该帧没有彩色时为空
+
+    uint32_t slot = 0;              // 所在槽与读取时的槽版本号，供 valid() 使用
+    uint64_t version = 0;
+};
+
+// 发布方：创建（或替换同名的）共享内存段，析构时标记关闭并删除名称，已映射的订阅方不受影响。
+// 只允许一个线程发布
+class shm_publisher {
+public:
+    // 创建或映射失败时抛出 std::runtime_error，参数不合法时抛出 std::invalid_argument
+    explicit shm_publisher(const shm_ring_options& options = shm_ring_options());
+    ~shm_publisher();
+
+    shm_publisher(const shm_publisher&) = delete;
+    shm_publisher& operator=(const shm_publisher&) = delete;
+
+    const shm_ring_options& options() const { return options_; }
+
+    // 发布一帧（拷贝进槽中一次），返回发布序号。depth 为 CV_16UC1，color 为空或 CV_8UC3；
+    // 尺寸超过槽容量、或未启用彩色却给出彩色时抛出 std::invalid_argument
+    uint64_t publish(const cv::Mat& depth, const rs2_intrinsics& depth_intrinsics, float depth_scale,
+                     double depth_timestamp, uint64_t frame_number,
+                     const cv::Mat& color = cv::Mat(), const rs2_intrinsics* color_intrinsics = nullptr,
+                     double color_timestamp = 0);
+    // 内参、深度单位和时间戳取自帧本身；color 可为空帧
+    uint64_t publish(const rs2::depth_frame& depth, const rs2::video_frame& color);
+    uint64_t publish(const rs2::depth_frame& depth);
+
+    // 零拷贝写入：begin() 返回下一个槽中指定尺寸的可写 Mat（color_size 为空时不写彩色），
+    // 直接在其中生成结果后调用 commit() 填写元数据并发布。两者之间订阅方会跳过该槽
+    void begin(cv::Size depth_size, cv::Mat& depth, cv::Size color_size, cv::Mat& color);
+    uint64_t commit(const rs2_intrinsics& depth_intrinsics, float depth_scale, double depth_timestamp,
+                    uint64_t frame_number, const rs2_intrinsics* color_intrinsics = nullptr,
+                    double color_timestamp = 0);
+
+    uint64_t published() const { return next_sequence_; }
+
+private:
+    shm_slot_header* slot(uint64_t sequence) const;
+
+    shm_ring_options options_;
+    uint8_t* base_;
+    size_t mapped_size_;
+    shm_ring_header* header_;
+    uint64_t next_sequence_;
+    bool writing_;
+    uint64_t slot_version_;   // begin() 时槽的版本号
+    cv::Size depth_size_;     // begin() 时的尺寸
+    cv::Size color_size_;
+};
+
+// 订阅方：以只读方式映射发布方创建的共享内存段，不修改其中任何数据，因此读取方数量不受限制
+class shm_subscriber {
+public:
+    // 共享内存不存在或格式不符时抛出 std::runtime_error
+    explicit shm_subscriber(const std::string& name = "/rsd_depth");
+    ~shm_subscriber();
+
+    shm_subscriber(const shm_subscriber&) = delete;
+    shm_subscriber& operator=(const shm_subscriber&) = delete;
+
+    // 等待上一次返回的帧之后的下一帧，至多 timeout_ms 毫秒；落后超过环长度时跳到最新一帧，被跳过的帧计入 skipped()
+    bool next(shm_frame& out, int timeout_ms = 1000);
+    // 当前最新的一帧，尚无帧时返回 false
+    bool latest(shm_frame& out);
+
+    // 读取（处理）期间该帧所在的槽没有被覆盖，数据一致
+    bool valid(const shm_frame& frame) const;
+
+    // 发布方已关闭（发布方重新启动后需要重新创建订阅方）
+    bool closed() const;
+
+    uint32_t slots() const;
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    bool read(uint64_t sequence, shm_frame& out) const;
+
+    std::string name_;
+    const uint8_t* base_;
+    size_t mapped_size_;
+    const shm_ring_header* header_;
+    uint64_t next_sequence_;
+    uint64_t skipped_;
+};
+
+} // namespace rsd
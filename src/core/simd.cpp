@@ -0,0 +1,73 @@
+#include "core/simd.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && defined(RSD_X86)
+#include <intrin.h>
+#endif
+
+namespace rsd {
+namespace simd {
+
+namespace {
+
+isa detect_hardware() {
+#if defined(RSD_NEON)
+    return isa::neon;
+#elif defined(RSD_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return isa::avx2;
+    if (__builtin_cpu_supports("sse4.1")) return isa::sse41;
+    return isa::scalar;
+#elif defined(RSD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx2 = false;
+    if (osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? isa::avx2 : (sse41 ? isa::sse41 : isa::scalar);
+#else
+    return isa::scalar;
+#endif
+}
+
+isa apply_override(isa hardware) {
+    const char* forced = std::getenv("RSD_SIMD");
+    if (!forced) {
+        return hardware;
+    }
+    if (hardware == isa::neon) {
+        return std::strcmp(forced, "scalar") == 0 ? isa::scalar : hardware;
+    }
+    isa wanted = hardware;
+    if (std::strcmp(forced, "scalar") == 0) wanted = isa::scalar;
+    else if (std::strcmp(forced, "sse41") == 0) wanted = isa::sse41;
+    else if (std::strcmp(forced, "avx2") == 0) wanted = isa::avx2;
+    // 只允许降级，不能启用硬件不支持的指令集
+    return int(wanted) <= int(hardware) ? wanted : hardware;
+}
+
+} // namespace
+
+isa detect() {
+    static const isa level = apply_override(detect_hardware());
+    return level;
+}
+
+const char* name(isa level) {
+    switch (level) {
+    case isa::sse41: return "SSE4.1";
+    case isa::avx2: return "AVX2";
+    case isa::neon: return "NEON";
+    case isa::scalar:
+    default: return "scalar";
+    }
+}
+
+} // namespace simd
+} // namespace rsd
@@ -0,0 +1,39 @@
+#pragma once
+
+// 指令集检测与运行时分派的公共定义
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RSD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RSD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC/Clang 需要给使用高阶指令的函数单独标注目标，MSVC 不需要
+#if defined(__GNUC__)
+#define RSD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RSD_TARGET(isa)
+#endif
+
+namespace rsd {
+namespace simd {
+
+enum class isa {
+    scalar,
+    sse41,
+    avx2,
+    neon
+};
+
+// 当前 CPU 可用的最佳指令集，结果会被缓存
+// 可通过环境变量 RSD_SIMD=scalar|sse41|avx2 强制降级，便于对比测速
+isa detect();
+
+const char* name(isa level);
+
+} // namespace simd
+} // namespace rsd
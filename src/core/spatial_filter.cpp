@@ -0,0 +1,222 @@
+#include "core/spatial_filter.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/simd.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 每个并行任务处理的列数，列块内逐行推进，gap 缓冲放在栈上
+const int column_block = 256;
+
+struct step_params {
+    float alpha;
+    float delta;
+    float radius;   // 最多向前填补的空洞像素数，0 表示不填充
+};
+
+// 递归滤波推进一行：prev 是上一行的输出（即递归状态），row 原地改写为本行输出。
+// 有效像素：与上一输出差值小于 delta 时 out = prev + alpha * (v - prev)，否则 out = v；
+// 无效像素：上一输出有效且空洞长度未超过 radius 时沿用上一输出，否则保持 0 并中断递归。
+// gap 记录每列连续空洞的长度
+typedef void (*step_fn)(const float* prev, float* row, float* gap, int count, const step_params& p);
+
+void step_scalar(const float* prev, float* row, float* gap, int count, const step_params& p) {
+    for (int i = 0; i < count; ++i) {
+        const float v = row[i];
+        const float s = prev[i];
+        if (v > 0) {
+            row[i] = s > 0 && std::fabs(v - s) < p.delta ? s + p.alpha * (v - s) : v;
+            gap[i] = 0;
+        } else {
+            row[i] = s > 0 && gap[i] < p.radius ? s : 0;
+            gap[i] += 1;
+        }
+    }
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("sse4.1")
+void step_sse41(const float* prev, float* row, float* gap, int count, const step_params& p) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 alpha = _mm_set1_ps(p.alpha);
+    const __m128 delta = _mm_set1_ps(p.delta);
+    const __m128 radius = _mm_set1_ps(p.radius);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(row + i);
+        __m128 s = _mm_loadu_ps(prev + i);
+        __m128 g = _mm_loadu_ps(gap + i);
+        __m128 valid = _mm_cmpgt_ps(v, zero);
+        __m128 state_valid = _mm_cmpgt_ps(s, zero);
+        __m128 diff = _mm_sub_ps(v, s);
+        __m128 close = _mm_and_ps(state_valid, _mm_cmplt_ps(_mm_and_ps(diff, abs_mask), delta));
+        __m128 smoothed = _mm_blendv_ps(v, _mm_add_ps(s, _mm_mul_ps(alpha, diff)), close);
+        __m128 filled = _mm_and_ps(_mm_and_ps(state_valid, _mm_cmplt_ps(g, radius)), s);
+        _mm_storeu_ps(row + i, _mm_blendv_ps(filled, smoothed, valid));
+        _mm_storeu_ps(gap + i, _mm_andnot_ps(valid, _mm_add_ps(g, one)));
+    }
+    step_scalar(prev + i, row + i, gap + i, count - i, p);
+}
+
+RSD_TARGET("avx2")
+void step_avx2(const float* prev, float* row, float* gap, int count, const step_params& p) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 alpha = _mm256_set1_ps(p.alpha);
+    const __m256 delta = _mm256_set1_ps(p.delta);
+    const __m256 radius = _mm256_set1_ps(p.radius);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_loadu_ps(row + i);
+        __m256 s = _mm256_loadu_ps(prev + i);
+        __m256 g = _mm256_loadu_ps(gap + i);
+        __m256 valid = _mm256_cmp_ps(v, zero, _CMP_GT_OQ);
+        __m256 state_valid = _mm256_cmp_ps(s, zero, _CMP_GT_OQ);
+        __m256 diff = _mm256_sub_ps(v, s);
+        __m256 close = _mm256_and_ps(state_valid, _mm256_cmp_ps(_mm256_and_ps(diff, abs_mask), delta, _CMP_LT_OQ));
+        __m256 smoothed = _mm256_blendv_ps(v, _mm256_add_ps(s, _mm256_mul_ps(alpha, diff)), close);
+        __m256 filled = _mm256_and_ps(_mm256_and_ps(state_valid, _mm256_cmp_ps(g, radius, _CMP_LT_OQ)), s);
+        _mm256_storeu_ps(row + i, _mm256_blendv_ps(filled, smoothed, valid));
+        _mm256_storeu_ps(gap + i, _mm256_andnot_ps(valid, _mm256_add_ps(g, one)));
+    }
+    step_sse41(prev + i, row + i, gap + i, count - i, p);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+void step_neon(const float* prev, float* row, float* gap, int count, const step_params& p) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t alpha = vdupq_n_f32(p.alpha);
+    const float32x4_t delta = vdupq_n_f32(p.delta);
+    const float32x4_t radius = vdupq_n_f32(p.radius);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vld1q_f32(row + i);
+        float32x4_t s = vld1q_f32(prev + i);
+        float32x4_t g = vld1q_f32(gap + i);
+        uint32x4_t valid = vcgtq_f32(v, zero);
+        uint32x4_t state_valid = vcgtq_f32(s, zero);
+        uint32x4_t close = vandq_u32(state_valid, vcltq_f32(vabdq_f32(v, s), delta));
+        float32x4_t smoothed = vbslq_f32(close, vmlaq_f32(s, alpha, vsubq_f32(v, s)), v);
+        uint32x4_t fill = vandq_u32(state_valid, vcltq_f32(g, radius));
+        float32x4_t filled = vreinterpretq_f32_u32(vandq_u32(fill, vreinterpretq_u32_f32(s)));
+        vst1q_f32(row + i, vbslq_f32(valid, smoothed, filled));
+        vst1q_f32(gap + i, vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vaddq_f32(g, one)), valid)));
+    }
+    step_scalar(prev + i, row + i, gap + i, count - i, p);
+}
+
+#endif
+
+step_fn select_step() {
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: return step_avx2;
+    case simd::isa::sse41: return step_sse41;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: return step_neon;
+#endif
+    default: return step_scalar;
+    }
+}
+
+// 对 image 的每一列做上->下、下->上两遍递归滤波，列之间互不相关，按列块并行
+void filter_columns(cv::Mat& image, const step_params& p) {
+    const step_fn step = select_step();
+    const int rows = image.rows;
+    const int blocks = (image.cols + column_block - 1) / column_block;
+
+    cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range& range) {
+        cv::AutoBuffer<float, column_block> gap(column_block);
+        for (int b = range.start; b < range.end; ++b) {
+            const int x0 = b * column_block;
+            const int count = std::min(column_block, image.cols - x0);
+
+            std::fill(gap.data(), gap.data() + count, 0.0f);
+            for (int y = 1; y < rows; ++y) {
+                step(image.ptr<float>(y - 1) + x0, image.ptr<float>(y) + x0, gap.data(), count, p);
+            }
+            std::fill(gap.data(), gap.data() + count, 0.0f);
+            for (int y = rows - 2; y >= 0; --y) {
+                step(image.ptr<float>(y + 1) + x0, image.ptr<float>(y) + x0, gap.data(), count, p);
+            }
+        }
+    });
+}
+
+float holes_fill_radius(int holes_fill) {
+    switch (holes_fill) {
+    case 0: return 0;
+    case 1: return 2;
+    case 2: return 4;
+    case 3: return 8;
+    case 4: return 16;
+    case 5: return FLT_MAX;
+    default: throw std::invalid_argument("spatial_filter: holes_fill must be in [0, 5]");
+    }
+}
+
+} // namespace
+
+spatial_filter_options spatial_filter_options::from(const rs2::options& filter) {
+    spatial_filter_options options;
+    options.iterations = int(filter.get_option(RS2_OPTION_FILTER_MAGNITUDE));
+    options.alpha = filter.get_option(RS2_OPTION_FILTER_SMOOTH_ALPHA);
+    options.delta = filter.get_option(RS2_OPTION_FILTER_SMOOTH_DELTA);
+    options.holes_fill = int(filter.get_option(RS2_OPTION_HOLES_FILL));
+    return options;
+}
+
+native_spatial_filter::native_spatial_filter(const spatial_filter_options& options)
+    : options_(options) {}
+
+void native_spatial_filter::process(const cv::Mat& depth, cv::Mat& out) {
+    CV_Assert(depth.type() == CV_16UC1);
+    if (options_.alpha <= 0 || options_.alpha > 1) {
+        throw std::invalid_argument("spatial_filter: alpha must be in (0, 1]");
+    }
+
+    step_params horizontal;
+    horizontal.alpha = options_.alpha;
+    horizontal.delta = options_.delta;
+    horizontal.radius = holes_fill_radius(options_.holes_fill);
+    step_params vertical = horizontal;
+    vertical.radius = 0;
+
+    depth.convertTo(work_, CV_32F);
+    for (int i = 0; i < options_.iterations; ++i) {
+        // 水平方向：转置后按列处理，整行连续访问才能向量化
+        cv::transpose(work_, transposed_);
+        filter_columns(transposed_, horizontal);
+        cv::transpose(transposed_, work_);
+        filter_columns(work_, vertical);
+    }
+    // 四舍五入并饱和到 16 位
+    work_.convertTo(out, CV_16U);
+}
+
+std::shared_ptr<rs2::filter> make_spatial_block(const spatial_filter_options& options) {
+    std::shared_ptr<native_spatial_filter> filter(new native_spatial_filter(options));
+    return make_rs2_filter([filter](const cv::Mat& in, cv::Mat& out) {
+        filter->process(in, out);
+    });
+}
+
+} // namespace rsd
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <memory>
+
+namespace rsd {
+
+// 空间滤波参数，含义与 rs2::spatial_filter 的选项一致
+struct spatial_filter_options {
+    int iterations;     // RS2_OPTION_FILTER_MAGNITUDE，迭代次数
+    float alpha;        // RS2_OPTION_FILTER_SMOOTH_ALPHA，平滑系数
+    float delta;        // RS2_OPTION_FILTER_SMOOTH_DELTA，边缘阈值（深度单位）
+    int holes_fill;     // RS2_OPTION_HOLES_FILL，0 不填充，1-4 填充 2/4/8/16 像素，5 不限
+
+    spatial_filter_options(int iterations = 2, float alpha = 0.5f, float delta = 20, int holes_fill = 0)
+        : iterations(iterations), alpha(alpha), delta(delta), holes_fill(holes_fill) {}
+
+    // 读取已配置好的 rs2::spatial_filter 的参数
+    static spatial_filter_options from(const rs2::options& filter);
+};
+
+// 原生保边空间滤波（域变换式递归滤波），输入输出为 Z16，内部在浮点工作缓冲上计算：
+// 开始时把 Z16 转换为 CV_32F，结束时四舍五入、饱和回 Z16。
+// 每次迭代先做水平方向（左->右、右->左）再做垂直方向（上->下、下->上），
+// 相邻有效像素差小于 delta 时做指数平滑，否则视为边缘重新开始；
+// 水平方向可按 holes_fill 用左/右侧的值填补空洞。
+// 垂直递归按列向量化（AVX2 / SSE4.1 / NEON，否则为标量），各列块并行；
+// 水平方向复用同一内核：每次迭代把工作缓冲整幅转置两次（转置、按列滤波、转置回来）
+class native_spatial_filter {
+public:
+    explicit native_spatial_filter(const spatial_filter_options& options = spatial_filter_options());
+
+    void set_options(const spatial_filter_options& options) { options_ = options; }
+    const spatial_filter_options& options() const { return options_; }
+
+    // depth 为 CV_16UC1，out 为同尺寸 CV_16UC1（已分配则直接写入，可与 depth 相同）
+    void process(const cv::Mat& depth, cv::Mat& out);
+
+private:
+    spatial_filter_options options_;
+    cv::Mat work_;         // 浮点工作缓冲，跨帧复用
+    cv::Mat transposed_;
+};
+
+// 包装成 rs2::filter，可直接替换滤波链中的 rs2::spatial_filter
+std::shared_ptr<rs2::filter> make_spatial_block(const spatial_filter_options& options);
+
+} // namespace rsd
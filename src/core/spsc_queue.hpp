@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace rsd {
+
+// 有界无锁单生产者/单消费者环形队列
+// 只允许一个线程 push、另一个线程 pop；容量会向上取整为 2 的幂
+template <typename T>
+class spsc_queue {
+public:
+    explicit spsc_queue(size_t capacity)
+        : slots_(round_up(capacity)), mask_(slots_.size() - 1), head_(0), tail_(0) {}
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    // 生产者调用，队列满时返回 false，item 保持不变
+    bool try_push(T&& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用，队列空时返回 false
+    bool try_pop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        // 释放槽位中的资源（例如 rs2::frame 的引用），避免被队列长期持有
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似长度，只用于统计
+    size_t size_approx() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static size_t round_up(size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("spsc_queue: capacity must be positive");
+        }
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        return n;
+    }
+
+    std::vector<T> slots_;
+    const size_t mask_;
+    // 生产者和消费者的索引放在不同缓存行，避免伪共享
+    // （用填充而不是 alignas，C++11 的 new 不保证超对齐）
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char pad2_[64 - sizeof(std::atomic<size_t>)];
+};
+
+} // namespace rsd
@@ -0,0 +1,307 @@
+#include "core/stage_pipeline.hpp"
+#include "core/trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace rsd {
+
+struct stage_pipeline::stage {
+    std::string name;
+    stage_fn fn;
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> dropped;
+    trace::site site;   // 每一级的处理耗时按级名统计
+
+    stage(const std::string& name, stage_fn fn) : name(name), fn(fn), processed(0), dropped(0), site(name) {}
+};
+
+namespace {
+
+// 先自旋让出，再短暂休眠，避免空等占满一个核
+inline void backoff(int& spins) {
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+} // namespace
+
+stage_pipeline::stage_pipeline(drop_policy policy, size_t queue_capacity)
+    : policy_(policy),
+      queue_capacity_(queue_capacity),
+      capture_(new stage("capture", stage_fn())),
+      running_(false) {}
+
+stage_pipeline::~stage_pipeline() {
+    stop();
+}
+
+void stage_pipeline::set_source(source_fn source) {
+    if (running_) {
+        throw std::logic_error("stage_pipeline: cannot change the source while running");
+    }
+    source_ = source;
+}
+
+void stage_pipeline::add_stage(const std::string& name, stage_fn fn) {
+    if (running_) {
+        throw std::logic_error("stage_pipeline: cannot add stages while running");
+    }
+    stages_.emplace_back(new stage(name, fn));
+}
+
+void stage_pipeline::set_cpus(const std::vector<int>& cpus) {
+    if (running_) {
+        throw std::logic_error("stage_pipeline: cannot change thread affinity while running");
+    }
+    cpus_ = cpus;
+}
+
+void stage_pipeline::start() {
+    if (!source_) {
+        throw std::logic_error("stage_pipeline: no source set");
+    }
+    if (running_) {
+        return;
+    }
+
+    queues_.clear();
+    latest_.clear();
+    done_.clear();
+    for (size_t i = 0; i <= stages_.size(); ++i) {
+        if (policy_ == drop_policy::keep_latest) {
+            latest_.emplace_back(new mailbox<frame_packet>());
+        } else {
+            queues_.emplace_back(new spsc_queue<frame_packet>(queue_capacity_));
+        }
+        done_.emplace_back(new std::atomic<bool>(false));
+    }
+
+    running_ = true;
+    threads_.emplace_back(&stage_pipeline::run_source, this);
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        threads_.emplace_back(&stage_pipeline::run_stage, this, i);
+    }
+}
+
+void stage_pipeline::stop() {
+    running_ = false;
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (threads_[i].joinable()) {
+            threads_[i].join();
+        }
+    }
+    threads_.clear();
+}
+
+bool stage_pipeline::push(size_t queue, frame_packet&& packet, std::atomic<uint64_t>& dropped) {
+    if (policy_ == drop_policy::keep_latest) {
+        // 下游积压：新帧替换还没被取走的旧帧，被替换的帧计为丢弃
+        if (latest_[queue]->put(std::move(packet))) {
+            ++dropped;
+        }
+        return true;
+    }
+    int spins = 0;
+    while (!queues_[queue]->try_push(std::move(packet))) {
+        if (!running_) {
+            return false;
+        }
+        backoff(spins);
+    }
+    return true;
+}
+
+bool stage_pipeline::pop(size_t queue, frame_packet& packet) {
+    if (policy_ == drop_policy::keep_latest) {
+        // 邮箱中总是最新的一帧；短超时等待，以便及时发现停止与上游结束
+        while (!latest_[queue]->take(packet, 10)) {
+            if (!running_) {
+                return false;
+            }
+            if (done_[queue]->load(std::memory_order_acquire)) {
+                return latest_[queue]->try_take(packet);
+            }
+        }
+        return true;
+    }
+    int spins = 0;
+    for (;;) {
+        if (queues_[queue]->try_pop(packet)) {
+            break;
+        }
+        if (!running_) {
+            return false;
+        }
+        if (done_[queue]->load(std::memory_order_acquire)) {
+            // 上游结束后再检查一次，避免漏掉结束前最后推入的帧
+            if (queues_[queue]->try_pop(packet)) {
+                break;
+            }
+            return false;
+        }
+        backoff(spins);
+    }
+    return true;
+}
+
+void stage_pipeline::run_source() {
+    stage& capture = *capture_;
+    trace::set_thread_name(capture.name);
+    if (!cpus_.empty()) {
+        pin_current_thread(cpus_[0]);
+    }
+    uint64_t sequence = 0;
+    try {
+        while (running_) {
+            frame_packet packet;
+            if (!source_(packet)) {
+                break;
+            }
+            packet.sequence = sequence++;
+            packet.captured = std::chrono::steady_clock::now();
+            ++capture.processed;
+            push(0, std::move(packet), capture.dropped);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stage_pipeline: capture failed: %s\n", e.what());
+    }
+    done_[0]->store(true, std::memory_order_release);
+}
+
+void stage_pipeline::run_stage(size_t index) {
+    stage& current = *stages_[index];
+    trace::set_thread_name(current.name);
+    if (!cpus_.empty()) {
+        pin_current_thread(cpus_[(index + 1) % cpus_.size()]);
+    }
+    try {
+        frame_packet packet;
+        while (pop(index, packet)) {
+            bool keep;
+            {
+                trace::scope timer(current.site);
+                keep = current.fn(packet);
+            }
+            if (keep) {
+                ++current.processed;
+                push(index + 1, std::move(packet), current.dropped);
+            }
+            packet = frame_packet();
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stage_pipeline: stage '%s' failed: %s\n", current.name.c_str(), e.what());
+    }
+    done_[index + 1]->store(true, std::memory_order_release);
+}
+
+bool stage_pipeline::pop_output(frame_packet& packet, int timeout_ms) {
+    if (done_.empty()) {
+        return false;
+    }
+    const size_t last = done_.size() - 1;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    if (policy_ == drop_policy::keep_latest) {
+        mailbox<frame_packet>& output = *latest_[last];
+        for (;;) {
+            const int remaining = int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            if (output.take(packet, std::max(0, std::min(remaining, 10)))) {
+                break;
+            }
+            if (done_[last]->load(std::memory_order_acquire)) {
+                if (output.try_take(packet)) {
+                    break;
+                }
+                return false;
+            }
+            if (!running_ || remaining <= 0) {
+                return false;
+            }
+        }
+        ++output_popped_;
+        return true;
+    }
+    int spins = 0;
+    while (!queues_[last]->try_pop(packet)) {
+        if (done_[last]->load(std::memory_order_acquire)) {
+            if (queues_[last]->try_pop(packet)) {
+                break;
+            }
+            return false;
+        }
+        if (!running_ || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        backoff(spins);
+    }
+    ++output_popped_;
+    return true;
+}
+
+bool stage_pipeline::finished() const {
+    if (done_.empty()) {
+        return false;
+    }
+    const size_t last = done_.size() - 1;
+    const bool drained = policy_ == drop_policy::keep_latest ? latest_[last]->empty()
+                                                             : queues_[last]->size_approx() == 0;
+    return done_[last]->load(std::memory_order_acquire) && drained;
+}
+
+bool pin_current_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+drop_policy parse_drop_policy(int argc, char** argv, drop_policy fallback) {
+    drop_policy policy = fallback;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--block") {
+            policy = drop_policy::block;
+        } else if (arg == "--keep-latest") {
+            policy = drop_policy::keep_latest;
+        }
+    }
+    return policy;
+}
+
+std::vector<stage_pipeline::stage_stats> stage_pipeline::stats() const {
+    std::vector<stage_stats> result;
+    for (size_t i = 0; i <= stages_.size(); ++i) {
+        const stage& current = i == 0 ? *capture_ : *stages_[i - 1];
+        stage_stats s;
+        s.name = current.name;
+        s.processed = current.processed.load();
+        s.dropped = current.dropped.load();
+        result.push_back(s);
+    }
+    stage_stats output;
+    output.name = "output";
+    output.processed = output_popped_;
+    output.dropped = 0;   // 送到最后一级输出时被替换的帧计入最后一级
+    result.push_back(output);
+    return result;
+}
+
+} // namespace rsd
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "core/mailbox.hpp"
+#include "core/spsc_queue.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsd {
+
+// 队列满或有积压时的处理方式
+enum class drop_policy {
+    block,        // 上游等待下游腾出空间，不丢帧
+    keep_latest   // 下游只处理最新的一帧：级间为单槽邮箱，新帧覆盖还没被取走的旧帧
+};
+
+// 在各级之间传递的数据
+struct frame_packet {
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point captured;
+    rs2::frameset frames;   // 原始帧组
+    rs2::frame depth;       // 当前处理中的深度帧
+    cv::Mat image;          // 后处理产生的图像
+    cv::Mat map;            // 附加输出（例如俯视占据图），可为空
+};
+
+// 多线程分级流水线：采集、各处理级各占一个线程，最后一级的输出由调用线程取走（HighGUI 要求显示在主线程完成）。
+// 级间连接取决于丢帧策略：block 时为容量 queue_capacity 的无锁 SPSC 队列，满时上游等待；
+// keep_latest 时为单槽邮箱（mailbox，互斥锁 + 条件变量），新帧覆盖还没被取走的旧帧，下游空闲时被唤醒。
+// 吞吐量由最慢的一级决定，而不是各级耗时之和
+class stage_pipeline {
+public:
+    // 采集函数：填充 packet.frames，数据源结束时返回 false
+    typedef std::function<bool(frame_packet&)> source_fn;
+    // 处理函数：返回 false 表示丢弃这一帧
+    typedef std::function<bool(frame_packet&)> stage_fn;
+
+    struct stage_stats {
+        std::string name;
+        uint64_t processed;
+        uint64_t dropped;
+    };
+
+    // queue_capacity 只在 block 时生效，为级间队列的容量；keep_latest 时每个连接固定只保留最新一帧，
+    // 该参数被忽略（丢帧策略本身决定了不会积压）
+    explicit stage_pipeline(drop_policy policy = drop_policy::keep_latest, size_t queue_capacity = 4);
+    ~stage_pipeline();
+
+    stage_pipeline(const stage_pipeline&) = delete;
+    stage_pipeline& operator=(const stage_pipeline&) = delete;
+
+    // 必须在 start() 之前调用
+    void set_source(source_fn source);
+    void add_stage(const std::string& name, stage_fn stage);
+    // 把各线程绑定到指定 CPU：采集线程用 cpus[0]，第 i 级用 cpus[(i + 1) % cpus.size()]；为空时不绑定
+    void set_cpus(const std::vector<int>& cpus);
+
+    void start();
+    void stop();
+
+    // 取出最后一级的输出，超时或流水线已结束返回 false
+    bool pop_output(frame_packet& packet, int timeout_ms = 1000);
+
+    // 数据源已结束且所有帧都已取走
+    bool finished() const;
+
+    std::vector<stage_stats> stats() const;
+
+private:
+    struct stage;
+
+    void run_source();
+    void run_stage(size_t index);
+    bool push(size_t queue, frame_packet&& packet, std::atomic<uint64_t>& dropped);
+    bool pop(size_t queue, frame_packet& packet);
+
+    drop_policy policy_;
+    size_t queue_capacity_;
+    source_fn source_;
+    std::vector<int> cpus_;
+    std::unique_ptr<stage> capture_;
+    std::vector<std::unique_ptr<stage>> stages_;
+    // queues_[i] / latest_[i] 为第 i 级的输入，back() 为最终输出；block 时用 queues_，keep_latest 时用 latest_
+    std::vector<std::unique_ptr<spsc_queue<frame_packet>>> queues_;
+    std::vector<std::unique_ptr<mailbox<frame_packet>>> latest_;
+    std::vector<std::unique_ptr<std::atomic<bool>>> done_;  // done_[i]：queues_[i] 的生产者已结束
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_;
+    uint64_t output_popped_ = 0;
+};
+
+// 把调用线程绑定到一个 CPU，平台不支持或失败时返回 false
+bool pin_current_thread(int cpu);
+
+// 从命令行读取丢帧策略：--block 或 --keep-latest，未指定时返回 fallback
+drop_policy parse_drop_policy(int argc, char** argv, drop_policy fallback);
+
+} // namespace rsd
@@ -0,0 +1,160 @@
+#include "core/synthetic_scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+enum surface_id : uint8_t { SURFACE_NONE = 0, SURFACE_FLOOR, SURFACE_LEFT_WALL, SURFACE_BACK_WALL, SURFACE_BOX };
+
+const float CAMERA_HEIGHT = 1.0f;   // 相机离地高度（米），y 轴向下
+const float LEFT_WALL_X = -1.5f;
+const float BACK_WALL_Z = 5.0f;
+const float BOX_Z = 1.5f;
+const float BOX_Y = 0.2f;
+const float BOX_HALF = 0.3f;
+const float BOX_SWING = 0.6f;       // 方块左右摆动幅度（米）
+const float BOX_PERIOD_S = 4.0f;
+
+// murmur3 风格的整数散列，保证跨平台确定性（不依赖 std 分布的实现）
+inline uint32_t hash32(uint32_t x, uint32_t y, uint32_t z, uint32_t seed) {
+    uint32_t h = seed ^ 0x9e3779b9u;
+    h ^= x * 0x85ebca6bu; h = (h << 13) | (h >> 19); h = h * 5u + 0xe6546b64u;
+    h ^= y * 0xc2b2ae35u; h = (h << 13) | (h >> 19); h = h * 5u + 0xe6546b64u;
+    h ^= z * 0x27d4eb2fu; h = (h << 13) | (h >> 19); h = h * 5u + 0xe6546b64u;
+    h ^= h >> 16; h *= 0x85ebca6bu;
+    h ^= h >> 13; h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// 四个字节之和近似正态分布（Irwin-Hall），返回均值 0、标准差约 1 的噪声
+inline float gaussian_from_hash(uint32_t h) {
+    int sum = int(h & 0xff) + int((h >> 8) & 0xff) + int((h >> 16) & 0xff) + int(h >> 24);
+    return (sum - 510) * (1.0f / 147.8f);
+}
+
+inline cv::Vec3b shade(const cv::Vec3b& base, float z) {
+    float k = 1.0f / (1.0f + 0.15f * z);
+    return cv::Vec3b(uint8_t(base[0] * k), uint8_t(base[1] * k), uint8_t(base[2] * k));
+}
+
+} // namespace
+
+synthetic_scene::synthetic_scene(const synthetic_options& options)
+    : options_(options) {
+    if (options_.width <= 0 || options_.height <= 0 || options_.fps <= 0 || options_.depth_units <= 0.0f) {
+        throw std::invalid_argument("synthetic_scene: invalid resolution, fps or depth units");
+    }
+
+    const int width = options_.width;
+    const int height = options_.height;
+
+    // 与 D435 相近的视场角（约 80 度），无畸变
+    intrinsics_.width = width;
+    intrinsics_.height = height;
+    intrinsics_.fx = intrinsics_.fy = 0.6f * width;
+    intrinsics_.ppx = width * 0.5f;
+    intrinsics_.ppy = height * 0.5f;
+    intrinsics_.model = RS2_DISTORTION_BROWN_CONRADY;
+    for (int i = 0; i < 5; ++i) intrinsics_.coeffs[i] = 0.0f;
+
+    ray_x_.resize(width);
+    ray_y_.resize(height);
+    for (int u = 0; u < width; ++u) ray_x_[u] = (u - intrinsics_.ppx) / intrinsics_.fx;
+    for (int v = 0; v < height; ++v) ray_y_[v] = (v - intrinsics_.ppy) / intrinsics_.fy;
+
+    // 静态背景只计算一次：取地面、左墙、后墙中最近的交点
+    static_z_.create(height, width, CV_32F);
+    surface_.create(height, width, CV_8U);
+    for (int v = 0; v < height; ++v) {
+        float* z_row = static_z_.ptr<float>(v);
+        uint8_t* s_row = surface_.ptr<uint8_t>(v);
+        for (int u = 0; u < width; ++u) {
+            float z = BACK_WALL_Z;
+            uint8_t s = SURFACE_BACK_WALL;
+            if (ray_y_[v] > 0.0f && CAMERA_HEIGHT / ray_y_[v] < z) {
+                z = CAMERA_HEIGHT / ray_y_[v];
+                s = SURFACE_FLOOR;
+            }
+            if (ray_x_[u] < 0.0f && LEFT_WALL_X / ray_x_[u] < z) {
+                z = LEFT_WALL_X / ray_x_[u];
+                s = SURFACE_LEFT_WALL;
+            }
+            z_row[u] = z;
+            s_row[u] = s;
+        }
+    }
+}
+
+void synthetic_scene::render(uint64_t index, cv::Mat& depth, cv::Mat* color, cv::Mat* truth) const {
+    const int width = options_.width;
+    const int height = options_.height;
+
+    depth.create(height, width, CV_16U);
+    if (color) color->create(height, width, CV_8UC3);
+    if (truth) truth->create(height, width, CV_16U);
+
+    const float t = float(index) / options_.fps;
+    const float box_x = BOX_SWING * std::sin(2.0f * float(CV_PI) * t / BOX_PERIOD_S);
+    const int band = int(options_.invalid_band * width);
+    const float inv_units = 1.0f / options_.depth_units;
+    const float noise_scale = options_.noise_mm_at_1m * 0.001f * inv_units;
+    const uint32_t hole_threshold = uint32_t(std::min(1.0f, std::max(0.0f, options_.hole_ratio)) * 4294967295.0f);
+    const uint32_t frame = uint32_t(index);
+
+    static const cv::Vec3b floor_dark(90, 90, 90), floor_light(200, 200, 200);
+    static const cv::Vec3b left_wall(60, 140, 200), back_wall(180, 160, 120), box(40, 40, 220);
+
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+        for (int v = range.start; v < range.end; ++v) {
+            const float* z_row = static_z_.ptr<float>(v);
+            const uint8_t* s_row = surface_.ptr<uint8_t>(v);
+            uint16_t* d_row = depth.ptr<uint16_t>(v);
+            uint16_t* t_row = truth ? truth->ptr<uint16_t>(v) : nullptr;
+            cv::Vec3b* c_row = color ? color->ptr<cv::Vec3b>(v) : nullptr;
+            const bool box_row = std::fabs(ray_y_[v] * BOX_Z - BOX_Y) < BOX_HALF;
+
+            for (int u = 0; u < width; ++u) {
+                float z = z_row[u];
+                uint8_t s = s_row[u];
+                if (box_row && BOX_Z < z && std::fabs(ray_x_[u] * BOX_Z - box_x) < BOX_HALF) {
+                    z = BOX_Z;
+                    s = SURFACE_BOX;
+                }
+
+                const bool in_range = z < options_.max_range_m;
+                const float exact = in_range ? std::min(z * inv_units, 65535.0f) : 0.0f;
+                if (t_row) t_row[u] = uint16_t(exact + 0.5f);
+
+                uint16_t value = 0;
+                if (in_range && u >= band
+                    && hash32(uint32_t(u) >> 2, uint32_t(v) >> 2, frame >> 3, options_.seed ^ 0x5bd1e995u) >= hole_threshold) {
+                    float noisy = exact + noise_scale * z * z * gaussian_from_hash(hash32(u, v, frame, options_.seed));
+                    value = uint16_t(std::min(std::max(noisy + 0.5f, 1.0f), 65535.0f));
+                }
+                d_row[u] = value;
+
+                if (c_row) {
+                    switch (s) {
+                    case SURFACE_FLOOR: {
+                        float x = ray_x_[u] * z;
+                        bool light = ((int(std::floor(x * 2.0f)) + int(std::floor(z * 2.0f))) & 1) != 0;
+                        c_row[u] = shade(light ? floor_light : floor_dark, z);
+                        break;
+                    }
+                    case SURFACE_LEFT_WALL: c_row[u] = shade(left_wall, z); break;
+                    case SURFACE_BACK_WALL: c_row[u] = shade(back_wall, z); break;
+                    case SURFACE_BOX: c_row[u] = shade(box, z); break;
+                    default: c_row[u] = cv::Vec3b(0, 0, 0); break;
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace rsd
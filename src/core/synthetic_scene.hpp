@@ -0,0 +1,45 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rsd {
+
+// 合成场景参数
+struct synthetic_options {
+    int width = 640;
+    int height = 480;
+    int fps = 90;
+    float depth_units = 0.001f;    // 每个深度单位对应的米数
+    float noise_mm_at_1m = 2.0f;   // 1m 处的噪声标准差（mm），随 z^2 增长
+    float hole_ratio = 0.02f;      // 随机空洞（4x4 块）所占比例
+    float invalid_band = 0.1f;     // 左侧无效带宽度，占图像宽度的比例
+    float max_range_m = 10.0f;     // 超过该距离的像素视为无效
+    uint32_t seed = 1;             // 噪声与空洞的随机种子
+};
+
+// 确定性的深度/彩色合成场景：地面、左墙、后墙和一个左右移动的方块
+// 相同的参数和帧序号总是生成完全相同的图像
+class synthetic_scene {
+public:
+    explicit synthetic_scene(const synthetic_options& options = synthetic_options());
+
+    // 渲染第 index 帧。depth 为 CV_16U，color 为 CV_8UC3，truth 为无噪声无空洞的 CV_16U
+    // 输出 Mat 若已分配且尺寸正确则直接写入
+    void render(uint64_t index, cv::Mat& depth, cv::Mat* color = nullptr, cv::Mat* truth = nullptr) const;
+
+    const synthetic_options& options() const { return options_; }
+    rs2_intrinsics intrinsics() const { return intrinsics_; }
+
+private:
+    synthetic_options options_;
+    rs2_intrinsics intrinsics_;
+    std::vector<float> ray_x_;     // 每列的 (u - ppx) / fx
+    std::vector<float> ray_y_;     // 每行的 (v - ppy) / fy
+    cv::Mat static_z_;             // 静态背景的深度（米），CV_32F
+    cv::Mat surface_;              // 静态背景的表面编号，CV_8U
+};
+
+} // namespace rsd
@@ -0,0 +1,260 @@
+#include "core/temporal_filter.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace rsd {
+
+namespace {
+
+// 持续性模式：最近 8 帧历史中，mask 选中的位里至少 min_count 位有效才沿用上一输出
+struct persistence_rule {
+    uint8_t mask;
+    uint8_t min_count;
+};
+
+const persistence_rule persistence_rules[9] = {
+    {0x00, 9},  // 0: 关闭
+    {0xff, 8},  // 1: 8/8
+    {0x07, 2},  // 2: 最近 3 帧中 2 帧
+    {0x0f, 2},  // 3: 最近 4 帧中 2 帧
+    {0xff, 2},  // 4: 8 帧中 2 帧
+    {0x03, 1},  // 5: 最近 2 帧中 1 帧
+    {0x1f, 1},  // 6: 最近 5 帧中 1 帧
+    {0xff, 1},  // 7: 8 帧中 1 帧
+    {0x00, 0},  // 8: 总是
+};
+
+struct row_params {
+    int16_t alpha_q15;
+    uint16_t delta;
+    uint8_t mask;
+    uint8_t min_count;
+    const uint8_t* credible;
+};
+
+// 处理一行：in 与 out 可以相同；last 为上一输出（同时被更新），history 为有效性位历史
+typedef void (*row_fn)(const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* history,
+                       int count, const row_params& p);
+
+void row_scalar(const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* history,
+                int count, const row_params& p) {
+    for (int i = 0; i < count; ++i) {
+        const int cur = in[i];
+        const int prev = last[i];
+        const uint8_t h = history[i];
+        int result;
+        if (cur > 0) {
+            const int diff = cur - prev;
+            // 与 SIMD 的 mulhrs / vqrdmulh 相同的舍入：(diff * a + 2^14) >> 15
+            result = prev > 0 && std::abs(diff) < p.delta ? prev + ((diff * p.alpha_q15 + 0x4000) >> 15) : cur;
+        } else {
+            result = prev > 0 && p.credible[h] ? prev : 0;
+        }
+        out[i] = uint16_t(result);
+        last[i] = uint16_t(result);
+        history[i] = uint8_t((h << 1) | (cur > 0 ? 1 : 0));
+    }
+}
+
+#if defined(RSD_X86)
+
+RSD_TARGET("avx2")
+void row_avx2(const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* history,
+              int count, const row_params& p) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi16(p.alpha_q15);
+    const __m256i delta_m1 = _mm256_set1_epi16(short(p.delta - 1));
+    const __m128i mask = _mm_set1_epi8(char(p.mask));
+    const __m128i min_m1 = _mm_set1_epi8(char(p.min_count - 1));
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    const __m128i one = _mm_set1_epi8(1);
+    // 4 位 popcount 表
+    const __m128i nibble_count = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last + i));
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(history + i));
+
+        __m256i invalid = _mm256_cmpeq_epi16(cur, zero);
+        __m256i prev_invalid = _mm256_cmpeq_epi16(prev, zero);
+
+        // |cur - prev| < delta，无符号比较用 min(x, delta - 1) == x
+        __m256i absdiff = _mm256_or_si256(_mm256_subs_epu16(cur, prev), _mm256_subs_epu16(prev, cur));
+        __m256i close = _mm256_andnot_si256(prev_invalid,
+                                            _mm256_cmpeq_epi16(_mm256_min_epu16(absdiff, delta_m1), absdiff));
+        __m256i blended = _mm256_add_epi16(prev, _mm256_mulhrs_epi16(_mm256_sub_epi16(cur, prev), alpha));
+        __m256i smoothed = _mm256_blendv_epi8(cur, blended, close);
+
+        // 历史位计数 >= min_count
+        __m128i masked = _mm_and_si128(h, mask);
+        __m128i bits = _mm_add_epi8(_mm_shuffle_epi8(nibble_count, _mm_and_si128(masked, low_nibble)),
+                                    _mm_shuffle_epi8(nibble_count, _mm_and_si128(_mm_srli_epi16(masked, 4), low_nibble)));
+        __m256i credible = _mm256_cvtepi8_epi16(_mm_cmpgt_epi8(bits, min_m1));
+        __m256i filled = _mm256_and_si256(_mm256_andnot_si256(prev_invalid, credible), prev);
+
+        __m256i result = _mm256_blendv_epi8(smoothed, filled, invalid);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), result);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(last + i), result);
+
+        // 256 位 pack 按 128 位通道交错，permute 后低 128 位即 16 个按序的字节
+        __m128i invalid8 = _mm256_castsi256_si128(
+            _mm256_permute4x64_epi64(_mm256_packs_epi16(invalid, invalid), 0xD8));
+        h = _mm_or_si128(_mm_add_epi8(h, h), _mm_andnot_si128(invalid8, one));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(history + i), h);
+    }
+    row_scalar(in + i, out + i, last + i, history + i, count - i, p);
+}
+
+#endif
+
+#if defined(RSD_NEON)
+
+inline uint16x8_t blend8_neon(uint16x8_t cur, uint16x8_t prev, uint16x8_t credible,
+                              int16x8_t alpha, uint16x8_t delta) {
+    const uint16x8_t zero = vdupq_n_u16(0);
+    uint16x8_t invalid = vceqq_u16(cur, zero);
+    uint16x8_t prev_valid = vmvnq_u16(vceqq_u16(prev, zero));
+    uint16x8_t close = vandq_u16(prev_valid, vcltq_u16(vabdq_u16(cur, prev), delta));
+    int16x8_t diff = vsubq_s16(vreinterpretq_s16_u16(cur), vreinterpretq_s16_u16(prev));
+    uint16x8_t blended = vreinterpretq_u16_s16(vaddq_s16(vreinterpretq_s16_u16(prev), vqrdmulhq_s16(diff, alpha)));
+    uint16x8_t smoothed = vbslq_u16(close, blended, cur);
+    uint16x8_t filled = vandq_u16(vandq_u16(prev_valid, credible), prev);
+    return vbslq_u16(invalid, filled, smoothed);
+}
+
+void row_neon(const uint16_t* in, uint16_t* out, uint16_t* last, uint8_t* history,
+              int count, const row_params& p) {
+    const int16x8_t alpha = vdupq_n_s16(p.alpha_q15);
+    const uint16x8_t delta = vdupq_n_u16(p.delta);
+    const uint8x16_t mask = vdupq_n_u8(p.mask);
+    const uint8x16_t min_count = vdupq_n_u8(p.min_count);
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint16x8_t zero = vdupq_n_u16(0);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint16x8_t cur0 = vld1q_u16(in + i);
+        uint16x8_t cur1 = vld1q_u16(in + i + 8);
+        uint16x8_t prev0 = vld1q_u16(last + i);
+        uint16x8_t prev1 = vld1q_u16(last + i + 8);
+        uint8x16_t h = vld1q_u8(history + i);
+
+        int8x16_t credible8 = vreinterpretq_s8_u8(vcgeq_u8(vcntq_u8(vandq_u8(h, mask)), min_count));
+        uint16x8_t credible0 = vreinterpretq_u16_s16(vmovl_s8(vget_low_s8(credible8)));
+        uint16x8_t credible1 = vreinterpretq_u16_s16(vmovl_s8(vget_high_s8(credible8)));
+
+        uint16x8_t result0 = blend8_neon(cur0, prev0, credible0, alpha, delta);
+        uint16x8_t result1 = blend8_neon(cur1, prev1, credible1, alpha, delta);
+        vst1q_u16(out + i, result0);
+        vst1q_u16(out + i + 8, result1);
+        vst1q_u16(last + i, result0);
+        vst1q_u16(last + i + 8, result1);
+
+        uint8x16_t invalid8 = vcombine_u8(vmovn_u16(vceqq_u16(cur0, zero)), vmovn_u16(vceqq_u16(cur1, zero)));
+        h = vorrq_u8(vshlq_n_u8(h, 1), vbicq_u8(one, invalid8));
+        vst1q_u8(history + i, h);
+    }
+    row_scalar(in + i, out + i, last + i, history + i, count - i, p);
+}
+
+#endif
+
+row_fn select_row() {
+    switch (simd::detect()) {
+#if defined(RSD_X86)
+    case simd::isa::avx2: return row_avx2;
+#endif
+#if defined(RSD_NEON)
+    case simd::isa::neon: return row_neon;
+#endif
+    default: return row_scalar;
+    }
+}
+
+} // namespace
+
+temporal_filter_options temporal_filter_options::from(const rs2::options& filter) {
+    temporal_filter_options options;
+    options.alpha = filter.get_option(RS2_OPTION_FILTER_SMOOTH_ALPHA);
+    options.delta = filter.get_option(RS2_OPTION_FILTER_SMOOTH_DELTA);
+    options.persistence = int(filter.get_option(RS2_OPTION_HOLES_FILL));
+    return options;
+}
+
+native_temporal_filter::native_temporal_filter(const temporal_filter_options& options) {
+    set_options(options);
+}
+
+void native_temporal_filter::set_options(const temporal_filter_options& options) {
+    if (options.alpha < 0 || options.alpha > 1) {
+        throw std::invalid_argument("temporal_filter: alpha must be in [0, 1]");
+    }
+    if (options.delta < 1) {
+        throw std::invalid_argument("temporal_filter: delta must be at least 1");
+    }
+    if (options.persistence < 0 || options.persistence > 8) {
+        throw std::invalid_argument("temporal_filter: persistence must be in [0, 8]");
+    }
+    options_ = options;
+
+    // alpha = 1 时取 32767，差值小于 2^14 时结果与 alpha = 1 完全相同
+    alpha_q15_ = uint16_t(std::min(32767L, std::lround(options.alpha * 32768.0f)));
+    // 差值需在 int16 范围内才能做定点混合，更大的 delta 没有实际意义
+    delta_ = uint16_t(std::min(32767L, std::lround(options.delta)));
+
+    const persistence_rule& rule = persistence_rules[options.persistence];
+    persistence_mask_ = rule.mask;
+    persistence_min_ = rule.min_count;
+    for (int h = 0; h < 256; ++h) {
+        int bits = 0;
+        for (int b = 0; b < 8; ++b) {
+            bits += (h & rule.mask) >> b & 1;
+        }
+        credible_[h] = bits >= rule.min_count ? 1 : 0;
+    }
+}
+
+void native_temporal_filter::reset() {
+    last_.release();
+    history_.release();
+}
+
+void native_temporal_filter::process(const cv::Mat& depth, cv::Mat& out) {
+    CV_Assert(depth.type() == CV_16UC1);
+    if (last_.size() != depth.size()) {
+        last_ = cv::Mat::zeros(depth.size(), CV_16UC1);
+        history_ = cv::Mat::zeros(depth.size(), CV_8UC1);
+    }
+    out.create(depth.size(), CV_16UC1);
+
+    row_params p;
+    p.alpha_q15 = int16_t(alpha_q15_);
+    p.delta = delta_;
+    p.mask = persistence_mask_;
+    p.min_count = persistence_min_;
+    p.credible = credible_;
+    const row_fn row = select_row();
+
+    // 各像素互相独立，按行并行
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            row(depth.ptr<uint16_t>(y), out.ptr<uint16_t>(y), last_.ptr<uint16_t>(y),
+                history_.ptr<uint8_t>(y), depth.cols, p);
+        }
+    });
+}
+
+std::shared_ptr<rs2::filter> make_temporal_block(const temporal_filter_options& options) {
+    std::shared_ptr<native_temporal_filter> filter(new native_temporal_filter(options));
+    return make_rs2_filter([filter](const cv::Mat& in, cv::Mat& out) {
+        filter->process(in, out);
+    });
+}
+
+} // namespace rsd
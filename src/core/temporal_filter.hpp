@@ -0,0 +1,55 @@
+#pragma once
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+
+namespace rsd {
+
+// 时域滤波参数，含义与 rs2::temporal_filter 的选项一致
+struct temporal_filter_options {
+    float alpha;        // RS2_OPTION_FILTER_SMOOTH_ALPHA，当前帧权重
+    float delta;        // RS2_OPTION_FILTER_SMOOTH_DELTA，超过该差值视为运动，不做平滑（深度单位）
+    int persistence;    // RS2_OPTION_HOLES_FILL，0 关闭，1 8/8，2 2/3，3 2/4，4 2/8，5 1/2，6 1/5，7 1/8，8 总是
+
+    temporal_filter_options(float alpha = 0.4f, float delta = 20, int persistence = 3)
+        : alpha(alpha), delta(delta), persistence(persistence) {}
+
+    // 读取已配置好的 rs2::temporal_filter 的参数
+    static temporal_filter_options from(const rs2::options& filter);
+};
+
+// 原生时域滤波：上一帧输出与每像素 8 帧有效性位历史保存在预分配的缓冲中，
+// 每帧单次遍历、无内存分配。有效像素与上一输出差值小于 delta 时按 alpha 做定点指数平滑；
+// 无效像素按 persistence 查表（最近 8 帧中有效的次数）决定是否沿用上一输出。
+// 每台相机使用独立实例，实例之间没有共享状态
+class native_temporal_filter {
+public:
+    explicit native_temporal_filter(const temporal_filter_options& options = temporal_filter_options());
+
+    void set_options(const temporal_filter_options& options);
+    const temporal_filter_options& options() const { return options_; }
+
+    // 清空历史（切换场景或分辨率变化时自动调用）
+    void reset();
+
+    // depth 为 CV_16UC1，out 为同尺寸 CV_16UC1（已分配则直接写入，可与 depth 相同，即原地更新）
+    void process(const cv::Mat& depth, cv::Mat& out);
+    void process(cv::Mat& depth) { process(depth, depth); }
+
+private:
+    temporal_filter_options options_;
+    uint16_t alpha_q15_;        // alpha 的 Q15 定点值
+    uint16_t delta_;
+    uint8_t persistence_mask_;  // 参与计数的历史位
+    uint8_t persistence_min_;   // 至少有效的帧数
+    uint8_t credible_[256];     // 历史位 -> 是否沿用上一输出
+    cv::Mat last_;              // 上一帧输出，CV_16UC1
+    cv::Mat history_;           // 每像素有效性位历史，CV_8UC1，最低位为最近一帧
+};
+
+// 包装成 rs2::filter，可直接替换滤波链中的 rs2::temporal_filter
+std::shared_ptr<rs2::filter> make_temporal_block(const temporal_filter_options& options);
+
+} // namespace rsd
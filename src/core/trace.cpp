@@ -0,0 +1,501 @@
+#include "core/trace.hpp"
+#include "core/spsc_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace rsd {
+namespace trace {
+
+namespace detail {
+std::atomic<bool> enabled(false);
+}
+
+namespace {
+
+const int max_sites = 64;
+
+// 对数分档直方图（HdrHistogram 的简化版）：64 ns 以下每纳秒一档，
+// 之后每个 2 的幂区间分 32 档，相对误差不超过 1/32；覆盖到 2^36 ns（约 68 s），更长的计入最后一档
+const int sub_bits = 5;
+const int sub_count = 1 << sub_bits;
+const int bucket_count = 1024;
+const int max_bits = 36;
+
+// 每个线程缓存的 Chrome trace 事件数，导出线程每个周期取走一次
+const size_t event_capacity = 16384;
+
+int highest_bit(uint64_t v) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(v | 1);
+#else
+    int bit = 0;
+    while (v >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+int bucket_of(uint64_t ns) {
+    if (ns >> max_bits) {
+        return bucket_count - 1;
+    }
+    const int shift = std::max(0, highest_bit(ns) - sub_bits);
+    return shift * sub_count + int(ns >> shift);
+}
+
+uint64_t bucket_low(int bucket) {
+    if (bucket < 2 * sub_count) {
+        return uint64_t(bucket);
+    }
+    const int shift = bucket / sub_count - 1;
+    return uint64_t(bucket - shift * sub_count) << shift;
+}
+
+uint64_t bucket_width(int bucket) {
+    return bucket < 2 * sub_count ? 1 : uint64_t(1) << (bucket / sub_count - 1);
+}
+
+// 每个线程、每个计时点一份，只有所属线程写入，导出线程只读
+struct histogram {
+    std::atomic<uint32_t> counts[bucket_count];
+    std::atomic<uint64_t> sum;
+
+    histogram() : sum(0) {
+        for (int i = 0; i < bucket_count; ++i) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct event {
+    int site;
+    uint64_t start;
+    uint64_t duration;
+};
+
+struct thread_buffer {
+    int tid;
+    std::string name;   // 受 registry::mutex 保护
+    std::atomic<histogram*> sites[max_sites];
+    std::atomic<spsc_queue<event>*> events;   // 开启 Chrome trace 后由所属线程创建
+    std::atomic<uint64_t> dropped;
+
+    explicit thread_buffer(int tid) : tid(tid), events(nullptr), dropped(0) {
+        for (int i = 0; i < max_sites; ++i) {
+            sites[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    ~thread_buffer() {
+        for (int i = 0; i < max_sites; ++i) {
+            delete sites[i].load();
+        }
+        delete events.load();
+    }
+};
+
+// 全局登记表：只在登记计时点、登记线程和导出时加锁，记录路径不加锁
+struct registry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<thread_buffer>> threads;
+    std::atomic<bool> chrome;
+
+    registry() : chrome(false) {}
+};
+
+registry& global() {
+    static registry r;
+    return r;
+}
+
+thread_local thread_buffer* local = nullptr;
+
+thread_buffer& local_buffer() {
+    if (!local) {
+        registry& r = global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.emplace_back(new thread_buffer(int(r.threads.size()) + 1));
+        local = r.threads.back().get();
+    }
+    return *local;
+}
+
+// 所有线程的直方图求和，counts 为 max_sites * bucket_count，调用者持有 registry::mutex
+void collect(registry& r, std::vector<uint64_t>& counts, std::vector<uint64_t>& sums) {
+    counts.assign(size_t(max_sites) * bucket_count, 0);
+    sums.assign(max_sites, 0);
+    for (size_t t = 0; t < r.threads.size(); ++t) {
+        for (int s = 0; s < max_sites; ++s) {
+            const histogram* h = r.threads[t]->sites[s].load(std::memory_order_acquire);
+            if (!h) {
+                continue;
+            }
+            uint64_t* dst = &counts[size_t(s) * bucket_count];
+            for (int b = 0; b < bucket_count; ++b) {
+                dst[b] += h->counts[b].load(std::memory_order_relaxed);
+            }
+            sums[s] += h->sum.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+double percentile_us(const uint64_t* counts, uint64_t total, double p) {
+    const uint64_t target = std::max<uint64_t>(1, uint64_t(p * double(total) + 0.5));
+    uint64_t below = 0;
+    for (int b = 0; b < bucket_count; ++b) {
+        below += counts[b];
+        if (below >= target) {
+            return (double(bucket_low(b)) + double(bucket_width(b) - 1) / 2) / 1000.0;
+        }
+    }
+    return 0.0;
+}
+
+bool summarize(const std::string& name, const uint64_t* counts, uint64_t sum, stage_summary& out) {
+    uint64_t total = 0;
+    int last = -1;
+    for (int b = 0; b < bucket_count; ++b) {
+        if (counts[b]) {
+            total += counts[b];
+            last = b;
+        }
+    }
+    if (total == 0) {
+        return false;
+    }
+    out.name = name;
+    out.count = total;
+    out.mean_us = double(sum) / double(total) / 1000.0;
+    out.p50_us = percentile_us(counts, total, 0.5);
+    out.p99_us = percentile_us(counts, total, 0.99);
+    out.p999_us = percentile_us(counts, total, 0.999);
+    out.max_us = double(bucket_low(last) + bucket_width(last) - 1) / 1000.0;
+    return true;
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '"' || s[i] == '\\') {
+            out += '\\';
+        }
+        out += s[i];
+    }
+    return out;
+}
+
+// 后台导出线程及其状态
+class exporter {
+public:
+    explicit exporter(const config& cfg) : cfg_(cfg), stop_(false), first_event_(true) {
+        if (!cfg_.csv_path.empty()) {
+            csv_.open(cfg_.csv_path.c_str());
+            if (!csv_) throw std::runtime_error("trace: cannot open " + cfg_.csv_path);
+            csv_ << "time_s,stage,count,mean_us,p50_us,p99_us,p999_us,max_us\n";
+        }
+        if (!cfg_.chrome_path.empty()) {
+            chrome_.open(cfg_.chrome_path.c_str());
+            if (!chrome_) throw std::runtime_error("trace: cannot open " + cfg_.chrome_path);
+            chrome_ << "{\"traceEvents\":[\n";
+        }
+
+        registry& r = global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        collect(r, previous_, previous_sums_);
+        start_ = now_ns();
+        // 丢弃上一个会话残留的事件
+        event stale;
+        for (size_t t = 0; t < r.threads.size(); ++t) {
+            spsc_queue<event>* q = r.threads[t]->events.load(std::memory_order_acquire);
+            while (q && q->try_pop(stale)) {}
+        }
+        r.chrome.store(chrome_.is_open());
+    }
+
+    void start() {
+        thread_ = std::thread([this] {
+            set_thread_name("trace-export");
+            std::unique_lock<std::mutex> lock(mutex_);
+            const std::chrono::duration<double> interval(std::max(0.1, cfg_.interval_seconds));
+            while (!cv_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                export_once();
+                lock.lock();
+            }
+        });
+    }
+
+    // 停止导出线程并做最后一次导出
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        global().chrome.store(false);
+        export_once();
+        if (chrome_.is_open()) {
+            registry& r = global();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            uint64_t dropped = 0;
+            for (size_t t = 0; t < r.threads.size(); ++t) {
+                const thread_buffer& b = *r.threads[t];
+                dropped += b.dropped.load();
+                if (!b.name.empty()) {
+                    write_separator();
+                    chrome_ << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b.tid
+                            << ",\"args\":{\"name\":\"" << json_escape(b.name) << "\"}}";
+                }
+            }
+            chrome_ << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+            chrome_.close();
+        }
+    }
+
+private:
+    void write_separator() {
+        if (!first_event_) {
+            chrome_ << ",\n";
+        }
+        first_event_ = false;
+    }
+
+    void export_once() {
+        registry& r = global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::vector<uint64_t> counts, sums;
+        collect(r, counts, sums);
+        const double elapsed = double(now_ns() - start_) / 1e9;
+
+        std::vector<uint64_t> interval(bucket_count);
+        std::vector<stage_summary> totals;
+        for (int s = 0; s < int(r.names.size()) && s < max_sites; ++s) {
+            const uint64_t* now = &counts[size_t(s) * bucket_count];
+            const uint64_t* before = &previous_[size_t(s) * bucket_count];
+            stage_summary summary;
+            if (csv_.is_open()) {
+                for (int b = 0; b < bucket_count; ++b) {
+                    interval[b] = now[b] - before[b];
+                }
+                if (summarize(r.names[s], &interval[0], sums[s] - previous_sums_[s], summary)) {
+                    csv_ << std::fixed << std::setprecision(3) << elapsed << ',' << summary.name << ','
+                         << summary.count << ',' << summary.mean_us << ',' << summary.p50_us << ','
+                         << summary.p99_us << ',' << summary.p999_us << ',' << summary.max_us << '\n';
+                }
+            }
+            if (summarize(r.names[s], now, sums[s], summary)) {
+                totals.push_back(summary);
+            }
+        }
+        csv_.flush();
+        previous_.swap(counts);
+        previous_sums_.swap(sums);
+
+        if (!cfg_.json_path.empty()) {
+            write_json(elapsed, totals);
+        }
+
+        if (chrome_.is_open()) {
+            event e;
+            for (size_t t = 0; t < r.threads.size(); ++t) {
+                spsc_queue<event>* q = r.threads[t]->events.load(std::memory_order_acquire);
+                while (q && q->try_pop(e)) {
+                    write_separator();
+                    chrome_ << std::fixed << std::setprecision(3)
+                            << "{\"name\":\"" << json_escape(r.names[e.site]) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                            << r.threads[t]->tid << ",\"ts\":" << double(e.start - start_) / 1000.0
+                            << ",\"dur\":" << double(e.duration) / 1000.0 << "}";
+                }
+            }
+            chrome_.flush();
+        }
+    }
+
+    // 先写临时文件再用 rename 原子替换，读取方只会看到旧的或新的完整文件，不会看到写了一半或不存在的文件。
+    // 在导出线程中调用，失败时只打印错误，保留上一次的结果
+    void write_json(double elapsed, const std::vector<stage_summary>& totals) {
+        const std::string tmp = cfg_.json_path + ".tmp";
+        {
+            std::ofstream out(tmp.c_str());
+            out << std::fixed << std::setprecision(3);
+            out << "{\n  \"elapsed_s\": " << elapsed << ",\n  \"stages\": [";
+            for (size_t i = 0; i < totals.size(); ++i) {
+                const stage_summary& s = totals[i];
+                out << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(s.name) << "\", \"count\": " << s.count
+                    << ", \"mean_us\": " << s.mean_us << ", \"p50_us\": " << s.p50_us << ", \"p99_us\": " << s.p99_us
+                    << ", \"p999_us\": " << s.p999_us << ", \"max_us\": " << s.max_us << "}";
+            }
+            out << "\n  ]\n}\n";
+            out.close();
+            if (!out) {
+                std::cerr << "trace: cannot write " << tmp << std::endl;
+                std::remove(tmp.c_str());
+                return;
+            }
+        }
+        if (std::rename(tmp.c_str(), cfg_.json_path.c_str()) != 0) {
+            std::perror(("trace: cannot replace " + cfg_.json_path).c_str());
+            std::remove(tmp.c_str());
+        }
+    }
+
+    config cfg_;
+    std::ofstream csv_;
+    std::ofstream chrome_;
+    std::vector<uint64_t> previous_;
+    std::vector<uint64_t> previous_sums_;
+    uint64_t start_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+    bool first_event_;
+};
+
+std::unique_ptr<exporter> active_exporter;
+
+} // namespace
+
+site::site(const std::string& name) : id_(-1) {
+    registry& r = global();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < r.names.size(); ++i) {
+        if (r.names[i] == name) {
+            id_ = int(i);
+            return;
+        }
+    }
+    if (int(r.names.size()) < max_sites) {
+        id_ = int(r.names.size());
+        r.names.push_back(name);
+    }
+}
+
+uint64_t now_ns() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void record(const site& s, uint64_t start_ns, uint64_t duration_ns) {
+    if (s.id() < 0) {
+        return;
+    }
+    thread_buffer& b = local_buffer();
+    histogram* h = b.sites[s.id()].load(std::memory_order_relaxed);
+    if (!h) {
+        h = new histogram();
+        b.sites[s.id()].store(h, std::memory_order_release);
+    }
+    // 单写者：读-加-写即可，不需要原子读改写指令
+    std::atomic<uint32_t>& count = h->counts[bucket_of(duration_ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h->sum.store(h->sum.load(std::memory_order_relaxed) + duration_ns, std::memory_order_relaxed);
+
+    if (global().chrome.load(std::memory_order_relaxed)) {
+        spsc_queue<event>* q = b.events.load(std::memory_order_relaxed);
+        if (!q) {
+            q = new spsc_queue<event>(event_capacity);
+            b.events.store(q, std::memory_order_release);
+        }
+        event e = {s.id(), start_ns, duration_ns};
+        if (!q->try_push(std::move(e))) {
+            b.dropped.store(b.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void set_thread_name(const std::string& name) {
+    thread_buffer& b = local_buffer();
+    std::lock_guard<std::mutex> lock(global().mutex);
+    b.name = name;
+}
+
+std::vector<stage_summary> snapshot() {
+    registry& r = global();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<uint64_t> counts, sums;
+    collect(r, counts, sums);
+    std::vector<stage_summary> result;
+    for (int s = 0; s < int(r.names.size()) && s < max_sites; ++s) {
+        stage_summary summary;
+        if (summarize(r.names[s], &counts[size_t(s) * bucket_count], sums[s], summary)) {
+            result.push_back(summary);
+        }
+    }
+    return result;
+}
+
+session::session(const config& cfg) : active_(false) {
+    begin(cfg);
+}
+
+session::session(int argc, char** argv) : active_(false) {
+    config cfg;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--trace") {
+            if (!has_value) throw std::invalid_argument("--trace requires an output prefix");
+            const std::string prefix = argv[++i];
+            cfg.csv_path = prefix + ".csv";
+            cfg.json_path = prefix + ".json";
+        } else if (arg == "--trace-interval") {
+            if (!has_value || std::atof(argv[i + 1]) <= 0) throw std::invalid_argument("--trace-interval expects a positive number of seconds");
+            cfg.interval_seconds = std::atof(argv[++i]);
+        } else if (arg == "--chrome-trace") {
+            if (!has_value) throw std::invalid_argument("--chrome-trace requires a file path");
+            cfg.chrome_path = argv[++i];
+        }
+    }
+    if (!cfg.csv_path.empty() || !cfg.chrome_path.empty()) {
+        begin(cfg);
+    }
+}
+
+void session::begin(const config& cfg) {
+    if (active_exporter) {
+        throw std::logic_error("trace: a session is already active");
+    }
+    active_exporter.reset(new exporter(cfg));
+    active_exporter->start();
+    detail::enabled.store(true);
+    active_ = true;
+}
+
+session::~session() {
+    if (!active_) {
+        return;
+    }
+    detail::enabled.store(false);
+    active_exporter->finish();
+    active_exporter.reset();
+
+    std::vector<stage_summary> totals = snapshot();
+    std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(10) << "count"
+              << std::setw(12) << "mean_us" << std::setw(12) << "p50_us" << std::setw(12) << "p99_us"
+              << std::setw(12) << "p99.9_us" << std::setw(12) << "max_us" << std::endl;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        const stage_summary& s = totals[i];
+        std::cout << std::left << std::setw(20) << s.name << std::right << std::setw(10) << s.count
+                  << std::fixed << std::setprecision(1) << std::setw(12) << s.mean_us << std::setw(12) << s.p50_us
+                  << std::setw(12) << s.p99_us << std::setw(12) << s.p999_us << std::setw(12) << s.max_us << std::endl;
+    }
+}
+
+} // namespace trace
+} // namespace rsd
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rsd {
+namespace trace {
+
+// 一个计时点，通常由 RSD_TRACE_SCOPE 以函数内静态变量创建；名字在构造时登记，
+// 同名的计时点共用一个编号，统计时合并在一起
+class site {
+public:
+    explicit site(const std::string& name);
+
+    int id() const { return id_; }   // 计时点数量超过上限时为 -1，不记录
+
+private:
+    int id_;
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+// 未开启记录时，scope 只做一次原子读
+inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+// 单调时钟，纳秒
+uint64_t now_ns();
+
+// 记录一次耗时：写入当前线程自己的直方图（单写者，无锁），
+// 开启 Chrome trace 时同时把事件放进当前线程的 SPSC 环形队列，满了就丢弃并计数
+void record(const site& s, uint64_t start_ns, uint64_t duration_ns);
+
+// 当前线程在 Chrome trace 中显示的名字
+void set_thread_name(const std::string& name);
+
+class scope {
+public:
+    explicit scope(const site& s) : site_(enabled() ? &s : 0), start_(site_ ? now_ns() : 0) {}
+    ~scope() {
+        if (site_) {
+            record(*site_, start_, now_ns() - start_);
+        }
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    const site* site_;
+    uint64_t start_;
+};
+
+// 一个计时点的统计，耗时单位为微秒；百分位数来自对数分档直方图，相对误差约 3%
+struct stage_summary {
+    std::string name;
+    uint64_t count;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+};
+
+// 程序开始记录以来各计时点的累计统计（没有记录的计时点不出现）
+std::vector<stage_summary> snapshot();
+
+struct config {
+    std::string csv_path;        // 每个导出周期追加一组区间统计，空表示不写
+    std::string json_path;       // 每个导出周期覆盖写入累计统计，空表示不写
+    std::string chrome_path;     // Chrome trace（chrome://tracing / Perfetto），空表示不记录事件
+    double interval_seconds = 5.0;
+};
+
+// 记录会话：开启记录并启动后台导出线程，析构时做最后一次导出、关闭记录并在标准输出打印汇总。
+// 同一时间只能有一个会话
+class session {
+public:
+    explicit session(const config& cfg);
+    // 从命令行读取：--trace <prefix> 写 <prefix>.csv 与 <prefix>.json，
+    // --trace-interval <秒> 导出周期，--chrome-trace <file> 记录 Chrome trace；都没有时不开启
+    session(int argc, char** argv);
+    ~session();
+
+    session(const session&) = delete;
+    session& operator=(const session&) = delete;
+
+    bool active() const { return active_; }
+
+private:
+    void begin(const config& cfg);
+
+    bool active_;
+};
+
+} // namespace trace
+} // namespace rsd
+
+#define RSD_TRACE_CONCAT_(a, b) a##b
+#define RSD_TRACE_CONCAT(a, b) RSD_TRACE_CONCAT_(a, b)
+
+// 对所在作用域计时，name 必须是字符串字面量
+#define RSD_TRACE_SCOPE(name) \
+    static const ::rsd::trace::site RSD_TRACE_CONCAT(rsd_trace_site_, __LINE__)(name); \
+    ::rsd::trace::scope RSD_TRACE_CONCAT(rsd_trace_scope_, __LINE__)(RSD_TRACE_CONCAT(rsd_trace_site_, __LINE__))
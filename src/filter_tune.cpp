@@ -0,0 +1,320 @@
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/cli.hpp"
+#include "core/filter_chain.hpp"
+#include "core/frame_source.hpp"
+
+// 滤波链自动调参：把一段录像（或合成数据）送入所有滤波顺序与参数组合，
+// 测量每帧耗时和相对参考深度的误差，输出 Pareto 最优的配置
+//
+// 用法：filter_tune --bag record.bag [--frames 60] [--orders all|repo] [--out filter_tune]
+//                    [--warmup 5] [--max-error 20] [--min-fill 0.9] [--native]
+//       filter_tune --synthetic --size 640x480
+
+namespace {
+
+// 参数网格
+struct tune_grid {
+    std::vector<float> decimation_magnitude = {2};
+    std::vector<float> spatial_magnitude = {2, 3, 5};
+    std::vector<float> spatial_alpha = {0.5f, 1.0f};
+    std::vector<float> spatial_delta = {20, 50};
+    std::vector<float> spatial_holes_fill = {0, 3};
+    std::vector<bool> native_spatial = {false};
+    std::vector<float> temporal_alpha = {0.4f};
+    std::vector<float> temporal_delta = {20, 50};
+    std::vector<float> temporal_persistence = {3};
+    std::vector<bool> native_temporal = {false};
+    std::vector<float> hole_filling_mode = {1};
+};
+
+// 单个配置的测量结果
+struct tune_result {
+    rsd::filter_chain_config config;
+    double mean_ms = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double mae_mm = 0;       // 输出与参考都有效的像素上的平均绝对误差
+    double fill_ratio = 0;   // 参考有效的像素中，输出也有效的比例
+    bool pareto = false;
+};
+
+std::vector<std::vector<rsd::filter_kind>> make_orders(bool all) {
+    std::vector<std::vector<rsd::filter_kind>> orders;
+    if (!all) {
+        // 仓库中已有的两种顺序：version2/4/5 与 version3
+        orders.push_back({rsd::filter_kind::spatial, rsd::filter_kind::temporal,
+                          rsd::filter_kind::hole_filling, rsd::filter_kind::decimation});
+        orders.push_back({rsd::filter_kind::decimation, rsd::filter_kind::spatial,
+                          rsd::filter_kind::temporal, rsd::filter_kind::hole_filling});
+        return orders;
+    }
+    std::vector<rsd::filter_kind> order = {rsd::filter_kind::decimation, rsd::filter_kind::spatial,
+                                           rsd::filter_kind::temporal, rsd::filter_kind::hole_filling};
+    do {
+        orders.push_back(order);
+    } while (std::next_permutation(order.begin(), order.end()));
+    return orders;
+}
+
+std::vector<rsd::filter_chain_config> make_configs(const tune_grid& grid, bool all_orders) {
+    std::vector<rsd::filter_chain_config> configs;
+    for (const std::vector<rsd::filter_kind>& order : make_orders(all_orders))
+    for (float dm : grid.decimation_magnitude)
+    for (float sm : grid.spatial_magnitude)
+    for (float sa : grid.spatial_alpha)
+    for (float sd : grid.spatial_delta)
+    for (float sh : grid.spatial_holes_fill)
+    for (bool ns : grid.native_spatial)
+    for (float ta : grid.temporal_alpha)
+    for (float td : grid.temporal_delta)
+    for (float tp : grid.temporal_persistence)
+    for (bool nt : grid.native_temporal)
+    for (float hm : grid.hole_filling_mode) {
+        rsd::filter_chain_config c;
+        c.order = order;
+        c.decimation_magnitude = dm;
+        c.spatial_magnitude = sm;
+        c.spatial_alpha = sa;
+        c.spatial_delta = sd;
+        c.spatial_holes_fill = sh;
+        c.native_spatial = ns;
+        c.temporal_alpha = ta;
+        c.temporal_delta = td;
+        c.temporal_persistence = tp;
+        c.native_temporal = nt;
+        c.hole_filling_mode = hm;
+        configs.push_back(c);
+    }
+    return configs;
+}
+
+cv::Mat frame_to_mat(const rs2::frame& frame) {
+    rs2::video_frame video = frame.as<rs2::video_frame>();
+    return cv::Mat(video.get_height(), video.get_width(), CV_16U, const_cast<void*>(video.get_data()),
+                   size_t(video.get_stride_in_bytes()));
+}
+
+// 录像没有真值时，用各像素有效值的时间中值作为参考（假设场景基本静止）
+cv::Mat temporal_median(const std::vector<rs2::frame>& frames) {
+    const cv::Mat first = frame_to_mat(frames[0]);
+    cv::Mat reference = cv::Mat::zeros(first.size(), CV_16U);
+    std::vector<cv::Mat> mats;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        mats.push_back(frame_to_mat(frames[i]));
+    }
+
+    std::vector<uint16_t> samples;
+    for (int y = 0; y < reference.rows; ++y) {
+        for (int x = 0; x < reference.cols; ++x) {
+            samples.clear();
+            for (size_t i = 0; i < mats.size(); ++i) {
+                uint16_t v = mats[i].at<uint16_t>(y, x);
+                if (v > 0) samples.push_back(v);
+            }
+            if (samples.size() * 2 > mats.size()) {
+                std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+                reference.at<uint16_t>(y, x) = samples[samples.size() / 2];
+            }
+        }
+    }
+    return reference;
+}
+
+// 累计一帧的误差，输出分辨率不同（降采样）时先按最近邻放大到参考分辨率
+void accumulate_error(const cv::Mat& output, const cv::Mat& reference, double& abs_sum, uint64_t& matched, uint64_t& missing) {
+    cv::Mat resized = output;
+    if (output.size() != reference.size()) {
+        cv::resize(output, resized, reference.size(), 0, 0, cv::INTER_NEAREST);
+    }
+    for (int y = 0; y < reference.rows; ++y) {
+        const uint16_t* ref = reference.ptr<uint16_t>(y);
+        const uint16_t* out = resized.ptr<uint16_t>(y);
+        for (int x = 0; x < reference.cols; ++x) {
+            if (ref[x] == 0) continue;
+            if (out[x] == 0) {
+                ++missing;
+            } else {
+                abs_sum += std::abs(int(out[x]) - int(ref[x]));
+                ++matched;
+            }
+        }
+    }
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    size_t k = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+bool dominates(const tune_result& a, const tune_result& b) {
+    bool no_worse = a.mean_ms <= b.mean_ms && a.mae_mm <= b.mae_mm && a.fill_ratio >= b.fill_ratio;
+    bool better = a.mean_ms < b.mean_ms || a.mae_mm < b.mae_mm || a.fill_ratio > b.fill_ratio;
+    return no_worse && better;
+}
+
+void write_csv(const std::string& path, const std::vector<tune_result>& results, bool pareto_only) {
+    std::ofstream out(path.c_str());
+    out << "chain,mean_ms,p50_ms,p99_ms,mae_mm,fill_ratio,pareto\n";
+    for (const tune_result& r : results) {
+        if (pareto_only && !r.pareto) continue;
+        out << '"' << r.config.describe() << "\"," << r.mean_ms << ',' << r.p50_ms << ',' << r.p99_ms << ','
+            << r.mae_mm << ',' << r.fill_ratio << ',' << (r.pareto ? 1 : 0) << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // 默认读取 60 帧合成数据，--bag 指定录像
+    rsd::source_config source_cfg;
+    source_cfg.kind = rsd::source_kind::synthetic;
+    source_cfg.enable_depth(640, 480, 90);
+    source_cfg.max_frames = 60;
+
+    bool all_orders = true;
+    tune_grid grid;
+    std::string out_prefix = "filter_tune";
+    size_t warmup = 5;
+    double max_error = -1;
+    double min_fill = 0;
+
+    try {
+        rsd::parse_source_args(argc, argv, source_cfg);
+        if (rsd::has_flag(argc, argv, "--native")) {
+            // 同时评估 rs2 与原生空间 / 时域滤波器
+            grid.native_spatial = {false, true};
+            grid.native_temporal = {false, true};
+        }
+        for (int i = 1; i + 1 < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--orders") all_orders = std::string(argv[++i]) != "repo";
+            else if (arg == "--out") out_prefix = argv[++i];
+            else if (arg == "--warmup") warmup = size_t(std::atoi(argv[++i]));
+            else if (arg == "--max-error") max_error = std::atof(argv[++i]);
+            else if (arg == "--min-fill") min_fill = std::atof(argv[++i]);
+        }
+
+        // 读入整段序列，保留在内存中反复使用
+        std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+        source->start();
+        const float depth_scale = source->depth_scale();
+        std::vector<rs2::frame> sequence;
+        rs2::frameset frames;
+        while (source->next(frames)) {
+            rs2::frame depth = frames.get_depth_frame();
+            depth.keep();
+            sequence.push_back(depth);
+        }
+        source->stop();
+        if (sequence.size() <= warmup) {
+            std::cerr << "Not enough frames: " << sequence.size() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Loaded " << sequence.size() << " frames from " << source->description() << std::endl;
+
+        // 参考深度：合成数据使用真值，录像使用时间中值
+        std::vector<cv::Mat> references;
+        if (source_cfg.kind == rsd::source_kind::synthetic) {
+            rsd::synthetic_options options = source_cfg.synthetic;
+            options.width = source_cfg.depth_width;
+            options.height = source_cfg.depth_height;
+            options.fps = source_cfg.depth_fps;
+            rsd::synthetic_scene scene(options);
+            cv::Mat depth;
+            for (size_t i = 0; i < sequence.size(); ++i) {
+                cv::Mat truth;
+                scene.render(sequence[i].get_frame_number(), depth, nullptr, &truth);
+                references.push_back(truth);
+            }
+        } else {
+            references.assign(sequence.size(), temporal_median(sequence));
+        }
+
+        const std::vector<rsd::filter_chain_config> configs = make_configs(grid, all_orders);
+        std::cout << "Evaluating " << configs.size() << " configurations" << std::endl;
+
+        std::vector<tune_result> results;
+        for (size_t c = 0; c < configs.size(); ++c) {
+            // 每个配置使用全新的滤波器实例，保证 temporal 的历史互不影响
+            rsd::filter_chain chain(configs[c]);
+            std::vector<double> latencies;
+            double abs_sum = 0;
+            uint64_t matched = 0, missing = 0;
+
+            for (size_t i = 0; i < sequence.size(); ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                rs2::frame output = chain.process(sequence[i]);
+                auto end = std::chrono::steady_clock::now();
+                if (i < warmup) continue;
+
+                latencies.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+                accumulate_error(frame_to_mat(output), references[i], abs_sum, matched, missing);
+            }
+
+            tune_result r;
+            r.config = configs[c];
+            double total = 0;
+            for (double l : latencies) total += l;
+            r.mean_ms = total / latencies.size();
+            r.p50_ms = percentile(latencies, 0.5);
+            r.p99_ms = percentile(latencies, 0.99);
+            r.mae_mm = matched ? abs_sum / matched * depth_scale * 1000.0 : 0;
+            r.fill_ratio = matched + missing ? double(matched) / double(matched + missing) : 0;
+            results.push_back(r);
+
+            std::cout << "[" << c + 1 << "/" << configs.size() << "] " << r.config.describe()
+                      << "  " << r.mean_ms << " ms, MAE " << r.mae_mm << " mm, fill " << r.fill_ratio << std::endl;
+        }
+
+        // Pareto 前沿：耗时、误差、填充率三个目标上都不被其他配置支配
+        for (size_t i = 0; i < results.size(); ++i) {
+            results[i].pareto = true;
+            for (size_t j = 0; j < results.size() && results[i].pareto; ++j) {
+                if (j != i && dominates(results[j], results[i])) {
+                    results[i].pareto = false;
+                }
+            }
+        }
+        std::sort(results.begin(), results.end(), [](const tune_result& a, const tune_result& b) {
+            return a.mean_ms < b.mean_ms;
+        });
+
+        write_csv(out_prefix + "_all.csv", results, false);
+        write_csv(out_prefix + "_pareto.csv", results, true);
+        std::cout << "Wrote " << out_prefix << "_all.csv and " << out_prefix << "_pareto.csv" << std::endl;
+
+        // 给定精度要求时，输出满足要求的最快配置
+        if (max_error >= 0) {
+            for (const tune_result& r : results) {
+                if (r.mae_mm <= max_error && r.fill_ratio >= min_fill) {
+                    std::cout << "Fastest chain with MAE <= " << max_error << " mm and fill >= " << min_fill << ": "
+                              << r.config.describe() << " (" << r.mean_ms << " ms)" << std::endl;
+                    return EXIT_SUCCESS;
+                }
+            }
+            std::cout << "No chain meets MAE <= " << max_error << " mm and fill >= " << min_fill << std::endl;
+        }
+    }
+    catch (const rs2::error& e) {
+        std::cerr << "RealSense error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
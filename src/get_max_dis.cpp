@@ -2,70 +2,73 @@
 #include <opencv2/opencv.hpp>   // 包含 OpenCV 头文件
 #include <iostream>
 #include <algorithm>
+#include <memory>
 
-int main() {
-    // 创建 RealSense 管道
-    rs2::pipeline pipe;
-    rs2::config cfg;
+#include "core/depth_stats.hpp"
+#include "core/display_service.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+int main(int argc, char** argv) {
+    // 创建帧来源配置
+    rsd::source_config source_cfg;
 
     // 启用深度流和彩色流
     /* 424*240, 480*270, 640*360, 640*480, 848*480, 1280*720
        6Hz, 15Hz, 30Hz, 60Hz, 90Hz
     */
-    cfg.enable_stream(rs2_stream::RS2_STREAM_DEPTH, 1280, 720, rs2_format::RS2_FORMAT_Z16, 30);
-    cfg.enable_stream(rs2_stream::RS2_STREAM_COLOR, 1280, 720, rs2_format::RS2_FORMAT_BGR8, 30);
+    source_cfg.enable_depth(1280, 720, 30);
+    source_cfg.enable_color(1280, 720, 30);
+    rsd::parse_source_args(argc, argv, source_cfg);
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
+
+    // 启动帧来源
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
+
+    // 只需要最值及其位置，不统计直方图
+    rsd::depth_stats stats(rsd::depth_stats_options(false));
+
+    // 输出缓冲跨帧复用
+    rsd::frame_pool buffers;
 
-    // 启动管道
-    rs2::pipeline_profile profile = pipe.start(cfg);
+    // 处理循环在后台线程运行，主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
 
     try {
-        while (true) {
+        display.run([&] {
             // 等待下一组帧（深度帧和彩色帧）
-            rs2::frameset frames = pipe.wait_for_frames();
+            rs2::frameset frames;
+            if (!source->next(frames)) {
+                return false;
+            }
 
             // 获取深度帧和彩色帧
             rs2::depth_frame depth_frame = frames.get_depth_frame();
             rs2::video_frame color_frame = frames.get_color_frame();
 
-            // 获取深度图的宽度和高度
-            int width = depth_frame.get_width();
-            int height = depth_frame.get_height();
-
-            // 获取深度数据
-            const uint16_t* depth_data = (const uint16_t*)depth_frame.get_data();
-
-            // 初始化最大距离及其坐标
-            float max_distance = 0.0f;
-            int max_x = 0, max_y = 0;
-
-            // 遍历深度图，找到最大距离及其坐标
-            for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                    // 获取当前像素的深度值（单位为毫米）
-                    uint16_t depth_value = depth_data[y * width + x];
-
-                    // 将深度值转换为米
-                    float distance = depth_value * depth_frame.get_units();
-
-                    // 更新最大距离及其坐标
-                    if (distance > max_distance) {
-                        max_distance = distance;
-                        max_x = x;
-                        max_y = y;
-                    }
-                }
-            }
+            // 将深度帧转换为 OpenCV 格式（尺寸与行跨度取自帧本身）
+            cv::Mat depth_image = rsd::depth_view(depth_frame);
+
+            // 在 Z16 上找到最大深度及其坐标，只在最后换算一次米
+            const rsd::depth_summary& summary = stats.compute(depth_image);
+            float max_distance = summary.max * depth_frame.get_units();
+            int max_x = summary.argmax.x, max_y = summary.argmax.y;
 
             // 输出最大距离
             std::cout << "Max distance in the depth frame: " << max_distance << " meters" << std::endl;
 
-            // 将深度帧转换为 OpenCV 格式
-            cv::Mat depth_image(cv::Size(width, height), CV_16UC1, (void*)depth_frame.get_data(), cv::Mat::AUTO_STEP);
-            cv::Mat depth_image_8u;
+            cv::Mat depth_image_8u = buffers.acquire(depth_image.size(), CV_8U);
             depth_image.convertTo(depth_image_8u, CV_8U, 255.0 / 5000); // 将深度图归一化到 0-255
 
-            // 将彩色帧转换为 OpenCV 格式
-            cv::Mat color_image(cv::Size(width, height), CV_8UC3, (void*)color_frame.get_data(), cv::Mat::AUTO_STEP);
+            // 将彩色帧拷贝到池中的缓冲再画标记，不修改 librealsense 的帧内存
+            cv::Mat color_view = rsd::frame_view(color_frame, CV_8UC3);
+            cv::Mat color_image = buffers.acquire(color_view.size(), CV_8UC3);
+            color_view.copyTo(color_image);
 
             // 在深度图中标记最远的点
             cv::circle(depth_image_8u, cv::Point(max_x, max_y), 10, cv::Scalar(0, 0, 255), 2); // 红色圆圈
@@ -74,14 +77,12 @@ int main() {
             cv::circle(color_image, cv::Point(max_x, max_y), 10, cv::Scalar(0, 0, 255), 2); // 红色圆圈
 
             // 显示深度图和彩色图
-            cv::imshow("Depth Image", depth_image_8u);
-            cv::imshow("Color Image", color_image);
+            display.show("Depth Image", depth_image_8u);
+            display.show("Color Image", color_image);
 
             // 按下 ESC 键退出
-            if (cv::waitKey(1) == 27) {
-                break;
-            }
-        }
+            return display.poll_key() != 27;
+        });
     }
     catch (const rs2::error& e) {
         std::cerr << "RealSense error: " << e.what() << std::endl;
@@ -92,8 +93,8 @@ int main() {
         return EXIT_FAILURE;
     }
 
-    // 停止管道
-    pipe.stop();
+    // 停止帧来源
+    source->stop();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
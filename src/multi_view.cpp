@@ -0,0 +1,135 @@
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/cli.hpp"
+#include "core/clip_quantize.hpp"
+#include "core/display_service.hpp"
+#include "core/filter_chain.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+#include "core/multi_camera.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+// 多相机：每台设备独立采集、滤波、裁剪量化，按硬件时间戳配成同步的多视图组，拼接后显示
+//
+// 用法：multi_view                         使用全部已连接的相机（--serial <sn> 可重复指定，--cameras <n> 限制数量）
+//       multi_view --bag a.bag --bag b.bag   每个录像代替一台相机
+//       multi_view --synthetic --cameras 4   4 路合成数据
+//       --native-spatial / --native-temporal 同 version5，--block 不丢帧，--headless 只统计吞吐
+int main(int argc, char** argv) {
+    rsd::source_config base;
+    base.enable_depth(640, 480, 90);
+
+    std::vector<rsd::source_config> sources;
+    try {
+        sources = rsd::parse_multi_source_args(argc, argv, base);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
+
+    // 主线程按刷新率显示最新一组，--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Multi View", cv::WINDOW_NORMAL);
+
+    rsd::multi_camera_options options;
+    options.policy = rsd::parse_drop_policy(argc, argv, rsd::drop_policy::keep_latest);
+    rsd::multi_camera cameras(sources, options);
+
+    // 每台设备一条独立的滤波链（时域滤波的历史帧不能共享），只在该设备的处理线程中使用
+    rsd::filter_chain_config chain_config;
+    chain_config.native_spatial = rsd::has_flag(argc, argv, "--native-spatial");
+    chain_config.native_temporal = rsd::has_flag(argc, argv, "--native-temporal");
+    std::vector<std::unique_ptr<rsd::filter_chain>> chains;
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        chains.emplace_back(new rsd::filter_chain(chain_config));
+    }
+
+    // 输出缓冲：每台设备的队列、待配组帧和显示中的帧都可能占用
+    rsd::frame_pool buffers(8 * cameras.size());
+    const rsd::clip_range clip(100, 5000);
+
+    cameras.set_processing([&](size_t device, rsd::frame_packet& packet) {
+        packet.depth = chains[device]->process(packet.depth);
+        cv::Mat depth_image = rsd::depth_view(packet.depth.as<rs2::video_frame>());
+        cv::Mat quantized = buffers.acquire(depth_image.size(), CV_8U);
+        rsd::clip_quantize(depth_image, quantized, clip);
+        packet.image = quantized;
+        return true;
+    });
+
+    try {
+        cameras.start();
+    } catch (const rs2::error& e) {
+        std::cerr << "RealSense error: " << e.what() << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        std::cout << "camera " << i << ": " << cameras.source(i).description() << std::endl;
+    }
+
+    rsd::fps_counter fps_meter;
+    double max_spread = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    // 合并在显示服务的处理线程中进行
+    display.run([&] {
+        rsd::multi_frame set;
+        if (!cameras.next(set, 100)) {
+            return !cameras.finished();
+        }
+        max_spread = std::max(max_spread, set.spread_ms);
+        if (display.headless()) {
+            return true;
+        }
+
+        // 各视图从左到右拼接，分辨率不同时按最大高度留黑边
+        int width = 0, height = 0;
+        for (const rsd::frame_packet& view : set.views) {
+            width += view.image.cols;
+            height = std::max(height, view.image.rows);
+        }
+        cv::Mat canvas = buffers.acquire(height, width, CV_8U);
+        canvas.setTo(0);
+        int x = 0;
+        for (const rsd::frame_packet& view : set.views) {
+            cv::Mat tile = canvas(cv::Rect(x, 0, view.image.cols, view.image.rows));
+            view.image.copyTo(tile);
+            x += view.image.cols;
+        }
+        char spread[48];
+        std::snprintf(spread, sizeof(spread), "spread: %.2f ms", set.spread_ms);
+        cv::putText(canvas, fps_meter.tick(), cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255), 2);
+        cv::putText(canvas, spread, cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255), 2);
+        display.show("Multi View", canvas);
+
+        // 按下 ESC 键退出
+        return display.poll_key() != 27;
+    });
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cameras.stop();
+
+    // 各设备的帧数与同步组的速率
+    const std::vector<rsd::multi_camera::device_stats> stats = cameras.stats();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const rsd::multi_camera::device_stats& s = stats[i];
+        std::cout << "camera " << i << ": captured " << s.captured << ", dropped " << s.dropped
+                  << ", unmatched " << s.unmatched << std::endl;
+    }
+    std::cout << "sets: " << cameras.set_count() << " (" << cameras.set_count() / std::max(seconds, 1e-9)
+              << " /s), max spread " << max_spread << " ms, tolerance " << cameras.sync_tolerance_ms() << " ms"
+              << std::endl;
+    return 0;
+}
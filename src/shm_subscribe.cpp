@@ -0,0 +1,85 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "core/depth_colormap.hpp"
+#include "core/display_service.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+#include "core/shm_ring.hpp"
+
+// 共享内存订阅示例：读取 version_5 / align 用 --publish 发布的深度，着色显示并统计速率
+//
+// 用法：shm_subscribe [--name /rsd_depth] [--latest] [--headless]
+//       --latest 每次只取最新一帧（适合处理比发布慢的消费者），默认逐帧读取、落后太多时跳到最新
+int main(int argc, char** argv) {
+    std::string name = "/rsd_depth";
+    bool latest_only = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--latest") {
+            latest_only = true;
+        }
+    }
+
+    std::unique_ptr<rsd::shm_subscriber> subscriber;
+    try {
+        subscriber.reset(new rsd::shm_subscriber(name));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Shared Depth", cv::WINDOW_NORMAL);
+
+    rsd::depth_colorizer colorizer(100, 6000, rsd::colormap::jet);
+    rsd::fps_counter fps_meter;
+    rsd::frame_pool buffers;
+
+    uint64_t received = 0;
+    uint64_t overwritten = 0;   // 读取期间槽被发布方复用，结果作废
+    uint64_t last_sequence = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    display.run([&] {
+        rsd::shm_frame frame;
+        const bool got = latest_only ? subscriber->latest(frame) && (received == 0 || frame.sequence != last_sequence)
+                                     : subscriber->next(frame, 100);
+        if (!got) {
+            if (latest_only) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return !subscriber->closed() && display.poll_key() != 27;
+        }
+
+        // 直接从共享内存着色，之后确认期间没有被覆盖
+        cv::Mat colored = buffers.acquire(frame.depth.size(), CV_8UC3);
+        colorizer.colorize(frame.depth, colored);
+        if (!subscriber->valid(frame)) {
+            ++overwritten;
+            return true;
+        }
+        ++received;
+        last_sequence = frame.sequence;
+
+        cv::putText(colored, fps_meter.tick(), cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+        display.show("Shared Depth", colored);
+
+        // 按下 ESC 键退出
+        return display.poll_key() != 27;
+    });
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "received " << received << " (" << received / std::max(seconds, 1e-9) << " /s), skipped "
+              << subscriber->skipped() << ", overwritten while reading " << overwritten
+              << (subscriber->closed() ? ", publisher closed" : "") << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "core/depth_colormap.hpp"
+#include "core/depth_stream.hpp"
+#include "core/display_service.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+
+// 推流客户端示例：连接 version_5 / align 用 --stream 启动的服务端，着色显示并统计带宽
+//
+// 用法：stream_view [--connect unix:/tmp/rsd_depth.sock | <主机>:<端口>] [--headless]
+int main(int argc, char** argv) {
+    std::string address = "unix:/tmp/rsd_depth.sock";
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--connect") {
+            address = argv[++i];
+        }
+    }
+
+    std::unique_ptr<rsd::stream_client> client;
+    try {
+        client.reset(new rsd::stream_client(address));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Stream Depth", cv::WINDOW_NORMAL);
+
+    rsd::depth_colorizer colorizer(100, 6000, rsd::colormap::jet);
+    rsd::fps_counter fps_meter;
+    rsd::frame_pool buffers;
+
+    uint64_t missed = 0;         // 服务端因本客户端跟不上而丢弃的帧（序号不连续）
+    uint64_t last_sequence = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    try {
+        display.run([&] {
+            rsd::stream_frame frame;
+            if (!client->next(frame, 100)) {
+                return client->connected() && display.poll_key() != 27;
+            }
+            if (client->get_stats().frames > 1) {
+                missed += frame.sequence - last_sequence - 1;
+            }
+            last_sequence = frame.sequence;
+
+            cv::Mat colored = buffers.acquire(frame.depth.size(), CV_8UC3);
+            colorizer.colorize(frame.depth, colored);
+            cv::putText(colored, fps_meter.tick(), cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+            display.show("Stream Depth", colored);
+            if (!frame.color.empty()) {
+                // 彩色缓冲在下一次 next() 时被覆盖，交给显示线程前先拷贝
+                cv::Mat color = buffers.acquire(frame.color.size(), CV_8UC3);
+                frame.color.copyTo(color);
+                display.show("Stream Color", color);
+            }
+
+            // 按下 ESC 键退出
+            return display.poll_key() != 27;
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    const double seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1e-9);
+    const rsd::stream_client::stats stats = client->get_stats();
+    std::cout << "received " << stats.frames << " (" << stats.frames / seconds << " /s, " << stats.key_frames
+              << " key), " << stats.bytes * 8 / seconds / 1e6 << " Mbit/s, missed " << missed
+              << (client->connected() ? "" : ", server disconnected") << std::endl;
+    return 0;
+}
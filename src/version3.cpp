@@ -1,32 +1,45 @@
 #include <librealsense2/rs.hpp>
 #include <opencv2/opencv.hpp>
 #include <iostream>
-#include <chrono>
-
-int main() {
+#include <memory>
+
+#include "core/depth_align.hpp"
+#include "core/display_service.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/pixel_pipeline.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/trace.hpp"
+
+int main(int argc, char** argv) {
     int ALIGN_WAY = 1; // 0: 彩色图像对齐到深度图; 1: 深度图对齐到彩色图像
 
-    // 创建管道对象
-    rs2::pipeline pipeline;
-    rs2::config cfg;
+    // 创建帧来源配置
+    rsd::source_config source_cfg;
 
     // 配置深度流，640x480分辨率，30帧率
     /* 424*240, 480*270, 640*360, 640*480, 848*480, 1280*720
        6Hz, 15Hz, 30Hz, 60Hz, 90Hz
     */
-    cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 90);
-    cfg.enable_stream(RS2_STREAM_COLOR, 640, 480, RS2_FORMAT_BGR8, 30);
+    source_cfg.enable_depth(640, 480, 90);
+    source_cfg.enable_color(640, 480, 30);
+    rsd::parse_source_args(argc, argv, source_cfg);
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
 
     float depth_clipping_distance[2] = {0.1f, 5.0f}; // 深度裁剪距离
 
-    // 启动管道
-    rs2::pipeline_profile profile = pipeline.start(cfg);
+    // 启动帧来源
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     // 获取深度比例
-    float depth_scale = profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+    float depth_scale = source->depth_scale();
 
     // 设置对齐方式
-    rs2::align align(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
+    std::shared_ptr<rs2::filter> align = rsd::make_align_block(ALIGN_WAY == 1 ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH);
 
     // 创建滤波器
     rs2::decimation_filter decimation_filter;
@@ -41,74 +54,59 @@ int main() {
     spatial_filter.set_option(RS2_OPTION_FILTER_SMOOTH_DELTA, 50); // 平滑阈值
     spatial_filter.set_option(RS2_OPTION_HOLES_FILL, 3); // 填充孔洞
 
-    // 计时器变量，用于计算帧率
-    auto last_time = std::chrono::high_resolution_clock::now();
+    // 帧率显示
+    rsd::fps_counter fps_meter;
+
+    // 输出缓冲跨帧复用
+    rsd::frame_pool buffers;
 
-    while (true) {
+    // 处理循环在后台线程运行，主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    // 以1280*720分辨率显示：由窗口缩放，不再逐帧 cv::resize
+    display.create_window("Depth Image", cv::WINDOW_NORMAL, cv::Size(1280, 720));
+
+    display.run([&] {
         // 获取一帧数据
-        rs2::frameset frames = pipeline.wait_for_frames();
+        rs2::frameset frames;
+        if (!source->next(frames)) {
+            return false;
+        }
 
         // 对齐帧
-        rs2::frameset aligned_frames = align.process(frames);
+        rs2::frameset aligned_frames = align->process(frames);
 
         rs2::depth_frame depth_frame = aligned_frames.get_depth_frame();
 
-        cv::Mat align(cv::Size(640, 480), CV_16U, (void*)depth_frame.get_data(), cv::Mat::AUTO_STEP);
-        cv::Mat align_norm;
+        cv::Mat align = rsd::depth_view(depth_frame);
+        cv::Mat align_norm = buffers.acquire(align.size(), CV_8UC1);
         cv::normalize(align, align_norm, 0, 255, cv::NORM_MINMAX, CV_8UC1);
-        cv::imshow("aligned", align_norm);
+        display.show("aligned", align_norm);
 
         rs2::depth_frame filtered = depth_frame;
 
-        filtered = decimation_filter.process(filtered);
-        filtered = spatial_filter.process(filtered);
-        filtered = temporal_filter.process(filtered);
-        filtered = hole_filling.process(filtered);
-
-        // 获取深度数据
-        const uint16_t* depth_data = reinterpret_cast<const uint16_t*>(filtered.get_data());
-
-        // 将深度数据转换为OpenCV Mat
-        cv::Mat depth_image(filtered.get_height(), filtered.get_width(), CV_16U, const_cast<uint16_t*>(depth_data));
-
-        // 将NaN值替换为最大值
-        for (int i = 0; i < depth_image.rows; ++i) {
-            for (int j = 0; j < depth_image.cols; ++j) {
-                uint16_t depth_value = depth_image.at<uint16_t>(i, j);
-                if (std::isnan(depth_value)) {
-                    depth_image.at<uint16_t>(i, j) = depth_clipping_distance[1] / 0.001f; // 替换为最大值
-                }
-            }
+        { RSD_TRACE_SCOPE("decimation"); filtered = decimation_filter.process(filtered); }
+        { RSD_TRACE_SCOPE("spatial"); filtered = spatial_filter.process(filtered); }
+        { RSD_TRACE_SCOPE("temporal"); filtered = temporal_filter.process(filtered); }
+        { RSD_TRACE_SCOPE("hole_filling"); filtered = hole_filling.process(filtered); }
+
+        // 将深度数据转换为OpenCV Mat（只读视图，不拷贝）
+        cv::Mat depth_image = rsd::depth_view(filtered);
+
+        // 将深度图裁剪到0m到6m的范围（深度单位是毫米），再转换为灰度图，重新映射到0-255范围。
+        // 裁剪和转换融合为一次遍历，结果写入池中的缓冲，不修改滤波器输出的帧内存
+        cv::Mat final_depth_image = buffers.acquire(depth_image.size(), CV_8U);
+        {
+            RSD_TRACE_SCOPE("clip_convert");
+            const auto to_gray = rsd::pixel::clip(depth_clipping_distance[0] / 0.001f, depth_clipping_distance[1] / 0.001f)
+                               | rsd::pixel::scale(0.1f);
+            rsd::pixel::apply<uint8_t>(to_gray, depth_image, final_depth_image);
         }
 
-        // 将深度图裁剪到0m到6m的范围（深度单位是毫米）
-        for (int i = 0; i < depth_image.rows; ++i) {
-            for (int j = 0; j < depth_image.cols; ++j) {
-                uint16_t depth_value = depth_image.at<uint16_t>(i, j);
-                // 转换为米并裁剪
-                // float depth_in_meters = depth_value * 0.001f; // 毫米转换为米
-                if (depth_value > depth_clipping_distance[1] / 0.001f) {
-                    depth_image.at<uint16_t>(i, j) = depth_clipping_distance[1] / 0.001f; // 超过6米的深度值设为6
-                } else if (depth_value < depth_clipping_distance[0] / 0.001f) {
-                    depth_image.at<uint16_t>(i, j) = depth_clipping_distance[0] / 0.001f; // 小于0的深度值设为0
-                }
-            }
-        }
-
-        // 将裁剪后的深度图转换为灰度图，重新映射到0-255范围
-        cv::Mat final_depth_image;
-        depth_image.convertTo(final_depth_image, CV_8U, 0.1);  // 重新转换为灰度图
-
         // save depth_image to file
         // cv::imwrite("depth_image.jpg", final_depth_image);
 
-        // 计算和显示帧率
-        auto current_time = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> duration = current_time - last_time;
-        double fps = 1.0 / duration.count();
-        last_time = current_time;
-
-        std::string fps_text = "FPS: " + std::to_string(fps);
+        // 显示帧率：刷新周期内的平均值，文字只在刷新时重新格式化
+        const std::string& fps_text = fps_meter.tick();
 
         // 获取当前分辨率
         cv::Size depth_size = final_depth_image.size();
@@ -118,15 +116,11 @@ int main() {
         // 显示当前分辨率
         cv::putText(final_depth_image, "Resolution: " + std::to_string(depth_size.width) + "x" + std::to_string(depth_size.height), cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
 
-        // 以1280*720分辨率显示
-        cv::resize(final_depth_image, final_depth_image, cv::Size(1280, 720));
+        // 交给显示线程，不等待显示完成
+        display.show("Depth Image", final_depth_image);
 
-        cv::imshow("Depth Image", final_depth_image);
-
-        if (cv::waitKey(1) == 'q') {
-            break;
-        }
-    }
+        return display.poll_key() != 'q';
+    });
 
     return 0;
 }
\ No newline at end of file
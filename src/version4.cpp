@@ -1,24 +1,41 @@
 #include <librealsense2/rs.hpp>
 #include <opencv2/opencv.hpp>
 #include <iostream>
-
-int main() {
+#include <memory>
+
+#include "core/cli.hpp"
+#include "core/clip_quantize.hpp"
+#include "core/display_service.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/spatial_filter.hpp"
+#include "core/temporal_filter.hpp"
+#include "core/trace.hpp"
+
+int main(int argc, char** argv) {
     // 创建 RealSense 管道
-    rs2::pipeline p;
-    rs2::config cfg;
+    rsd::source_config source_cfg;
 
     // 配置深度流，640x480分辨率，30帧率
     /* 424*240, 480*270, 640*360, 640*480, 848*480, 1280*720
        6Hz, 15Hz, 30Hz, 60Hz, 90Hz
     */
-    cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 90);
+    source_cfg.enable_depth(640, 480, 90);
+    rsd::parse_source_args(argc, argv, source_cfg);
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
 
     // 配置并启动管道
-    p.start(cfg);
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     // 设置裁剪距离范围（单位：米）
     uint16_t min_distance = 100; // 最小距离 (mm)
     uint16_t max_distance = 5000; // 最大距离 (mm)
+    rsd::clip_range clip(min_distance, max_distance);
 
     // 创建滤波器
     rs2::decimation_filter decimation_filter;
@@ -36,68 +53,50 @@ int main() {
     temporal_filter.set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, 0.4);
     temporal_filter.set_option(RS2_OPTION_HOLES_FILL, 3);
 
-    // 创建 OpenCV 窗口
-    cv::namedWindow("Depth Image", cv::WINDOW_NORMAL);
+    // --native-spatial：用原生空间滤波器替换 rs2::spatial_filter，参数相同
+    std::shared_ptr<rs2::filter> native_spatial = rsd::make_spatial_block(rsd::spatial_filter_options::from(spatial_filter));
+    rs2::filter& spatial = rsd::has_flag(argc, argv, "--native-spatial") ? *native_spatial : spatial_filter;
+
+    // --native-temporal：用原生时域滤波器替换 rs2::temporal_filter，参数相同
+    std::shared_ptr<rs2::filter> native_temporal = rsd::make_temporal_block(rsd::temporal_filter_options::from(temporal_filter));
+    rs2::filter& temporal = rsd::has_flag(argc, argv, "--native-temporal") ? *native_temporal : temporal_filter;
+
+    // 处理循环在后台线程运行，主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Depth Image", cv::WINDOW_NORMAL);
+
+    // 帧率显示
+    rsd::fps_counter fps_meter;
 
-    // 计时器变量，用于计算帧率
-    auto last_time = std::chrono::high_resolution_clock::now();
+    // 输出缓冲跨帧复用
+    rsd::frame_pool buffers;
 
-    while (true) {
+    display.run([&] {
         // 等待帧数据到达
-        rs2::frameset frames = p.wait_for_frames();
+        rs2::frameset frames;
+        if (!source->next(frames)) {
+            return false;
+        }
 
         // 获取深度图
         rs2::depth_frame depth_frame = frames.get_depth_frame();
 
         rs2::depth_frame filtered = depth_frame;
 
-        filtered = spatial_filter.process(filtered);
-        filtered = temporal_filter.process(filtered);
-        filtered = hole_filling.process(filtered);
-        filtered = decimation_filter.process(filtered);
-
-        // 创建 OpenCV Mat 来存储深度图
-        const uint16_t* depth_data = reinterpret_cast<const uint16_t*>(filtered.get_data());
-        cv::Mat depth_image(filtered.get_height(), filtered.get_width(), CV_16U, const_cast<uint16_t*>(depth_data));
-
-        // 裁剪深度图的像素值到设定的距离范围
-        for (int i = 0; i < depth_image.rows; ++i) {
-            for (int j = 0; j < depth_image.cols; ++j) {
-                // 获取当前像素的深度值（单位：毫米）
-                uint16_t depth_value = depth_image.at<uint16_t>(i, j);
-                // if (std::isnan(depth_value)){
-                //     depth_image.at<uint16_t>(i, j) = max_distance / max_distance;
-                // }
-                if (depth_value < min_distance) {
-                    depth_image.at<uint16_t>(i, j) = 0;
-                }
-                else if (depth_value > max_distance) {
-                    depth_image.at<uint16_t>(i, j) = max_distance;
-                }
-            }
-        }
-
-        cv::Mat depth_image_float;
-        depth_image.convertTo(depth_image_float, CV_32F, 1.0f / 5000.0f);
+        { RSD_TRACE_SCOPE("spatial"); filtered = spatial.process(filtered); }
+        { RSD_TRACE_SCOPE("temporal"); filtered = temporal.process(filtered); }
+        { RSD_TRACE_SCOPE("hole_filling"); filtered = hole_filling.process(filtered); }
+        { RSD_TRACE_SCOPE("decimation"); filtered = decimation_filter.process(filtered); }
 
-        // for (int i = 0; i < depth_image.rows; ++i) {
-        //     for (int j = 0; j < depth_image.cols; ++j) {
-        //         std::cout << depth_image.at<float>(i, j) << " ";
-        //     }
-        //     std::cout << std::endl;
-        // }
+        // 深度图的只读视图，不拷贝也不修改滤波器输出
+        cv::Mat depth_image = rsd::depth_view(filtered);
 
-        // 将浮点图像转换为 8 位图像
-        cv::Mat final_depth_image;
-        depth_image_float.convertTo(final_depth_image, CV_8U, 255.0);
+        // 裁剪到设定的距离范围并量化为 8 位图像（单次遍历），输出缓冲跨帧复用
+        cv::Mat final_depth_image = buffers.acquire(depth_image.size(), CV_8U);
+        rsd::clip_quantize(depth_image, final_depth_image, clip);
 
-        // 计算和显示帧率
-        auto current_time = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> duration = current_time - last_time;
-        double fps = 1.0 / duration.count();
-        last_time = current_time;
-
-        std::string fps_text = "FPS: " + std::to_string(fps);
+        // 显示帧率：刷新周期内的平均值，文字只在刷新时重新格式化
+        const std::string& fps_text = fps_meter.tick();
 
         // 获取当前分辨率
         cv::Size depth_size = final_depth_image.size();
@@ -107,14 +106,12 @@ int main() {
         // 显示当前分辨率
         cv::putText(final_depth_image, "Resolution: " + std::to_string(depth_size.width) + "x" + std::to_string(depth_size.height), cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
 
-        // 显示裁剪后的深度图
-        cv::imshow("Depth Image", final_depth_image);
+        // 显示裁剪后的深度图（交给显示线程，不等待）
+        display.show("Depth Image", final_depth_image);
 
         // 按下 ESC 键退出
-        if (cv::waitKey(1) == 27) {
-            break;
-        }
-    }
+        return display.poll_key() != 27;
+    });
 
     return 0;
 }
\ No newline at end of file
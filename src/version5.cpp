@@ -1,24 +1,67 @@
 #include <librealsense2/rs.hpp>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <iostream>
-
-int main() {
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "core/cli.hpp"
+#include "core/clip_quantize.hpp"
+#include "core/depth_post.hpp"
+#include "core/depth_stream.hpp"
+#include "core/display_service.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/height_map.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/shm_ring.hpp"
+#include "core/spatial_filter.hpp"
+#include "core/temporal_filter.hpp"
+#include "core/stage_pipeline.hpp"
+#include "core/trace.hpp"
+
+int main(int argc, char** argv) {
     // 创建 RealSense 管道
-    rs2::pipeline p;
-    rs2::config cfg;
+    rsd::source_config source_cfg;
 
     // 配置深度流，640x480分辨率，30帧率
     /* 424*240, 480*270, 640*360, 640*480, 848*480, 1280*720
        6Hz, 15Hz, 30Hz, 60Hz, 90Hz
     */
-    cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 90);
+    source_cfg.enable_depth(640, 480, 90);
+    rsd::parse_source_args(argc, argv, source_cfg);
+
+    // --height-map：把滤波后的深度累计到俯视占据栅格，单独窗口显示
+    // 相机安装位姿：--camera-height <米>（默认 0.3），--camera-pitch <度>（向下为正，默认 0）
+    const bool build_map = rsd::has_flag(argc, argv, "--height-map");
+    float camera_height = 0.3f;
+    float camera_pitch = 0;
+    try {
+        for (int i = 1; i + 1 < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--camera-height") {
+                camera_height = rsd::parse_float("--camera-height", argv[++i]);
+            } else if (arg == "--camera-pitch") {
+                camera_pitch = rsd::parse_float("--camera-pitch", argv[++i]);
+            }
+        }
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
 
     // 配置并启动管道
-    p.start(cfg);
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     // 设置裁剪距离范围（单位：米）
     uint16_t min_distance = 100; // 最小距离 (mm)
     uint16_t max_distance = 5000; // 最大距离 (mm)
+    rsd::clip_range clip(min_distance, max_distance);
 
     int invalid_band_width = 35;
 
@@ -38,88 +81,131 @@ int main() {
     temporal_filter.set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, 0.4);
     temporal_filter.set_option(RS2_OPTION_HOLES_FILL, 3);
 
-    // 创建 OpenCV 窗口
-    cv::namedWindow("Depth Image", cv::WINDOW_NORMAL);
-
-    // 计时器变量，用于计算帧率
-    auto last_time = std::chrono::high_resolution_clock::now();
-
-    while (true) {
-        // 等待帧数据到达
-        rs2::frameset frames = p.wait_for_frames();
-
-        // 获取深度图
-        rs2::depth_frame depth_frame = frames.get_depth_frame();
-
-        rs2::depth_frame filtered = depth_frame;
-
-        filtered = spatial_filter.process(filtered);
-        filtered = temporal_filter.process(filtered);
-        filtered = hole_filling.process(filtered);
-        filtered = decimation_filter.process(filtered);
-
-        // 创建 OpenCV Mat 来存储深度图
-        const uint16_t* depth_data = reinterpret_cast<const uint16_t*>(filtered.get_data());
-        cv::Mat depth_image(filtered.get_height(), filtered.get_width(), CV_16U, const_cast<uint16_t*>(depth_data));
-
-        // 裁剪深度图的像素值到设定的距离范围
-        for (int i = 0; i < depth_image.rows; ++i) {
-            for (int j = 0; j < depth_image.cols; ++j) {
-                // 获取当前像素的深度值（单位：毫米）
-                uint16_t depth_value = depth_image.at<uint16_t>(i, j);
-                // if (std::isnan(depth_value)){
-                //     depth_image.at<uint16_t>(i, j) = max_distance / max_distance;
-                // }
-                if (depth_value < min_distance) {
-                    depth_image.at<uint16_t>(i, j) = 0;
-                }
-                else if (depth_value > max_distance) {
-                    depth_image.at<uint16_t>(i, j) = max_distance;
-                }
-            }
-        }
+    // --native-spatial：用原生空间滤波器替换 rs2::spatial_filter，参数相同
+    std::shared_ptr<rs2::filter> native_spatial = rsd::make_spatial_block(rsd::spatial_filter_options::from(spatial_filter));
+    rs2::filter& spatial = rsd::has_flag(argc, argv, "--native-spatial") ? *native_spatial : spatial_filter;
+
+    // --native-temporal：用原生时域滤波器替换 rs2::temporal_filter，参数相同
+    std::shared_ptr<rs2::filter> native_temporal = rsd::make_temporal_block(rsd::temporal_filter_options::from(temporal_filter));
+    rs2::filter& temporal = rsd::has_flag(argc, argv, "--native-temporal") ? *native_temporal : temporal_filter;
 
-        cv::Mat depth_image_float;
-        depth_image.convertTo(depth_image_float, CV_32F, 1.0f / 5000.0f);
+    const rsd::camera_pose camera = rsd::camera_pose::mount(camera_height, camera_pitch);
+    rsd::height_map occupancy_map;
 
-        // for (int i = 0; i < depth_image.rows; ++i) {
-        //     for (int j = 0; j < depth_image.cols; ++j) {
-        //         std::cout << depth_image.at<float>(i, j) << " ";
-        //     }
-        //     std::cout << std::endl;
-        // }
+    // --publish <name>：把滤波后的深度发布到共享内存环，同机的其他进程用 shm_subscriber 零拷贝读取
+    rsd::shm_ring_options publish_cfg;
+    std::unique_ptr<rsd::shm_publisher> publisher;
+    if (rsd::parse_publish_args(argc, argv, publish_cfg)) {
+        publisher.reset(new rsd::shm_publisher(publish_cfg));
+    }
+
+    // --stream <address>：把滤波后的深度压缩后推送给套接字客户端（见 stream_view），客户端跟不上时丢弃旧帧
+    rsd::stream_server_options stream_cfg;
+    std::unique_ptr<rsd::stream_server> streamer;
+    if (rsd::parse_stream_args(argc, argv, stream_cfg)) {
+        streamer.reset(new rsd::stream_server(stream_cfg));
+    }
 
-        // 将浮点图像转换为 8 位图像
-        cv::Mat final_depth_image;
-        depth_image_float.convertTo(final_depth_image, CV_8U, 255.0);
+    // 显示服务：主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Depth Image", cv::WINDOW_NORMAL);
+    if (build_map) {
+        display.create_window("Occupancy", cv::WINDOW_NORMAL);
+    }
 
-        // 裁剪 invalid band
-        cv::Rect roi(invalid_band_width, 0, final_depth_image.cols - invalid_band_width, final_depth_image.rows);
-        final_depth_image = final_depth_image(roi);
+    // 后处理的输出缓冲：显示线程用完后自动回到池中，容量覆盖队列中和显示中的帧
+    rsd::frame_pool buffers;
 
-        // 计算和显示帧率
-        auto current_time = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> duration = current_time - last_time;
-        double fps = 1.0 / duration.count();
-        last_time = current_time;
+    // 后处理（只在后处理线程中使用，帧率也在其中统计）
+    rsd::depth_post post(buffers, clip, invalid_band_width);
 
-        std::string fps_text = "FPS: " + std::to_string(fps);
+    // 分级流水线：采集、滤波、后处理各占一个线程，显示在主线程
+    // 默认只处理最新帧，--block 时各级互相等待、不丢帧
+    rsd::stage_pipeline pipeline(rsd::parse_drop_policy(argc, argv, rsd::drop_policy::keep_latest));
 
-        // 获取当前分辨率
-        cv::Size depth_size = final_depth_image.size();
+    // 采集：等待帧数据到达
+    pipeline.set_source([&](rsd::frame_packet& packet) {
+        if (!source->next(packet.frames)) {
+            return false;
+        }
+        packet.depth = packet.frames.get_depth_frame();
+        return true;
+    });
+
+    // 滤波
+    pipeline.add_stage("filter", [&](rsd::frame_packet& packet) {
+        rs2::frame filtered = packet.depth;
+
+        { RSD_TRACE_SCOPE("spatial"); filtered = spatial.process(filtered); }
+        { RSD_TRACE_SCOPE("temporal"); filtered = temporal.process(filtered); }
+        { RSD_TRACE_SCOPE("hole_filling"); filtered = hole_filling.process(filtered); }
+        { RSD_TRACE_SCOPE("decimation"); filtered = decimation_filter.process(filtered); }
+
+        packet.depth = filtered;
+        return true;
+    });
+
+    // 发布：拷贝进共享内存槽一次，订阅进程直接读取
+    if (publisher) {
+        pipeline.add_stage("publish", [&](rsd::frame_packet& packet) {
+            publisher->publish(packet.depth.as<rs2::depth_frame>());
+            return true;
+        });
+    }
 
-        cv::putText(final_depth_image, fps_text, cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+    // 推流：只把帧交给各客户端的发送线程，压缩和写出不占用流水线
+    if (streamer) {
+        pipeline.add_stage("stream", [&](rsd::frame_packet& packet) {
+            streamer->send(packet.depth.as<rs2::depth_frame>());
+            return true;
+        });
+    }
 
-        // 显示当前分辨率
-        cv::putText(final_depth_image, "Resolution: " + std::to_string(depth_size.width) + "x" + std::to_string(depth_size.height), cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 2);
+    // 占据栅格：增量累计，每帧输出当前的占据图
+    if (build_map) {
+        pipeline.add_stage("height_map", [&](rsd::frame_packet& packet) {
+            occupancy_map.update(packet.depth.as<rs2::depth_frame>(), camera);
+            cv::Mat map_image = buffers.acquire(cv::Size(occupancy_map.options().cols, occupancy_map.options().rows), CV_8U);
+            occupancy_map.occupancy(map_image);
+            packet.map = map_image;
+            return true;
+        });
+    }
 
-        // 显示裁剪后的深度图
-        cv::imshow("Depth Image", final_depth_image);
+    // 后处理：裁剪、量化、去除 invalid band、叠加文字
+    pipeline.add_stage("post", [&](rsd::frame_packet& packet) {
+        packet.image = post.process(packet.depth);
+        return true;
+    });
+
+    pipeline.start();
+
+    // 取出流水线的输出交给显示服务，显示跟不上时只跳过中间的帧，不会阻塞流水线
+    display.run([&] {
+        rsd::frame_packet packet;
+        if (pipeline.pop_output(packet, 100)) {
+            // 显示裁剪后的深度图
+            display.show("Depth Image", packet.image);
+            if (!packet.map.empty()) {
+                display.show("Occupancy", packet.map);
+            }
+        }
 
         // 按下 ESC 键退出
-        if (cv::waitKey(1) == 27) {
-            break;
-        }
+        return !pipeline.finished() && display.poll_key() != 27;
+    });
+
+    pipeline.stop();
+    source->stop();
+
+    // 输出各级处理和丢弃的帧数
+    for (const rsd::stage_pipeline::stage_stats& s : pipeline.stats()) {
+        std::cout << s.name << ": processed " << s.processed << ", dropped " << s.dropped << std::endl;
+    }
+    if (streamer) {
+        const rsd::stream_server::stats s = streamer->get_stats();
+        std::cout << "stream: sent " << s.sent << " (" << s.key_frames << " key), dropped " << s.dropped << ", "
+                  << s.bytes * 100 / std::max<uint64_t>(s.raw_bytes, 1) << "% of raw size" << std::endl;
     }
 
     return 0;
@@ -0,0 +1,572 @@
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/clip_quantize.hpp"
+#include "core/depth_align.hpp"
+#include "core/depth_codec.hpp"
+#include "core/depth_colormap.hpp"
+#include "core/depth_post.hpp"
+#include "core/depth_stats.hpp"
+#include "core/filter_chain.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/height_map.hpp"
+#include "core/hole_filler.hpp"
+#include "core/joint_bilateral.hpp"
+#include "core/point_cloud.hpp"
+#include "core/rs2_adapter.hpp"
+#include "core/simd.hpp"
+#include "core/spatial_filter.hpp"
+#include "core/stage_pipeline.hpp"
+#include "core/temporal_filter.hpp"
+
+// 无窗口基准测试：在合成数据（或录像）上逐个测量各处理阶段，覆盖相机支持的所有分辨率，
+// 输出每帧耗时、像素吞吐和每帧内存分配次数，结果写成 CSV / JSON，可与上一次的 CSV 对比找出性能回退
+//
+// 用法：bench [--frames 100] [--warmup 10] [--sizes all|640x480,1280x720] [--stages clip,align,...]
+//             [--out bench] [--baseline old.csv] [--threshold 0.1]
+//       bench --bag record.bag      只测录像自身的分辨率
+
+// 统计整个进程的 operator new 次数与字节数（包括 OpenCV 的 Mat 头和 librealsense 的帧分配）。
+// Mat 的像素缓冲由 cv::fastMalloc 分配，不经过 operator new，其字节数由下面的 counting_mat_allocator 计入；
+// 每个 Mat 缓冲同时分配一个 UMatData 头（operator new），因此次数里已经包含它。
+// OpenCV 内部的临时缓冲（AutoBuffer 等）与 librealsense 自己 malloc 的内存不计入
+static std::atomic<uint64_t> allocation_count(0);
+static std::atomic<uint64_t> allocation_bytes(0);
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag access_flags;
+#else
+typedef int access_flags;
+#endif
+
+// 把分配委托给 OpenCV 的默认分配器，只累计新分配的像素缓冲字节数；
+// 缓冲释放时 UMatData 记录的仍是默认分配器，直接由它回收
+class counting_mat_allocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           access_flags flags, cv::UMatUsageFlags usage) const override {
+        cv::UMatData* u = base()->allocate(dims, sizes, type, data, step, flags, usage);
+        if (u && !data) {
+            allocation_bytes.fetch_add(u->size, std::memory_order_relaxed);
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, access_flags flags, cv::UMatUsageFlags usage) const override {
+        return base()->allocate(u, flags, usage);
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        base()->deallocate(u);
+    }
+
+private:
+    static cv::MatAllocator* base() { return cv::Mat::getStdAllocator(); }
+};
+
+typedef std::function<void(const rs2::frameset&)> frame_fn;
+
+// 一个被测阶段：每个分辨率调用一次 make，得到带有独立状态（temporal 历史等）的逐帧处理函数
+struct bench_stage {
+    std::string name;
+    bool needs_color;
+    std::function<frame_fn()> make;
+};
+
+struct bench_result {
+    std::string stage;
+    int width = 0;
+    int height = 0;
+    size_t frames = 0;
+    double ns_per_frame = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double mpixels_per_s = 0;
+    double allocs_per_frame = 0;
+    double bytes_per_frame = 0;
+};
+
+// 相机支持的深度分辨率，与各程序源码注释中列出的一致
+const char* const all_sizes[] = {"424x240", "480x270", "640x360", "640x480", "848x480", "1280x720"};
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5))];
+}
+
+// 单个滤波器，参数取 filter_chain_config 的默认值（与 version4 / version5 相同）
+frame_fn single_filter(rsd::filter_kind kind, bool native) {
+    rsd::filter_chain_config config;
+    config.order = {kind};
+    config.native_spatial = native;
+    config.native_temporal = native;
+    std::shared_ptr<rsd::filter_chain> chain(new rsd::filter_chain(config));
+    return [chain](const rs2::frameset& frames) { chain->process(frames.get_depth_frame()); };
+}
+
+std::vector<bench_stage> make_stages() {
+    std::vector<bench_stage> stages;
+    const rsd::clip_range clip(100, 5000);
+
+    stages.push_back({"clip", false, [clip] {
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([clip, out](const rs2::frameset& frames) {
+            rsd::clip_quantize(rsd::depth_view(frames.get_depth_frame()), *out, clip);
+        });
+    }});
+    stages.push_back({"normalize", false, [] {
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([out](const rs2::frameset& frames) {
+            cv::normalize(rsd::depth_view(frames.get_depth_frame()), *out, 0, 255, cv::NORM_MINMAX, CV_8U);
+        });
+    }});
+    stages.push_back({"colormap", false, [] {
+        std::shared_ptr<rsd::depth_colorizer> colorizer(new rsd::depth_colorizer(100, 6000, rsd::colormap::jet));
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([colorizer, out](const rs2::frameset& frames) {
+            colorizer->colorize(rsd::depth_view(frames.get_depth_frame()), *out);
+        });
+    }});
+    stages.push_back({"depth_stats", false, [] {
+        std::shared_ptr<rsd::depth_stats> stats(new rsd::depth_stats(rsd::depth_stats_options(false)));
+        return frame_fn([stats](const rs2::frameset& frames) {
+            stats->compute(rsd::depth_view(frames.get_depth_frame()));
+        });
+    }});
+    // RVL 压缩；rvl 为压缩加解压的往返，两者之差即解压耗时
+    stages.push_back({"rvl_encode", false, [] {
+        std::shared_ptr<rsd::depth_codec> codec(new rsd::depth_codec);
+        std::shared_ptr<std::vector<uint8_t>> encoded(new std::vector<uint8_t>);
+        return frame_fn([codec, encoded](const rs2::frameset& frames) {
+            codec->encode(rsd::depth_view(frames.get_depth_frame()), *encoded);
+        });
+    }});
+    stages.push_back({"rvl", false, [] {
+        std::shared_ptr<rsd::depth_codec> codec(new rsd::depth_codec);
+        std::shared_ptr<std::vector<uint8_t>> encoded(new std::vector<uint8_t>);
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([codec, encoded, out](const rs2::frameset& frames) {
+            codec->encode(rsd::depth_view(frames.get_depth_frame()), *encoded);
+            codec->decode(encoded->data(), encoded->size(), *out);
+        });
+    }});
+    stages.push_back({"decimation", false, [] { return single_filter(rsd::filter_kind::decimation, false); }});
+    stages.push_back({"spatial", false, [] { return single_filter(rsd::filter_kind::spatial, false); }});
+    stages.push_back({"native_spatial", false, [] { return single_filter(rsd::filter_kind::spatial, true); }});
+    stages.push_back({"temporal", false, [] { return single_filter(rsd::filter_kind::temporal, false); }});
+    stages.push_back({"native_temporal", false, [] { return single_filter(rsd::filter_kind::temporal, true); }});
+    stages.push_back({"hole_filling", false, [] { return single_filter(rsd::filter_kind::hole_filling, false); }});
+    // 点云：原生生成（含 1 cm 体素降采样）与 rs2::pointcloud 对比
+    stages.push_back({"point_cloud", false, [] {
+        std::shared_ptr<rsd::point_cloud_generator> generator(new rsd::point_cloud_generator);
+        std::shared_ptr<rsd::point_cloud> cloud(new rsd::point_cloud);
+        return frame_fn([generator, cloud](const rs2::frameset& frames) {
+            rs2::depth_frame depth = frames.get_depth_frame();
+            generator->configure(depth);
+            generator->process(rsd::depth_view(depth), *cloud);
+        });
+    }});
+    stages.push_back({"voxel", false, [] {
+        std::shared_ptr<rsd::point_cloud_generator> generator(new rsd::point_cloud_generator);
+        std::shared_ptr<rsd::voxel_grid> grid(new rsd::voxel_grid(0.01f));
+        std::shared_ptr<rsd::point_cloud> cloud(new rsd::point_cloud);
+        std::shared_ptr<rsd::point_cloud> voxels(new rsd::point_cloud);
+        return frame_fn([generator, grid, cloud, voxels](const rs2::frameset& frames) {
+            rs2::depth_frame depth = frames.get_depth_frame();
+            generator->configure(depth);
+            generator->process(rsd::depth_view(depth), *cloud);
+            grid->downsample(*cloud, *voxels);
+        });
+    }});
+    stages.push_back({"rs2_pointcloud", false, [] {
+        std::shared_ptr<rs2::pointcloud> pointcloud(new rs2::pointcloud);
+        return frame_fn([pointcloud](const rs2::frameset& frames) { pointcloud->calculate(frames.get_depth_frame()); });
+    }});
+    // 占据栅格：相机 0.3 m 高、下俯 15°，每帧增量累计
+    stages.push_back({"height_map", false, [] {
+        std::shared_ptr<rsd::height_map> map(new rsd::height_map);
+        const rsd::camera_pose pose = rsd::camera_pose::mount(0.3f, 15.0f);
+        return frame_fn([map, pose](const rs2::frameset& frames) { map->update(frames.get_depth_frame(), pose); });
+    }});
+    stages.push_back({"align", true, [] {
+        std::shared_ptr<rs2::filter> align = rsd::make_align_block(RS2_STREAM_COLOR);
+        return frame_fn([align](const rs2::frameset& frames) { align->process(frames); });
+    }});
+    stages.push_back({"inpaint", false, [] {
+        std::shared_ptr<rsd::push_pull_filler> filler(new rsd::push_pull_filler);
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([filler, out](const rs2::frameset& frames) {
+            filler->process(rsd::depth_view(frames.get_depth_frame()), *out);
+        });
+    }});
+    stages.push_back({"bilateral", true, [] {
+        std::shared_ptr<rsd::joint_bilateral_filter> filter(
+            new rsd::joint_bilateral_filter(rsd::joint_bilateral_options(2, 2.0f, 20.0f)));
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([filter, out](const rs2::frameset& frames) {
+            filter->process(rsd::depth_view(frames.get_depth_frame()),
+                            rsd::frame_view(frames.get_color_frame(), CV_8UC3), *out);
+        });
+    }});
+    // version4：滤波链 + 裁剪量化，单线程串行
+    stages.push_back({"version4", false, [clip] {
+        std::shared_ptr<rsd::filter_chain> chain(new rsd::filter_chain);
+        std::shared_ptr<cv::Mat> out(new cv::Mat);
+        return frame_fn([chain, clip, out](const rs2::frameset& frames) {
+            rs2::frame filtered = chain->process(frames.get_depth_frame());
+            rsd::clip_quantize(rsd::depth_view(filtered), *out, clip);
+        });
+    }});
+    return stages;
+}
+
+// 逐帧测量：前 warmup 帧不计入，预载的帧循环使用
+bench_result measure(const bench_stage& stage, const std::vector<rs2::frameset>& sequence,
+                     size_t frames, size_t warmup) {
+    frame_fn fn = stage.make();
+    std::vector<double> latencies;
+    latencies.reserve(frames);
+
+    uint64_t allocations = 0, bytes = 0;
+    for (size_t i = 0; i < warmup + frames; ++i) {
+        if (i == warmup) {
+            allocations = allocation_count.load();
+            bytes = allocation_bytes.load();
+        }
+        const rs2::frameset& input = sequence[i % sequence.size()];
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        fn(input);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        if (i >= warmup) {
+            latencies.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+        }
+    }
+
+    bench_result r;
+    r.stage = stage.name;
+    r.frames = frames;
+    double total = 0;
+    for (double l : latencies) total += l;
+    r.ns_per_frame = total / double(frames);
+    r.p50_ns = percentile(latencies, 0.5);
+    r.p99_ns = percentile(latencies, 0.99);
+    r.allocs_per_frame = double(allocation_count.load() - allocations) / double(frames);
+    r.bytes_per_frame = double(allocation_bytes.load() - bytes) / double(frames);
+    return r;
+}
+
+// version5：与 version5 相同的两级流水线（滤波、后处理），阻塞模式不丢帧；
+// 每帧耗时按输出间隔计算（吞吐量），百分位数为采集到输出的端到端延迟
+bench_result measure_version5(const std::vector<rs2::frameset>& sequence, size_t frames, size_t warmup) {
+    rsd::filter_chain chain;
+    // 后处理与 version5 相同：同一个 depth_post，输出缓冲同样取自 frame_pool
+    rsd::frame_pool buffers;
+    rsd::depth_post post(buffers, rsd::clip_range(100, 5000), 35);
+
+    rsd::stage_pipeline pipeline(rsd::drop_policy::block);
+    size_t next = 0;
+    pipeline.set_source([&](rsd::frame_packet& packet) {
+        if (next >= warmup + frames) {
+            return false;
+        }
+        packet.frames = sequence[next++ % sequence.size()];
+        packet.depth = packet.frames.get_depth_frame();
+        return true;
+    });
+    pipeline.add_stage("filter", [&](rsd::frame_packet& packet) {
+        packet.depth = chain.process(packet.depth);
+        return true;
+    });
+    pipeline.add_stage("post", [&](rsd::frame_packet& packet) {
+        packet.image = post.process(packet.depth);
+        return true;
+    });
+
+    std::vector<double> latencies;
+    uint64_t allocations = 0, bytes = 0;
+    std::chrono::steady_clock::time_point first, last;
+    size_t received = 0;
+    pipeline.start();
+    while (!pipeline.finished()) {
+        rsd::frame_packet packet;
+        if (!pipeline.pop_output(packet, 100)) {
+            continue;
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (received == warmup) {
+            first = now;
+            allocations = allocation_count.load();
+            bytes = allocation_bytes.load();
+        } else if (received > warmup) {
+            latencies.push_back(std::chrono::duration<double, std::nano>(now - packet.captured).count());
+        }
+        last = now;
+        ++received;
+    }
+    pipeline.stop();
+
+    bench_result r;
+    r.stage = "version5";
+    r.frames = latencies.size();
+    if (r.frames > 0) {
+        r.ns_per_frame = std::chrono::duration<double, std::nano>(last - first).count() / double(r.frames);
+        r.allocs_per_frame = double(allocation_count.load() - allocations) / double(r.frames);
+        r.bytes_per_frame = double(allocation_bytes.load() - bytes) / double(r.frames);
+    }
+    r.p50_ns = percentile(latencies, 0.5);
+    r.p99_ns = percentile(latencies, 0.99);
+    return r;
+}
+
+const char* const csv_header = "stage,width,height,frames,ns_per_frame,p50_ns,p99_ns,mpixels_per_s,allocs_per_frame,bytes_per_frame";
+
+void write_csv(const std::string& path, const std::vector<bench_result>& results) {
+    std::ofstream out(path.c_str());
+    out << csv_header << "\n" << std::fixed << std::setprecision(1);
+    for (const bench_result& r : results) {
+        out << r.stage << ',' << r.width << ',' << r.height << ',' << r.frames << ',' << r.ns_per_frame << ','
+            << r.p50_ns << ',' << r.p99_ns << ',' << r.mpixels_per_s << ',' << r.allocs_per_frame << ','
+            << r.bytes_per_frame << "\n";
+    }
+}
+
+void write_json(const std::string& path, const std::string& source, const std::vector<bench_result>& results) {
+    std::ofstream out(path.c_str());
+    out << std::fixed << std::setprecision(1);
+    out << "{\n  \"source\": \"" << source << "\",\n"
+        << "  \"simd\": \"" << rsd::simd::name(rsd::simd::detect()) << "\",\n"
+        << "  \"threads\": " << cv::getNumThreads() << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const bench_result& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"stage\": \"" << r.stage << "\", \"width\": " << r.width
+            << ", \"height\": " << r.height << ", \"frames\": " << r.frames << ", \"ns_per_frame\": " << r.ns_per_frame
+            << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns << ", \"mpixels_per_s\": " << r.mpixels_per_s
+            << ", \"allocs_per_frame\": " << r.allocs_per_frame << ", \"bytes_per_frame\": " << r.bytes_per_frame << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// 读取上一次输出的 CSV，键为 "stage@WxH"，值为 ns_per_frame
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw std::runtime_error("cannot open baseline " + path);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        const std::vector<std::string> fields = split(line, ',');
+        if (fields.size() >= 5) {
+            baseline[fields[0] + "@" + fields[1] + "x" + fields[2]] = std::atof(fields[4].c_str());
+        }
+    }
+    return baseline;
+}
+
+// 与基线对比，耗时增加超过 threshold（比例）的记为回退，返回回退的个数
+int compare(const std::vector<bench_result>& results, const std::map<std::string, double>& baseline, double threshold) {
+    int regressions = 0;
+    std::cout << "\nCompared with baseline (threshold +" << threshold * 100 << "%):" << std::endl;
+    for (const bench_result& r : results) {
+        const std::string key = r.stage + "@" + std::to_string(r.width) + "x" + std::to_string(r.height);
+        std::map<std::string, double>::const_iterator it = baseline.find(key);
+        if (it == baseline.end() || it->second <= 0) {
+            continue;
+        }
+        const double change = r.ns_per_frame / it->second - 1.0;
+        const bool regressed = change > threshold;
+        regressions += regressed;
+        std::cout << (regressed ? "  REGRESSION " : "  ") << std::left << std::setw(24) << key << std::right
+                  << std::fixed << std::setprecision(0) << std::setw(12) << it->second << " -> "
+                  << std::setw(12) << r.ns_per_frame << " ns  (" << std::showpos << std::setprecision(1)
+                  << change * 100 << "%)" << std::noshowpos << std::endl;
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // 在创建任何 Mat 之前换上计数分配器，之后所有默认分配的 Mat 缓冲都计入 bytes_per_frame
+    static counting_mat_allocator mat_allocator;
+    cv::Mat::setDefaultAllocator(&mat_allocator);
+
+    rsd::source_config source_cfg;
+    source_cfg.kind = rsd::source_kind::synthetic;
+
+    size_t frames = 100;
+    size_t warmup = 10;
+    size_t preload = 30;
+    std::vector<std::string> sizes(all_sizes, all_sizes + sizeof(all_sizes) / sizeof(all_sizes[0]));
+    std::vector<std::string> selected;
+    std::string out_prefix = "bench";
+    std::string baseline_path;
+    double threshold = 0.1;
+
+    try {
+        // --frames 在这里表示每个阶段测量的帧数，不交给 parse_source_args
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--bag" && has_value) {
+                source_cfg.kind = rsd::source_kind::bag;
+                source_cfg.bag_path = argv[++i];
+            } else if (arg == "--frames" && has_value) {
+                frames = size_t(std::max(1, std::atoi(argv[++i])));
+            } else if (arg == "--warmup" && has_value) {
+                warmup = size_t(std::max(0, std::atoi(argv[++i])));
+            } else if (arg == "--sizes" && has_value) {
+                const std::string value = argv[++i];
+                if (value != "all") sizes = split(value, ',');
+            } else if (arg == "--stages" && has_value) {
+                selected = split(argv[++i], ',');
+            } else if (arg == "--out" && has_value) {
+                out_prefix = argv[++i];
+            } else if (arg == "--baseline" && has_value) {
+                baseline_path = argv[++i];
+            } else if (arg == "--threshold" && has_value) {
+                threshold = std::atof(argv[++i]);
+            }
+        }
+        if (source_cfg.kind == rsd::source_kind::bag) {
+            // 录像只有一种分辨率，由文件决定
+            sizes.assign(1, "bag");
+        }
+
+        std::vector<bench_stage> stages;
+        for (const bench_stage& stage : make_stages()) {
+            if (selected.empty() || std::find(selected.begin(), selected.end(), stage.name) != selected.end()) {
+                stages.push_back(stage);
+            }
+        }
+        const bool run_version5 = selected.empty() || std::find(selected.begin(), selected.end(), "version5") != selected.end();
+
+        std::vector<bench_result> results;
+        std::string description;
+        std::cout << std::left << std::setw(18) << "stage" << std::setw(11) << "size" << std::right
+                  << std::setw(12) << "ns/frame" << std::setw(12) << "p99 ns" << std::setw(12) << "Mpix/s"
+                  << std::setw(12) << "allocs/f" << std::endl;
+
+        for (const std::string& size : sizes) {
+            if (size != "bag") {
+                int width = 0, height = 0;
+                if (std::sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                    throw std::invalid_argument("--sizes expects WIDTHxHEIGHT[,WIDTHxHEIGHT...]");
+                }
+                source_cfg.enable_depth(width, height, 90);
+                source_cfg.enable_color(width, height, 90);
+            }
+            source_cfg.max_frames = preload;
+
+            // 预载一段帧序列，之后所有阶段都在同一组帧上反复测量
+            std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+            source->start();
+            std::vector<rs2::frameset> sequence;
+            rs2::frameset input;
+            while (source->next(input)) {
+                input.keep();
+                sequence.push_back(input);
+            }
+            source->stop();
+            description = source->description();
+            if (sequence.empty()) {
+                std::cerr << "No frames from " << description << std::endl;
+                return EXIT_FAILURE;
+            }
+            const rs2::video_frame depth = sequence[0].get_depth_frame();
+            const bool has_color = bool(sequence[0].get_color_frame());
+
+            std::vector<bench_result> rows;
+            for (const bench_stage& stage : stages) {
+                if (stage.needs_color && !has_color) {
+                    continue;
+                }
+                rows.push_back(measure(stage, sequence, frames, warmup));
+            }
+            if (run_version5) {
+                rows.push_back(measure_version5(sequence, frames, warmup));
+            }
+
+            for (bench_result& r : rows) {
+                r.width = depth.get_width();
+                r.height = depth.get_height();
+                r.mpixels_per_s = r.ns_per_frame > 0 ? double(r.width) * r.height / r.ns_per_frame * 1e3 : 0;
+                std::cout << std::left << std::setw(18) << r.stage << std::setw(11)
+                          << (std::to_string(r.width) + "x" + std::to_string(r.height)) << std::right << std::fixed
+                          << std::setprecision(0) << std::setw(12) << r.ns_per_frame << std::setw(12) << r.p99_ns
+                          << std::setprecision(1) << std::setw(12) << r.mpixels_per_s << std::setw(12)
+                          << r.allocs_per_frame << std::endl;
+                results.push_back(r);
+            }
+        }
+
+        write_csv(out_prefix + ".csv", results);
+        write_json(out_prefix + ".json", description, results);
+        std::cout << "Wrote " << out_prefix << ".csv and " << out_prefix << ".json" << std::endl;
+
+        if (!baseline_path.empty() && compare(results, read_baseline(baseline_path), threshold) > 0) {
+            return 2;
+        }
+    }
+    catch (const rs2::error& e) {
+        std::cerr << "RealSense error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,23 +1,34 @@
 #include <librealsense2/rs.hpp> // 包含 RealSense 跨平台 API
 #include <opencv2/opencv.hpp>   // 包含 OpenCV API
 #include <iostream>
-#include <chrono>
+#include <memory>
+
+#include "core/cli.hpp"
+#include "core/depth_colormap.hpp"
+#include "core/display_service.hpp"
+#include "core/fps_counter.hpp"
+#include "core/frame_pool.hpp"
+#include "core/frame_source.hpp"
+#include "core/temporal_filter.hpp"
+#include "core/trace.hpp"
 
 using namespace std;
 using namespace cv;
 
-int main() {
-    // 声明 RealSense 管道，封装实际设备和传感器
-    rs2::pipeline pipe;
-
-    // 创建配置以使用非默认配置配置管道
-    rs2::config cfg;
+int main(int argc, char** argv) {
+    // 创建帧来源配置（默认实时相机，可通过 --bag / --synthetic 切换）
+    rsd::source_config source_cfg;
 
     // 添加一个流到配置中
-    cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 90);
+    source_cfg.enable_depth(640, 480, 90);
+    rsd::parse_source_args(argc, argv, source_cfg);
+
+    // --trace <prefix> / --chrome-trace <file>：记录各阶段耗时，退出时打印汇总
+    rsd::trace::session tracing(argc, argv);
 
-    // 使用选择的配置启动管道
-    rs2::pipeline_profile profile = pipe.start(cfg);
+    // 使用选择的配置启动帧来源
+    std::unique_ptr<rsd::frame_source> source = rsd::make_frame_source(source_cfg);
+    source->start();
 
     rs2::decimation_filter decimation_filter;
     rs2::hole_filling_filter hole_filling;
@@ -33,24 +44,37 @@ int main() {
     temporal_filter.set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, 0.4);
     temporal_filter.set_option(RS2_OPTION_HOLES_FILL, 3);
 
-    // 定义窗口名称以显示深度图像
-    cv::namedWindow("Depth Image", cv::WINDOW_NORMAL);
+    // --native-temporal：用原生时域滤波器替换 rs2::temporal_filter，参数相同
+    std::shared_ptr<rs2::filter> native_temporal = rsd::make_temporal_block(rsd::temporal_filter_options::from(temporal_filter));
+    rs2::filter& temporal = rsd::has_flag(argc, argv, "--native-temporal") ? *native_temporal : temporal_filter;
+
+    // 显示服务：处理循环在后台线程运行，主线程按刷新率显示最新结果；--headless 不显示，--display-fps <n> 设置刷新率
+    rsd::display_service display(rsd::parse_display_args(argc, argv));
+    display.create_window("Depth Image", cv::WINDOW_NORMAL);
+
+    // 按固定的 0.1m 到 6m 范围生成伪彩色查找表，只需构建一次
+    rsd::depth_colorizer colorizer(100, 6000, rsd::colormap::jet);
+
+    // 帧率显示
+    rsd::fps_counter fps_meter;
 
-    // 用于计算帧率的变量和时钟
-    int frames_count = 0;
-    auto start = chrono::steady_clock::now();
+    // 输出缓冲跨帧复用
+    rsd::frame_pool buffers;
 
-    // 循环直到有人关闭窗口
-    while (waitKey(1) < 0 && getWindowProperty("Depth Image", WND_PROP_AUTOSIZE) >= 0) {
+    // 循环直到有人按键或关闭窗口
+    display.run([&] {
         // 等待从相机获取下一组帧
-        auto frames = pipe.wait_for_frames();
+        rs2::frameset frames;
+        if (!source->next(frames)) {
+            return false;
+        }
 
         // 从管道获取帧
         rs2::frame depth_frame = frames.get_depth_frame();
          
-        depth_frame = hole_filling.process(depth_frame);
+        { RSD_TRACE_SCOPE("hole_filling"); depth_frame = hole_filling.process(depth_frame); }
         // depth_frame = spatial_filter.process(depth_frame);
-        depth_frame = temporal_filter.process(depth_frame);
+        { RSD_TRACE_SCOPE("temporal"); depth_frame = temporal.process(depth_frame); }
         // depth_frame = decimation_filter.process(depth_frame);
 
         // 查询帧的大小（宽度和高度）
@@ -60,44 +84,20 @@ int main() {
         // 从深度帧数据创建 OpenCV 矩阵（大小为 height x width）
         Mat depth_image(Size(width, height), CV_16U, (void*)depth_frame.get_data(), Mat::AUTO_STEP);
 
-        // CLIP
-        // 将深度图裁剪到0m到6m的范围（深度单位是毫米）
-        for (int i = 0; i < depth_image.rows; ++i) {
-            for (int j = 0; j < depth_image.cols; ++j) {
-                uint16_t depth_value = depth_image.at<uint16_t>(i, j);
-                // 转换为米并裁剪
-                if (depth_value < 100) {
-                    depth_image.at<uint16_t>(i, j) = 0;
-                }
-                else if (depth_value > 6000) {
-                    depth_image.at<uint16_t>(i, j) = 6000;
-                }
-            }
-        }
-
-        // 归一化深度图像以便正确显示
-        Mat depth_normalized;
-        normalize(depth_image, depth_normalized, 0, 255, NORM_MINMAX, CV_8U);
-
-        // 应用伪彩色映射到深度图像
-        Mat depth_colormap;
-        applyColorMap(depth_normalized, depth_colormap, COLORMAP_JET);
-
-        // 计算帧率
-        frames_count++; 
-        auto now = chrono::steady_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::milliseconds>(now - start).count() / 1000.0;
-        double fps = frames_count / elapsed;
+        // 查表生成伪彩色深度图（裁剪、归一化和着色合并为一次遍历）
+        Mat depth_colormap = buffers.acquire(depth_image.size(), CV_8UC3);
+        colorizer.colorize(depth_image, depth_colormap);
 
-        // 在深度图像窗口上方显示帧率
-        putText(depth_colormap, "FPS: " + to_string(fps), Point(10, 30), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(255, 255, 255), 2);
+        // 在深度图像窗口上方显示帧率（文字只在刷新时重新格式化）
+        putText(depth_colormap, fps_meter.tick(), Point(10, 30), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(255, 255, 255), 2);
 
-        // 更新窗口显示新数据
-        imshow("Depth Image", depth_colormap);
-    }
+        // 交给显示线程更新窗口
+        display.show("Depth Image", depth_colormap);
+        return display.poll_key() < 0 && !display.window_closed();
+    });
 
-    // 停止管道并释放资源
-    pipe.stop();
+    // 停止帧来源并释放资源
+    source->stop();
 
     return 0;
 }